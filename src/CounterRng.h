@@ -0,0 +1,146 @@
+/*******************************************************************************
+ CounterRng: Counter-based random number generator.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+namespace DTS
+{
+
+/** Counter-based random numbers (Philox4x32-10).
+ *
+ * The numbers are a pure function of a key, set from a seed, and a
+ * counter chosen by the caller, typically a particle index, a simulation
+ * step, a draw number and the number of the event within the step. There
+ * is no state that changes between calls, so any range of particles can be
+ * seeded by any thread, in any order, with the same result:
+ * \code
+ *   DTS::CounterRng rng(seed);
+ *   double u[4];
+ *   rng.uniform(particle, step, 0, events.next(step), u);
+ * \endcode
+ *
+ * On a cluster every node takes the same steps and applies the same
+ * changes after the same step, so a counter made of the step and the
+ * event number draws the same numbers on every node.
+ *
+ * See Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11.
+ */
+class CounterRng
+{
+   public:
+      typedef unsigned int Word; ///< 32 bits on the supported platforms.
+
+      explicit CounterRng(Word seed=0)
+      {
+         setSeed(seed);
+      }
+
+      void setSeed(Word seed)
+      {
+         key[0]=seed;
+         key[1]=0;
+      }
+
+      Word getSeed() const
+      {
+         return key[0];
+      }
+
+      /** Four random words for the counter (index, step, draw, event). */
+      void generate(Word index, Word step, Word draw, Word event, Word out[4]) const
+      {
+         Word counter[4]= { index, step, draw, event };
+         Word roundKey[2]= { key[0], key[1] };
+
+         for (int round=0; round < 10; round++)
+         {
+            unsigned long long product0=(unsigned long long) 0xD2511F53u * counter[0];
+            unsigned long long product1=(unsigned long long) 0xCD9E8D57u * counter[2];
+            Word high0=Word(product0 >> 32), low0=Word(product0);
+            Word high1=Word(product1 >> 32), low1=Word(product1);
+
+            counter[0]=high1 ^ counter[1] ^ roundKey[0];
+            counter[1]=low1;
+            counter[2]=high0 ^ counter[3] ^ roundKey[1];
+            counter[3]=low0;
+
+            roundKey[0]+=0x9E3779B9u;
+            roundKey[1]+=0xBB67AE85u;
+         }
+
+         for (int i=0; i < 4; i++)
+            out[i]=counter[i];
+      }
+
+      /** Four random words for the counter (index, step, draw, 0). */
+      void generate(Word index, Word step, Word draw, Word out[4]) const
+      {
+         generate(index, step, draw, 0, out);
+      }
+
+      /** Same, as four numbers uniform in [0, 1). */
+      void uniform(Word index, Word step, Word draw, Word event, double out[4]) const
+      {
+         Word words[4];
+         generate(index, step, draw, event, words);
+         for (int i=0; i < 4; i++)
+            out[i]=words[i] * (1.0 / 4294967296.0);
+      }
+
+      void uniform(Word index, Word step, Word draw, double out[4]) const
+      {
+         uniform(index, step, draw, 0, out);
+      }
+
+   private:
+      Word key[2];
+};
+
+/** Numbers the events that draw random numbers within one step: the first
+ *  event of a step is 0, the next 1, and so on. Events taken in the same
+ *  order at the same step get the same numbers, unlike a running count,
+ *  which depends on the steps at which earlier events landed.
+ */
+class StepEvents
+{
+   public:
+      StepEvents() :
+         step(0), count(0)
+      {
+      }
+
+      /** Number of the next event at step. */
+      CounterRng::Word next(CounterRng::Word step)
+      {
+         if (step != this->step)
+         {
+            this->step=step;
+            count=0;
+         }
+         return count++;
+      }
+
+   private:
+      CounterRng::Word step; ///< Step of the last event.
+      CounterRng::Word count; ///< Events so far at step.
+};
+
+} // namespace DTS
+
+#endif
@@ -29,6 +29,7 @@
 //
 #include "VruiStreamManip.h"
 #include "IO/ansi-color.h"
+#include "ColorMap/ColorMap.h"
 
 #include <string.h>
 
@@ -43,10 +44,13 @@ DataItem::DataItem(void)
    : hasPointParameterExtension(GLARBPointParameters::isSupported()),
    hasVertexBufferObjectExtension(GLARBVertexBufferObject::isSupported()),
    hasShaders(GLARBShaderObjects::isSupported()&&GLARBVertexShader::isSupported()&&GLARBFragmentShader::isSupported()),
-   vertexBufferId(0), spriteTextureObjectId(0), versionDS(0),
-   versionPS(0),
+   spriteTextureObjectId(0), gradientTextureObjectId(0), gradientColorMap(0),
+   dotSpreaderBuffer(0), dotSpreaderColorBuffer(0), particleSprayerBuffer(0),
+   dynamicSolverBuffer(0), dynamicSolverTrails(0), coloredSprayerVersion(0),
    vertexShaderObject(0),fragmentShaderObject(0),programObject(0),
-   numParticlesDS(0), numParticlesPS(0), tempDisplay(3)
+   tubeRenderer(0), sphereRenderer(0),
+   projectionVertexShaderObject(0),projectionProgramObject(0),
+   speedVertexShaderObject(0),speedFragmentShaderObject(0),speedProgramObject(0)
 {
    master::filter masterout(std::cout);
 
@@ -69,8 +73,12 @@ DataItem::DataItem(void)
       // initialize the vertex buffer object extension
       GLARBVertexBufferObject::initExtension();
 
-      // create a vertex buffer object
-      glGenBuffersARB(1,&vertexBufferId);
+      // create the streaming vertex buffers
+      dotSpreaderBuffer=new StreamingBuffer;
+      dotSpreaderColorBuffer=new StreamingBuffer;
+      particleSprayerBuffer=new StreamingBuffer;
+      dynamicSolverBuffer=new StreamingBuffer;
+      dynamicSolverTrails=new TrailBuffer;
 
       masterout() << ansi::green(ansi::BOLD) << "OK" << ansi::endl;
    }
@@ -79,7 +87,18 @@ DataItem::DataItem(void)
       masterout() << ansi::red(ansi::BOLD) << "NOT SUPPORTED" << ansi::endl;
    }
 
+   masterout() << "\tGL_ARB_BUFFER_STORAGE (persistent mapping) : ";
+   if (dotSpreaderBuffer && dotSpreaderBuffer->isPersistent())
+   {
+      masterout() << ansi::green(ansi::BOLD) << "OK" << ansi::endl;
+   }
+   else
+   {
+      masterout() << ansi::red(ansi::BOLD) << "NOT SUPPORTED" << ansi::endl;
+   }
+
    glGenTextures(1, &spriteTextureObjectId);
+   glGenTextures(1, &gradientTextureObjectId);
 
    masterout() << "\tGL_ARB_SHADER_OBJECTS : ";
    if(hasShaders)
@@ -107,6 +126,62 @@ DataItem::DataItem(void)
          gl_FrontColor=gl_Color; \
          gl_Position=ftransform(); \
          }";
+      /* Same, for particles given as (up to 8-dimensional) states in
+         gl_Vertex and gl_MultiTexCoord0, projected to model space: */
+      static const char* projectionVertexProgram="\
+         uniform float scaledParticleRadius; \
+         uniform mat4 projection0; \
+         uniform mat4 projection1; \
+         \
+         void main() \
+         { \
+         vec4 vertex,vertexEye; \
+         \
+         /* Project the state; the fourth rows of the matrices are zero: */ \
+         vertex=vec4((projection0*gl_Vertex+projection1*gl_MultiTexCoord0).xyz,1.0); \
+         \
+         /* Transform the vertex to eye coordinates: */ \
+         vertexEye=gl_ModelViewMatrix*vertex; \
+         \
+         /* Calculate point size based on vertex' eye distance along z direction: */ \
+         gl_PointSize=scaledParticleRadius*2.0*vertexEye.w/vertexEye.z; \
+         \
+         gl_FrontColor=gl_Color; \
+         gl_Position=gl_ModelViewProjectionMatrix*vertex; \
+         }";
+      /* Same, coloring the particle by the (squared) speed in gl_Vertex.w: */
+      static const char* speedVertexProgram="\
+         uniform float scaledParticleRadius; \
+         uniform float speedScale; \
+         \
+         varying float colorCoord; \
+         \
+         void main() \
+         { \
+         vec4 vertex,vertexEye; \
+         \
+         vertex=vec4(gl_Vertex.xyz,1.0); \
+         \
+         /* Transform the vertex to eye coordinates: */ \
+         vertexEye=gl_ModelViewMatrix*vertex; \
+         \
+         /* Calculate point size based on vertex' eye distance along z direction: */ \
+         gl_PointSize=scaledParticleRadius*2.0*vertexEye.w/vertexEye.z; \
+         \
+         /* Texel of the color map: speed relative to the maximum speed */ \
+         colorCoord=(min(sqrt(gl_Vertex.w*speedScale),1.0)*255.0+0.5)/256.0; \
+         gl_Position=gl_ModelViewProjectionMatrix*vertex; \
+         }";
+      static const char* speedFragmentProgram="\
+         uniform sampler2D tex0; \
+         uniform sampler1D colorMap; \
+         \
+         varying float colorCoord; \
+         \
+         void main() \
+         { \
+         gl_FragColor=texture2D(tex0,gl_TexCoord[0].xy)*vec4(texture1D(colorMap,colorCoord).rgb,1.0); \
+         }";
       static const char* fragmentProgram="\
          uniform sampler2D tex0; \
          \
@@ -121,6 +196,33 @@ DataItem::DataItem(void)
       programObject=glLinkShader(vertexShaderObject,fragmentShaderObject);
       scaledParticleRadiusLocation=glGetUniformLocationARB(programObject,"scaledParticleRadius");
       tex0Location=glGetUniformLocationARB(programObject,"tex0");
+
+      /* The projection shader shares the fragment shader: */
+      projectionVertexShaderObject=glCompileVertexShaderFromString(projectionVertexProgram);
+      projectionProgramObject=glLinkShader(projectionVertexShaderObject,fragmentShaderObject);
+      projectionScaledParticleRadiusLocation=glGetUniformLocationARB(projectionProgramObject,"scaledParticleRadius");
+      projectionTex0Location=glGetUniformLocationARB(projectionProgramObject,"tex0");
+      projectionMatrixLocations[0]=glGetUniformLocationARB(projectionProgramObject,"projection0");
+      projectionMatrixLocations[1]=glGetUniformLocationARB(projectionProgramObject,"projection1");
+
+      /* The speed shader reads the color map from texture unit 1: */
+      if(GLARBMultitexture::isSupported())
+      {
+         GLARBMultitexture::initExtension();
+         speedVertexShaderObject=glCompileVertexShaderFromString(speedVertexProgram);
+         speedFragmentShaderObject=glCompileFragmentShaderFromString(speedFragmentProgram);
+         speedProgramObject=glLinkShader(speedVertexShaderObject,speedFragmentShaderObject);
+         speedScaledParticleRadiusLocation=glGetUniformLocationARB(speedProgramObject,"scaledParticleRadius");
+         speedTex0Location=glGetUniformLocationARB(speedProgramObject,"tex0");
+         speedColorMapLocation=glGetUniformLocationARB(speedProgramObject,"colorMap");
+         speedScaleLocation=glGetUniformLocationARB(speedProgramObject,"speedScale");
+      }
+
+      /* Shader tubes replacing the GLE polyline cylinders: */
+      tubeRenderer=new TubeRenderer;
+
+      /* Sphere impostors replacing the icosahedron spheres: */
+      sphereRenderer=new SphereRenderer;
       masterout() << ansi::green(ansi::BOLD) << "OK" << ansi::endl;
    }
    else
@@ -138,25 +240,55 @@ DataItem::~DataItem(void)
 
     delete font;
 
-   if(vertexBufferId>0)
-   {
-      // delete the vertex buffer object
-      glDeleteBuffersARB(1,&vertexBufferId);
-   }
+   // delete the streaming vertex buffers
+   delete dotSpreaderBuffer;
+   delete dotSpreaderColorBuffer;
+   delete particleSprayerBuffer;
+   delete dynamicSolverBuffer;
+   delete dynamicSolverTrails;
 
    // delete texture object(s)
    glDeleteTextures(1, &spriteTextureObjectId);
+   glDeleteTextures(1, &gradientTextureObjectId);
 
    if(hasShaders)
    {
+      delete tubeRenderer;
+      delete sphereRenderer;
+      if(speedProgramObject)
+      {
+         glDeleteObjectARB(speedProgramObject);
+         glDeleteObjectARB(speedVertexShaderObject);
+         glDeleteObjectARB(speedFragmentShaderObject);
+      }
+      glDeleteObjectARB(projectionProgramObject);
+      glDeleteObjectARB(projectionVertexShaderObject);
       glDeleteObjectARB(programObject);
       glDeleteObjectARB(vertexShaderObject);
       glDeleteObjectARB(fragmentShaderObject);
    }
 
-   /* Display list for StaticSolverTool */
+   /* Display list and mesh buffers for StaticSolverTool */
    glDeleteLists(dataDisplayListId, 1);
+   for (MeshBufferMap::iterator it=staticSolverMeshes.begin(); it != staticSolverMeshes.end(); ++it)
+      glDeleteBuffersARB(1, &it->second.bufferId);
 
 }
 
+void DataItem::bindGradientTexture(const ColorMap* colorMap)
+{
+   glBindTexture(GL_TEXTURE_1D, gradientTextureObjectId);
+
+   // the texture holds the color map of one tool at a time
+   if (gradientColorMap != colorMap)
+   {
+      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, 256, 0, GL_RGB, GL_FLOAT,
+            colorMap->getColor(0));
+      gradientColorMap=colorMap;
+   }
+}
+
 } // namspace::DTS
@@ -20,6 +20,10 @@
 #ifndef DATA_ITEM_H
 #define DATA_ITEM_H
 
+#include <cstddef>
+#include <map>
+#include <vector>
+
 // Vrui includes
 //
 #include <GL/GLObject.h>
@@ -28,13 +32,20 @@
 #include <GL/Extensions/GLARBPointParameters.h>
 #include <GL/Extensions/GLARBVertexBufferObject.h>
 #include <GL/Extensions/GLARBShaderObjects.h>
+#include <GL/Extensions/GLARBMultitexture.h>
 
 // font rendering
 #include <FTGL/ftgl.h>
 
 // local Vector
 #include "Vector.h"
+#include "ColorPoint.h"
+#include "StreamingBuffer.h"
+#include "TrailBuffer.h"
+#include "TubeRenderer.h"
+#include "SphereRenderer.h"
 
+class ColorMap;
 
 
 namespace DTS
@@ -49,20 +60,40 @@ struct DataItem: public GLObject::DataItem
       bool hasVertexBufferObjectExtension; ///< GFlag whether VBOs are supported.
       bool hasShaders; ///< Flag whether local OpenGL supports GLSL shaders.
 
-      GLuint vertexBufferId; ///< Vertex object buffer ID.
       GLuint spriteTextureObjectId; ///< Texture object ID for point sprites.
+      GLuint gradientTextureObjectId; ///< 1D texture object ID for trail color gradients.
+      const ColorMap* gradientColorMap; ///< Color map currently loaded into the gradient texture.
+
+      /* Particle vertex uploads (0 without VBO support): */
+      StreamingBuffer* dotSpreaderBuffer; ///< Vertices of the dot spreader particles.
+      StreamingBuffer* dotSpreaderColorBuffer; ///< Colors of the dot spreader particles, for compact vertices.
+      StreamingBuffer* particleSprayerBuffer; ///< Vertices of the sprayed particles.
+      StreamingBuffer* dynamicSolverBuffer; ///< Frame cache of the dynamic solver.
+      TrailBuffer* dynamicSolverTrails; ///< Trail rings of the dynamic solver, patched per step.
 
-      ///< Used for syncing VOB rendering.
-      unsigned int versionDS;
-      unsigned int versionPS;
+      /* Sprayed particles colored on the CPU, for OpenGL without VBOs or the speed shader: */
+      std::vector<ColorPoint> coloredSprayerParticles;
+      unsigned int coloredSprayerVersion; ///< Snapshot version of coloredSprayerParticles (0 for none).
 
       /* State for vertex / fragment shaders: */
 
       GLhandleARB vertexShaderObject, fragmentShaderObject, programObject; ///< Shader for proper point size attenuation
       GLint scaledParticleRadiusLocation; ///< Location of particle radius uniform variable in shader program
       GLint tex0Location; ///< Location of texture sample uniform variable in shader program
-      int numParticlesDS; ///< Number of particles still alive at last step()
-      int numParticlesPS; ///< Number of particles still alive at last step()
+
+      TubeRenderer* tubeRenderer; ///< Shader tubes for polylines (0 without shaders).
+      SphereRenderer* sphereRenderer; ///< Sphere impostors (0 without shaders).
+
+      GLhandleARB projectionVertexShaderObject, projectionProgramObject; ///< Same, projecting unprojected states
+      GLint projectionScaledParticleRadiusLocation; ///< Location of particle radius uniform variable in projection shader program
+      GLint projectionTex0Location; ///< Location of texture sample uniform variable in projection shader program
+      GLint projectionMatrixLocations[2]; ///< Locations of the projection matrices (state components 0-3 and 4-7)
+
+      GLhandleARB speedVertexShaderObject, speedFragmentShaderObject, speedProgramObject; ///< Same, coloring particles by the speed in gl_Vertex.w (0 without multitexturing)
+      GLint speedScaledParticleRadiusLocation; ///< Location of particle radius uniform variable in speed shader program
+      GLint speedTex0Location; ///< Location of texture sample uniform variable in speed shader program
+      GLint speedColorMapLocation; ///< Location of the color map (gradient texture) sampler in speed shader program
+      GLint speedScaleLocation; ///< Location of the inverse maximum speed in speed shader program
 
 
       /* Variables for StaticSolverTool */
@@ -99,15 +130,33 @@ struct DataItem: public GLObject::DataItem
       GLuint dataDisplayListId;
       unsigned int dataDisplayListVersion;
 
+      /// Vertex buffer holding the mesh of one StaticSolverTool dataset.
+      struct MeshBuffer
+      {
+         GLuint bufferId;
+         size_t capacity; ///< Allocated size in bytes.
+         unsigned int version; ///< Mesh version of the buffer contents.
+         bool used; ///< Drawn this frame; buffers not drawn are deleted.
+
+         MeshBuffer() :
+            bufferId(0), capacity(0), version(0), used(false)
+         {
+         }
+      };
+      typedef std::map<unsigned int, MeshBuffer> MeshBufferMap;
+
+      MeshBufferMap staticSolverMeshes; ///< Mesh buffers by dataset id (empty without VBO support).
+
       // fonts
       FTFont* font;
 
-      // temporary vectors
-      Vector<double> tempDisplay;
-      Vector<double> temp;
-
       DataItem(void);
       virtual ~DataItem(void);
+
+      /** Binds the gradient texture to the active texture unit, loading
+       *  colorMap into it unless it holds that color map already.
+       */
+      void bindGradientTexture(const ColorMap* colorMap);
 };
 
 }
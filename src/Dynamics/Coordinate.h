@@ -51,9 +51,14 @@ public:
     typedef CoordinateType<ScalarParam> Coordinate;
     typedef std::vector<Coordinate> Coordinates;
 
+    CoordinateClass();
+
     std::vector<Coordinate> const& getCoords() const;
     virtual void printCoords() const;
 
+    // Index of the time coordinate (see addTimeCoordinate), or -1.
+    int getTimeCoordinate() const;
+
 protected:
 
     /*
@@ -62,9 +67,18 @@ protected:
     */
     void addCoordinate(Coordinate c);
 
+    /*
+        Same, for the coordinate of the autonomous time variable: its
+        derivative is 1 and no other derivative depends on it. Integrators
+        may then advance it analytically instead of integrating it, and
+        evaluateBatch may skip it. At most one coordinate is time.
+    */
+    void addTimeCoordinate(Coordinate c);
+
 private:
 
     Coordinates coords;
+    int timeCoordinate;
 
     // mapping from coordinate names to its index in 'coords'.
     Index coordIndex;
@@ -117,6 +131,12 @@ CoordinateType<ScalarParam>::CoordinateType(CoordinateType<SParam> const& coord)
 // CoordinateClass
 //
 
+template <typename ScalarParam>
+CoordinateClass<ScalarParam>::CoordinateClass()
+    : timeCoordinate(-1)
+{
+}
+
 template <typename ScalarParam>
 inline
 std::vector<CoordinateType<ScalarParam> > const& CoordinateClass<ScalarParam>::getCoords() const
@@ -129,6 +149,13 @@ void CoordinateClass<ScalarParam>::printCoords() const
 {
 }
 
+template <typename ScalarParam>
+inline
+int CoordinateClass<ScalarParam>::getTimeCoordinate() const
+{
+    return timeCoordinate;
+}
+
 template <typename ScalarParam>
 void CoordinateClass<ScalarParam>::addCoordinate( CoordinateType<ScalarParam> c)
 {
@@ -147,6 +174,13 @@ void CoordinateClass<ScalarParam>::addCoordinate( CoordinateType<ScalarParam> c)
     }
 }
 
+template <typename ScalarParam>
+void CoordinateClass<ScalarParam>::addTimeCoordinate( CoordinateType<ScalarParam> c)
+{
+    addCoordinate(c);
+    timeCoordinate = coordIndex[c.name];
+}
+
 
 
 #endif
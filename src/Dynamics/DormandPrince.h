@@ -0,0 +1,337 @@
+#ifndef DORMANDPRINCE_H
+#define DORMANDPRINCE_H
+
+#include <cmath>
+
+#include "Integrator.h"
+
+/*
+    Embedded Runge-Kutta 5(4) pair of Dormand and Prince with step size
+    control and dense output.
+
+    stepSize is the interval one call to step() advances a state, exactly
+    as for RungeKutta4. Within that interval the integrator takes as many
+    substeps as absTolerance and relTolerance require, so a smooth stretch
+    costs one substep and a sharp turn several. sampleTrajectory() keeps
+    its step size across samples and interpolates the samples from the
+    dense output, so it may take far fewer steps than there are samples.
+*/
+class DormandPrince : public Integrator<double>
+{
+private:
+
+    /* Elements: */
+
+    static const int NumStages = 7;
+
+    // Safeguards so a stiff or diverging state cannot stall the caller.
+    // Substeps no larger than a millionth of stepSize are accepted
+    // regardless of the error. Every substep, accepted or not, counts
+    // against MaxSubsteps; once it is reached, the rest of the interval is
+    // taken in one unchecked step. A state whose error is not finite (it
+    // has diverged) ends the call at once.
+    static const int MaxSubsteps = 1000; // per stepSize interval
+
+public:
+
+    /* Constructors and destructors: */
+
+    DormandPrince(const Model& model, Scalar stepSize=.01)
+    : Integrator<double>(model)
+    {
+        name = "rk45";
+
+        // stepSize must remain the first real parameter
+        addRealParameter( RealParameter("stepSize", stepSize, .0001, .2, .01, .0001) );
+        addRealParameter( RealParameter("absTolerance", 1e-6, 1e-9, 1e-3, 1e-6, 1e-9) );
+        addRealParameter( RealParameter("relTolerance", 1e-6, 1e-9, 1e-3, 1e-6, 1e-9) );
+
+        if (model.getDimension() == 0)
+            throw IntegratorException();
+    }
+
+    virtual ~DormandPrince()
+    {
+    }
+
+    /* Methods: */
+    using Integrator<double>::step;
+    using Integrator<double>::sampleTrajectory;
+
+    void step(Scalar const* v, Scalar* out, Context& context) const
+    {
+        Pin integratorPin(*this);
+        Pin modelPin(model);
+        Snapshot const& settings = getSnapshot();
+        Snapshot const& params = model.getSnapshot();
+        Scalar interval = settings.realValues[0];
+        Scalar atol = settings.realValues[1];
+        Scalar rtol = settings.realValues[2];
+
+        int dimension = model.getDimension();
+        Scalar* k = context.getScratch((NumStages + 2) * dimension);
+        Scalar* y = k + NumStages * dimension;
+        Scalar* yNew = y + dimension;
+
+        for (int i = 0; i < dimension; i++)
+            y[i] = v[i];
+        model.evaluate(y, k, params);
+
+        Scalar t = 0;
+        Scalar h = interval;
+        Scalar minStep = interval * Scalar(1e-6);
+        int substeps = 0;
+        bool last = false;
+
+        while (!last)
+        {
+            Scalar remaining = interval - t;
+            bool exhausted = ++substeps >= MaxSubsteps;
+            if (h >= remaining || exhausted)
+            {
+                h = remaining;
+                last = true;
+            }
+
+            Scalar err = attempt(y, h, k, yNew, atol, rtol, params);
+            if (!isFinite(err))
+            {
+                // diverged: hand the state on rather than shrink h further
+                for (int i = 0; i < dimension; i++)
+                    out[i] = yNew[i] - v[i];
+                return;
+            }
+            bool accept = err <= Scalar(1) || h <= minStep || exhausted;
+
+            if (accept)
+            {
+                t += h;
+                for (int i = 0; i < dimension; i++)
+                    y[i] = yNew[i];
+                // First same as last: the final stage is f(yNew)
+                for (int i = 0; i < dimension; i++)
+                    k[i] = k[(NumStages - 1) * dimension + i];
+            }
+            else
+            {
+                last = false;
+            }
+
+            h *= stepFactor(err, accept);
+            if (h < minStep)
+                h = minStep;
+        }
+
+        for (int i = 0; i < dimension; i++)
+            out[i] = y[i] - v[i];
+    }
+
+    void sampleTrajectory(Scalar const* start, Scalar* samples, size_t count,
+                          Context& context) const
+    {
+        if (count == 0)
+            return;
+
+        Pin integratorPin(*this);
+        Pin modelPin(model);
+        Snapshot const& settings = getSnapshot();
+        Snapshot const& params = model.getSnapshot();
+        Scalar interval = settings.realValues[0];
+        Scalar atol = settings.realValues[1];
+        Scalar rtol = settings.realValues[2];
+
+        int dimension = model.getDimension();
+        Scalar* k = context.getScratch((NumStages + 2) * dimension);
+        Scalar* y = k + NumStages * dimension;
+        Scalar* yNew = y + dimension;
+
+        for (int i = 0; i < dimension; i++)
+        {
+            y[i] = start[i];
+            samples[i] = start[i];
+        }
+        model.evaluate(y, k, params);
+
+        Scalar end = interval * Scalar(count - 1);
+        Scalar t = 0;
+        Scalar h = interval;
+        Scalar minStep = interval * Scalar(1e-6);
+        size_t next = 1; // next sample to write
+        size_t maxSubsteps = size_t(MaxSubsteps) * count;
+        size_t substeps = 0;
+
+        while (next < count)
+        {
+            bool last = false;
+            Scalar remaining = end - t;
+            bool exhausted = ++substeps >= maxSubsteps;
+            if (h >= remaining || exhausted)
+            {
+                h = remaining;
+                last = true;
+            }
+
+            Scalar err = attempt(y, h, k, yNew, atol, rtol, params);
+            if (!isFinite(err))
+            {
+                // diverged: the remaining samples repeat the state
+                for (; next < count; next++)
+                {
+                    for (int i = 0; i < dimension; i++)
+                        samples[next * dimension + i] = yNew[i];
+                }
+                return;
+            }
+            bool accept = err <= Scalar(1) || h <= minStep || exhausted;
+
+            if (accept)
+            {
+                Scalar tNew = t + h;
+
+                /* Interpolate the samples inside [t, tNew]: */
+                while (next < count
+                       && (last || interval * Scalar(next) <= tNew))
+                {
+                    Scalar theta = (interval * Scalar(next) - t) / h;
+                    if (theta > Scalar(1))
+                        theta = Scalar(1);
+                    interpolate(y, yNew, k, h, theta,
+                                samples + next * dimension);
+                    next++;
+                }
+
+                t = tNew;
+                for (int i = 0; i < dimension; i++)
+                    y[i] = yNew[i];
+                for (int i = 0; i < dimension; i++)
+                    k[i] = k[(NumStages - 1) * dimension + i];
+            }
+
+            h *= stepFactor(err, accept);
+            if (h < minStep)
+                h = minStep;
+        }
+    }
+
+private:
+
+    // Takes one step of size h from y, with k[0] = f(y) already computed.
+    // Fills the remaining stages (the last one is f(yNew)) and yNew, and
+    // returns the error estimate scaled by the tolerances: at most 1 means
+    // the step is acceptable.
+    Scalar attempt(Scalar const* y, Scalar h, Scalar* k, Scalar* yNew,
+                   Scalar atol, Scalar rtol, Snapshot const& params) const
+    {
+        static const Scalar a[NumStages - 1][NumStages - 1] =
+        {
+            { 1.0 / 5 },
+            { 3.0 / 40, 9.0 / 40 },
+            { 44.0 / 45, -56.0 / 15, 32.0 / 9 },
+            { 19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729 },
+            { 9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176,
+              -5103.0 / 18656 },
+            { 35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784,
+              11.0 / 84 }
+        };
+
+        // Difference between the 5th and the embedded 4th order solutions
+        static const Scalar e[NumStages] =
+        {
+            71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200,
+            22.0 / 525, -1.0 / 40
+        };
+
+        int dimension = model.getDimension();
+
+        /* Calculate the stages; the last row of a gives yNew itself: */
+        for (int s = 1; s < NumStages; s++)
+        {
+            for (int i = 0; i < dimension; i++)
+            {
+                Scalar sum = 0;
+                for (int j = 0; j < s; j++)
+                    sum += a[s - 1][j] * k[j * dimension + i];
+                yNew[i] = y[i] + h * sum;
+            }
+            model.evaluate(yNew, k + s * dimension, params);
+        }
+
+        /* Calculate the RMS norm of the scaled error: */
+        Scalar norm = 0;
+        for (int i = 0; i < dimension; i++)
+        {
+            Scalar error = 0;
+            for (int j = 0; j < NumStages; j++)
+                error += e[j] * k[j * dimension + i];
+            error *= h;
+
+            Scalar scale = std::fabs(y[i]);
+            if (std::fabs(yNew[i]) > scale)
+                scale = std::fabs(yNew[i]);
+            scale = atol + rtol * scale;
+
+            norm += (error / scale) * (error / scale);
+        }
+        return std::sqrt(norm / dimension);
+    }
+
+    // False for NaN and infinities
+    static bool isFinite(Scalar x)
+    {
+        return x - x == Scalar(0);
+    }
+
+    // Factor for the next step size given the error of the last attempt
+    static Scalar stepFactor(Scalar err, bool accepted)
+    {
+        Scalar factor;
+        if (err <= Scalar(0))
+            factor = Scalar(5);
+        else
+            factor = Scalar(0.9) * std::pow(err, Scalar(-0.2));
+
+        if (factor < Scalar(0.2))
+            factor = Scalar(0.2);
+        if (factor > Scalar(5))
+            factor = Scalar(5);
+        if (!accepted && factor > Scalar(1))
+            factor = Scalar(1);
+        return factor;
+    }
+
+    // Evaluates the dense output of the step from y0 to y1 of size h at
+    // y0 + theta * h, 0 <= theta <= 1. k holds the stages of that step.
+    void interpolate(Scalar const* y0, Scalar const* y1, Scalar const* k,
+                     Scalar h, Scalar theta, Scalar* out) const
+    {
+        static const Scalar d[NumStages] =
+        {
+            -12715105075.0 / 11282082432.0, 0,
+            87487479700.0 / 32700410799.0, -10690763975.0 / 1880347072.0,
+            701980252875.0 / 199316789632.0, -1453857185.0 / 822651844.0,
+            69997945.0 / 29380423.0
+        };
+
+        int dimension = model.getDimension();
+        Scalar theta1 = Scalar(1) - theta;
+
+        for (int i = 0; i < dimension; i++)
+        {
+            Scalar k0 = k[i];
+            Scalar k6 = k[(NumStages - 1) * dimension + i];
+
+            Scalar r1 = y1[i] - y0[i];
+            Scalar r2 = h * k0 - r1;
+            Scalar r3 = r1 - h * k6 - r2;
+            Scalar r4 = 0;
+            for (int j = 0; j < NumStages; j++)
+                r4 += d[j] * k[j * dimension + i];
+            r4 *= h;
+
+            out[i] = y0[i] + theta * (r1 + theta1 * (r2 + theta * (r3
+                     + theta1 * r4)));
+        }
+    }
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <cstddef>
 
 //
 // Project includes
@@ -31,6 +32,8 @@ public:
 
     typedef typename CoordinateClass<ScalarParam>::Coordinate Coordinate;
     typedef typename ParameterClass<ScalarParam>::RealParameter Parameter;
+    typedef typename ParameterClass<ScalarParam>::Snapshot Snapshot;
+    typedef typename ParameterClass<ScalarParam>::Pin Pin;
 
     /**
         After the constructor, the model is assumed fixed in the number of
@@ -52,6 +55,37 @@ public:
     Vector operator()(Vector const& x) const;
     virtual void operator()(Vector const& x, Vector & out) const = 0;
 
+    /*
+        Raw-pointer form of the functor. Both arrays hold getDimension()
+        scalars. This is what the integrators call, so models should override
+        it; the default implementation copies through temporary DTS::Vectors
+        and is only meant as a fallback (it reads the current parameters
+        rather than params).
+
+        params is a snapshot of the model parameters (see ParameterClass).
+        Integrators pin the model once and pass the same snapshot to every
+        evaluation of a step, so parameter changes never take effect halfway
+        through one. The form without params pins the model itself.
+    */
+    virtual void evaluate(Scalar const* x, Scalar* out,
+                          Snapshot const& params) const;
+    void evaluate(Scalar const* x, Scalar* out) const;
+
+    /*
+        Evaluate count points at once. Points are stored component-major:
+        component i of point j lives at x[i * stride + j], and out uses the
+        same layout; out must not overlap x. The default implementation
+        calls evaluate() per point. If the model has a time coordinate (see
+        CoordinateClass::addTimeCoordinate), that row of x holds the times
+        of the points, but that row of out may be left unwritten, since the
+        derivative is 1.
+    */
+    virtual void evaluateBatch(Scalar const* x, Scalar* out,
+                               size_t count, size_t stride,
+                               Snapshot const& params) const;
+    void evaluateBatch(Scalar const* x, Scalar* out,
+                       size_t count, size_t stride) const;
+
     Vector getDefaultPoint() const;
     // centerPoint and radius corresponds to the attractor at the defaultPoint    
     Vector getCenterPoint() const; 
@@ -101,6 +135,64 @@ DTS::Vector<ScalarParam> DynamicalModel<ScalarParam>::operator()(Vector const& p
     return out;
 }
 
+template <typename ScalarParam>
+void DynamicalModel<ScalarParam>::evaluate(Scalar const* x, Scalar* out,
+                                           Snapshot const&) const
+{
+    int dimension = getDimension();
+    Vector in(dimension);
+    Vector result(dimension);
+    for (int i = 0; i < dimension; i++)
+    {
+        in[i] = x[i];
+    }
+    this->operator()(in, result);
+    for (int i = 0; i < dimension; i++)
+    {
+        out[i] = result[i];
+    }
+}
+
+template <typename ScalarParam>
+inline
+void DynamicalModel<ScalarParam>::evaluate(Scalar const* x, Scalar* out) const
+{
+    Pin pin(*this);
+    evaluate(x, out, this->getSnapshot());
+}
+
+template <typename ScalarParam>
+void DynamicalModel<ScalarParam>::evaluateBatch(Scalar const* x, Scalar* out,
+                                                size_t count, size_t stride,
+                                                Snapshot const& params) const
+{
+    int dimension = getDimension();
+    std::vector<Scalar> p(dimension);
+    std::vector<Scalar> result(dimension);
+
+    for (size_t j = 0; j < count; j++)
+    {
+        for (int i = 0; i < dimension; i++)
+        {
+            p[i] = x[i * stride + j];
+        }
+        evaluate(&p[0], &result[0], params);
+        for (int i = 0; i < dimension; i++)
+        {
+            out[i * stride + j] = result[i];
+        }
+    }
+}
+
+template <typename ScalarParam>
+inline
+void DynamicalModel<ScalarParam>::evaluateBatch(Scalar const* x, Scalar* out,
+                                                size_t count, size_t stride) const
+{
+    Pin pin(*this);
+    evaluateBatch(x, out, count, stride, this->getSnapshot());
+}
+
 template <typename ScalarParam>
 DTS::Vector<ScalarParam> DynamicalModel<ScalarParam>::getDefaultPoint() const
 {
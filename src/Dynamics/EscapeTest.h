@@ -0,0 +1,121 @@
+#ifndef DTS_ESCAPE_TEST_H
+#define DTS_ESCAPE_TEST_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "DynamicalModel.h"
+
+
+namespace DTS {
+
+/**
+ * Finds particles whose states have escaped: left a box around the model's
+ * coordinate ranges, or become infinite or NaN.
+ *
+ * The box is the box of the coordinates' minValue/maxValue ranges, scaled
+ * about its center by a factor. The ranges only suggest where the dynamics
+ * happen, so the factor should leave room for transients. Coordinates with
+ * an infinite or empty range are only checked for finite values.
+ *
+ * The test runs over the structure-of-arrays layout of ParticleStateArena,
+ * one coordinate row at a time, so the inner loop is branch free:
+ *
+ *     test.setBounds(model, 10.0);
+ *     test.mark(arena.getData() + begin, end - begin, arena.getStride(),
+ *               &flags[begin]);
+ */
+template <typename ScalarParam>
+class EscapeTest
+{
+    public:
+    typedef ScalarParam Scalar;
+
+    private:
+    std::vector<Scalar> lower;
+    std::vector<Scalar> upper;
+
+    /* Constructors and destructors */
+    public:
+    EscapeTest();
+
+    /* Generic Methods */
+    int getDimension(void) const;
+    void setBounds(DynamicalModel<Scalar> const& model, Scalar factor);
+
+    /* Sets flags[j] to 1 for each escaped state j of count states whose
+       component i is first[i * stride + j]; leaves the others unchanged. */
+    void mark(Scalar const* first, size_t count, size_t stride,
+              unsigned char* flags) const;
+};
+
+
+/*******************
+ * Implementations *
+ *******************/
+
+/* Constructors and destructors */
+
+template <typename ScalarParam>
+EscapeTest<ScalarParam>::EscapeTest()
+{
+}
+
+/* Generic Methods */
+
+template <typename ScalarParam>
+inline
+int EscapeTest<ScalarParam>::getDimension(void) const
+{
+    return lower.size();
+}
+
+template <typename ScalarParam>
+void EscapeTest<ScalarParam>::setBounds(DynamicalModel<Scalar> const& model,
+                                        Scalar factor)
+{
+    typedef typename CoordinateClass<Scalar>::Coordinates Coords;
+    Coords const& coords = model.getCoords();
+
+    int dimension = model.getDimension();
+    lower.assign(dimension, -HUGE_VAL);
+    upper.assign(dimension, HUGE_VAL);
+
+    for (int i = 0; i < dimension && i < int(coords.size()); ++i)
+    {
+        Scalar center = (coords[i].minValue + coords[i].maxValue) / 2;
+        Scalar halfWidth = (coords[i].maxValue - coords[i].minValue) / 2;
+
+        // an infinite range gives a NaN center or width: no bounds
+        if (halfWidth > 0 && halfWidth - halfWidth == 0 && center - center == 0)
+        {
+            lower[i] = center - factor * halfWidth;
+            upper[i] = center + factor * halfWidth;
+        }
+    }
+}
+
+template <typename ScalarParam>
+void EscapeTest<ScalarParam>::mark(Scalar const* first, size_t count,
+                                   size_t stride, unsigned char* flags) const
+{
+    for (int i = 0; i < getDimension(); ++i)
+    {
+        Scalar const* row = first + i * stride;
+        Scalar low = lower[i];
+        Scalar high = upper[i];
+
+        // x - x is 0 for finite x only; NaN fails every comparison
+        for (size_t j = 0; j < count; ++j)
+        {
+            Scalar x = row[j];
+            bool inside = (x >= low) & (x <= high) & (x - x == 0);
+            flags[j] |= !inside;
+        }
+    }
+}
+
+} // namespace DTS
+
+#endif
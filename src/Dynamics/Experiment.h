@@ -2,6 +2,8 @@
 #define DTS_EXPERIMENT
 
 #include <exception>
+#include <string>
+#include <vector>
 
 #include <DynamicalModel.h>
 #include <Integrator.h>
@@ -110,6 +112,9 @@ public:
     
     void addIntegrator(Integrator<ScalarParam>*);
     void addTransformer(Transformer<ScalarParam>*);   
+
+    // Names accepted by setIntegrator, in alphabetical order
+    std::vector<std::string> getIntegratorNames() const;
     
     bool isOutdated();
     unsigned int updateVersion();
@@ -258,6 +263,19 @@ void Experiment<ScalarParam>::addIntegrator(Integrator<ScalarParam> *integrator)
     }
 }
 
+template <typename ScalarParam>
+std::vector<std::string> Experiment<ScalarParam>::getIntegratorNames() const
+{
+    std::vector<std::string> names;
+
+    typename IntegratorMap::const_iterator it;
+    for ( it = integrators.begin(); it != integrators.end(); it++ )
+    {
+        names.push_back(it->first);
+    }
+    return names;
+}
+
 template <typename ScalarParam>
 inline
 void Experiment<ScalarParam>::addTransformer(Transformer<ScalarParam> *transformer)
@@ -0,0 +1,98 @@
+#ifndef GENERIC_MODEL_H
+#define GENERIC_MODEL_H
+
+#include <cstddef>
+
+// Project includes
+//
+#include <DynamicalModel.h>
+#include <Pack.h>
+
+
+/*
+    Base class for models whose right-hand side is written once, generic
+    over the scalar type. The derived class provides its dimension and a
+    static template
+
+        static const int Dimension = 4;
+
+        template <class S>
+        static void rhs(S const* p, S* out, double const* params);
+
+    where params holds the real parameters in the order they were added,
+    taken from the parameter snapshot passed to evaluate/evaluateBatch.
+    GenericModel instantiates rhs with S = double for single points and with
+    S = DTS::Pack<double> to evaluate DTS_PACK_WIDTH points per call in
+    evaluateBatch. evaluateBatch loads the row of the time coordinate, if
+    the model declares one, so rhs sees the same t as in evaluate, but it
+    does not store the derivative of that row.
+*/
+template <typename Derived>
+class GenericModel : public DynamicalModel<double>
+{
+public:
+    typedef DTS::Pack<double> Pack;
+
+    GenericModel()
+    : DynamicalModel<double>()
+    {
+    }
+
+    virtual ~GenericModel() { }
+
+    using DynamicalModel<double>::evaluate;
+    using DynamicalModel<double>::evaluateBatch;
+
+    virtual void operator()(Vector const& p, Vector & out) const
+    {
+        evaluate(&p.getComponents()[0], &out.getComponents()[0]);
+    }
+
+    virtual void evaluate(Scalar const* p, Scalar* out,
+                          Snapshot const& snapshot) const
+    {
+        Derived::rhs(p, out, &snapshot.realValues[0]);
+    }
+
+    virtual void evaluateBatch(Scalar const* x, Scalar* out,
+                               size_t count, size_t stride,
+                               Snapshot const& snapshot) const
+    {
+        const int dimension = Derived::Dimension;
+        const int time = this->getTimeCoordinate();
+        double const* params = &snapshot.realValues[0];
+
+        Pack p[dimension];
+        Pack result[dimension];
+
+        size_t j = 0;
+        for (; j + Pack::width <= count; j += Pack::width)
+        {
+            for (int i = 0; i < dimension; i++)
+                p[i] = Pack::load(x + i * stride + j);
+
+            Derived::rhs(p, result, params);
+
+            for (int i = 0; i < dimension; i++)
+                if (i != time)
+                    result[i].store(out + i * stride + j);
+        }
+
+        // Remaining points one at a time
+        Scalar ps[dimension];
+        Scalar results[dimension];
+        for (; j < count; j++)
+        {
+            for (int i = 0; i < dimension; i++)
+                ps[i] = x[i * stride + j];
+
+            Derived::rhs(ps, results, params);
+
+            for (int i = 0; i < dimension; i++)
+                if (i != time)
+                    out[i * stride + j] = results[i];
+        }
+    }
+};
+
+#endif
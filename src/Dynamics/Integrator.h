@@ -1,13 +1,16 @@
 #ifndef INTEGRATOR_H
 #define INTEGRATOR_H
 
+#include <cstddef>
 #include <exception>
 #include <string>
 #include <iostream>
+#include <vector>
 
 // Project includes
 //
 #include <DynamicalModel.h>
+#include <IntegratorContext.h>
 #include <Parameter.h>
 
 
@@ -38,12 +41,64 @@ public:
     typedef typename Model::Parameter Parameter;
     typedef typename Model::Scalar Scalar;
     typedef typename Model::Vector Vector;
+    typedef IntegratorContext<ScalarParam> Context;
+    typedef typename ParameterClass<ScalarParam>::Snapshot Snapshot;
+    typedef typename ParameterClass<ScalarParam>::Pin Pin;
 
     Integrator(Model const& model);
     virtual ~Integrator();
 
+    /*
+        Compute the step (increment) for the state v. The caller adds the
+        result to v to advance it. Both arrays hold model.getDimension()
+        scalars.
+
+        Integrators implement the const form taking an IntegratorContext,
+        which holds all scratch storage. Threads that each pass their own
+        context may step with one integrator concurrently. The forms
+        without a context use a context owned by the integrator and are
+        meant for single-threaded callers.
+
+        Each call reads the integrator and model parameters once (see
+        ParameterClass::Pin), so a step or batch uses one consistent set of
+        parameters even while the user changes them.
+    */
+    virtual void step(Scalar const* v, Scalar* out, Context& context) const = 0;
+    void step(Vector const& v, Vector & out, Context& context) const;
+
     Vector step(Vector const& v);
-    virtual void step(Vector const& v, Vector & out) = 0;
+    void step(Vector const& v, Vector & out);
+    void step(Scalar const* v, Scalar* out);
+
+    /*
+        Advance count states at once. States are stored component-major:
+        component i of state j lives at in[i * stride + j], with
+        stride >= count. Unlike step(), out receives the advanced states
+        (v + step) rather than the increment, in the same layout. out may
+        be the same array as in.
+
+        The default implementation calls step() once per state. Integrators
+        should override it with loops over the whole batch.
+    */
+    virtual void stepBatch(Scalar const* in, Scalar* out,
+                           size_t count, size_t stride,
+                           Context& context) const;
+    void stepBatch(Scalar const* in, Scalar* out,
+                   size_t count, size_t stride);
+
+    /*
+        Sample the trajectory through start at count times spaced one
+        stepSize apart. samples receives count states one after the other
+        (state k at samples + k * dimension); the first is start itself.
+
+        The default implementation calls step() once per sample. Adaptive
+        integrators override it to take their own steps and interpolate
+        the states at the sample times.
+    */
+    virtual void sampleTrajectory(Scalar const* start, Scalar* samples,
+                                  size_t count, Context& context) const;
+    void sampleTrajectory(Scalar const* start, Scalar* samples,
+                          size_t count);
 
     std::string const& getName() const;
     void setName(std::string const& name);
@@ -58,6 +113,7 @@ protected:
 
 private:
     unsigned int version;
+    Context defaultContext; // for the forms without a context
 
 };
 
@@ -74,6 +130,15 @@ Integrator<ScalarParam>::~Integrator()
 {
 }
 
+template <typename ScalarParam>
+inline
+void Integrator<ScalarParam>::step(typename Integrator<ScalarParam>::Vector const& v,
+                                   typename Integrator<ScalarParam>::Vector & out,
+                                   Context& context) const
+{
+    step(&v.getComponents()[0], &out.getComponents()[0], context);
+}
+
 template <typename ScalarParam>
 typename Integrator<ScalarParam>::Vector
 Integrator<ScalarParam>::step(typename Integrator<ScalarParam>::Vector const& v)
@@ -83,6 +148,90 @@ Integrator<ScalarParam>::step(typename Integrator<ScalarParam>::Vector const& v)
     return out;
 }
 
+template <typename ScalarParam>
+inline
+void Integrator<ScalarParam>::step(typename Integrator<ScalarParam>::Vector const& v,
+                                   typename Integrator<ScalarParam>::Vector & out)
+{
+    step(&v.getComponents()[0], &out.getComponents()[0], defaultContext);
+}
+
+template <typename ScalarParam>
+inline
+void Integrator<ScalarParam>::step(Scalar const* v, Scalar* out)
+{
+    step(v, out, defaultContext);
+}
+
+template <typename ScalarParam>
+void Integrator<ScalarParam>::stepBatch(Scalar const* in, Scalar* out,
+                                        size_t count, size_t stride,
+                                        Context& context) const
+{
+    // Not in the context: step() may claim the context scratch itself
+    int dimension = model.getDimension();
+    std::vector<Scalar> v(dimension);
+    std::vector<Scalar> increment(dimension);
+
+    for (size_t j = 0; j < count; j++)
+    {
+        for (int i = 0; i < dimension; i++)
+        {
+            v[i] = in[i * stride + j];
+        }
+        step(&v[0], &increment[0], context);
+        for (int i = 0; i < dimension; i++)
+        {
+            out[i * stride + j] = v[i] + increment[i];
+        }
+    }
+}
+
+template <typename ScalarParam>
+inline
+void Integrator<ScalarParam>::stepBatch(Scalar const* in, Scalar* out,
+                                        size_t count, size_t stride)
+{
+    stepBatch(in, out, count, stride, defaultContext);
+}
+
+template <typename ScalarParam>
+void Integrator<ScalarParam>::sampleTrajectory(Scalar const* start,
+                                               Scalar* samples,
+                                               size_t count,
+                                               Context& context) const
+{
+    if (count == 0)
+        return;
+
+    int dimension = model.getDimension();
+    for (int i = 0; i < dimension; i++)
+    {
+        samples[i] = start[i];
+    }
+
+    // The step is computed straight into the next sample, then advanced
+    for (size_t k = 1; k < count; k++)
+    {
+        Scalar const* prev = samples + (k - 1) * dimension;
+        Scalar* next = samples + k * dimension;
+        step(prev, next, context);
+        for (int i = 0; i < dimension; i++)
+        {
+            next[i] += prev[i];
+        }
+    }
+}
+
+template <typename ScalarParam>
+inline
+void Integrator<ScalarParam>::sampleTrajectory(Scalar const* start,
+                                               Scalar* samples,
+                                               size_t count)
+{
+    sampleTrajectory(start, samples, count, defaultContext);
+}
+
 template <typename ScalarParam>
 inline
 std::string const& Integrator<ScalarParam>::getName() const
@@ -0,0 +1,41 @@
+#ifndef INTEGRATOR_CONTEXT_H
+#define INTEGRATOR_CONTEXT_H
+
+#include <cstddef>
+#include <vector>
+
+
+/*
+    Working storage for one thread stepping with an integrator.
+
+    Integrators keep no mutable state of their own: a step reads the model
+    and the integrator parameters, and everything else it needs lives in a
+    context supplied by the caller. Any number of threads may step states
+    with the same integrator at once, each with its own context. A context
+    is not tied to one integrator; its storage grows to the largest request.
+*/
+template <typename ScalarParam>
+class IntegratorContext
+{
+public:
+    typedef ScalarParam Scalar;
+
+    IntegratorContext()
+    {
+    }
+
+    // Storage for at least size scalars, valid until the next call
+    Scalar* getScratch(size_t size)
+    {
+        if (scratch.size() < size)
+        {
+            scratch.resize(size);
+        }
+        return &scratch[0];
+    }
+
+private:
+    std::vector<Scalar> scratch;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef DTS_PACK_H
+#define DTS_PACK_H
+
+#include <cstddef>
+
+
+// Number of doubles in the widest vector register the target supports.
+// Builds without -mavx / -mavx512f (see OPT in the Makefile) get SSE2 packs.
+#ifndef DTS_PACK_WIDTH
+#   if defined(__AVX512F__)
+#       define DTS_PACK_WIDTH 8
+#   elif defined(__AVX__)
+#       define DTS_PACK_WIDTH 4
+#   else
+#       define DTS_PACK_WIDTH 2
+#   endif
+#endif
+
+
+namespace DTS {
+
+/**
+ * A fixed number of scalars processed in lock step.
+ *
+ * Pack supports the arithmetic a model's right-hand side needs, so code
+ * written against a generic scalar type S evaluates one point with
+ * S = double and width points at once with S = Pack<double>. Each lane is
+ * computed exactly like the scalar code. The storage is a GCC vector type,
+ * which the compiler maps onto SSE/AVX/AVX-512 registers.
+ */
+template <typename ScalarParam, int widthParam = DTS_PACK_WIDTH>
+class Pack
+{
+    public:
+    typedef ScalarParam Scalar;
+    typedef ScalarParam Native __attribute__((vector_size(widthParam * sizeof(ScalarParam))));
+    static const int width = widthParam;
+
+    Native v;
+
+    /* Constructors */
+    Pack(void) // lanes are left uninitialized
+    {
+    }
+
+    Pack(Scalar value) // broadcast
+    {
+        for (int i = 0; i < widthParam; ++i)
+        {
+            v[i] = value;
+        }
+    }
+
+    explicit Pack(Native const& native)
+    : v(native)
+    {
+    }
+
+    /* Memory access (no alignment required) */
+    static Pack load(Scalar const* p)
+    {
+        Pack result;
+        __builtin_memcpy(&result.v, p, sizeof(Native));
+        return result;
+    }
+
+    void store(Scalar* p) const
+    {
+        __builtin_memcpy(p, &v, sizeof(Native));
+    }
+
+    Scalar operator[](int index) const
+    {
+        return v[index];
+    }
+
+    /* Math Methods */
+    Pack operator-(void) const { return Pack(-v); }
+    Pack& operator+=(Pack const& other) { v += other.v; return *this; }
+    Pack& operator-=(Pack const& other) { v -= other.v; return *this; }
+    Pack& operator*=(Pack const& other) { v *= other.v; return *this; }
+    Pack& operator/=(Pack const& other) { v /= other.v; return *this; }
+
+    // Defined as friends so that plain numbers (e.g. 10 * p[0]) convert.
+    friend Pack operator+(Pack const& a, Pack const& b) { return Pack(a.v + b.v); }
+    friend Pack operator-(Pack const& a, Pack const& b) { return Pack(a.v - b.v); }
+    friend Pack operator*(Pack const& a, Pack const& b) { return Pack(a.v * b.v); }
+    friend Pack operator/(Pack const& a, Pack const& b) { return Pack(a.v / b.v); }
+
+    friend Pack operator+(Scalar a, Pack const& b) { return Pack(a) + b; }
+    friend Pack operator-(Scalar a, Pack const& b) { return Pack(a) - b; }
+    friend Pack operator*(Scalar a, Pack const& b) { return Pack(a) * b; }
+    friend Pack operator/(Scalar a, Pack const& b) { return Pack(a) / b; }
+
+    friend Pack operator+(Pack const& a, Scalar b) { return a + Pack(b); }
+    friend Pack operator-(Pack const& a, Scalar b) { return a - Pack(b); }
+    friend Pack operator*(Pack const& a, Scalar b) { return a * Pack(b); }
+    friend Pack operator/(Pack const& a, Scalar b) { return a / Pack(b); }
+};
+
+} // end namespace DTS
+
+#endif
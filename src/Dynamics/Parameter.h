@@ -6,8 +6,12 @@
 #ifndef PARAMETER_H
 #define PARAMETER_H
 
+#include <sched.h>
+
+#include <cstddef>
 #include <exception>
 #include <string>
+#include <vector>
 
 // This line causes problems when the file is included.
 typedef std::map< std::string, unsigned int > Index;
@@ -69,6 +73,30 @@ struct ParameterType
     void validate(Scalar v);
 };
 
+//
+// ParameterSnapshot
+//
+
+/*
+    The values of all parameters of a ParameterClass at one moment. A
+    published snapshot is never modified: setting a parameter publishes a
+    new snapshot with a higher version, and the old one is deleted once no
+    reader can still be using it.
+*/
+template <typename RealParam>
+struct ParameterSnapshot
+{
+    unsigned int version;
+    std::vector<bool> boolValues;
+    std::vector<int> intValues;
+    std::vector<RealParam> realValues;
+
+    ParameterSnapshot()
+        : version(0)
+    {
+    }
+};
+
 //
 // ParameterClass
 //
@@ -79,6 +107,74 @@ class ParameterClass
 
 public:
 
+    typedef ParameterSnapshot<RealParam> Snapshot;
+
+    /*
+        Parameters are set from one thread at a time; in the viewer that is
+        the simulation thread, between steps (see SimulationQueue). Any
+        other thread that reads parameter values, the user interface
+        included, must hold a Pin on the object for as long as it uses them. Pinning costs two atomic operations and
+        never blocks, so stepping code pins once per batch rather than once
+        per point. A snapshot that was current while a Pin was held is not
+        deleted before the Pin is released.
+
+        Pins are counted per generation (see reclaim): a Pin joins the
+        counter of the generation current when it is taken. If the
+        generation moves on while it joins, it tries again with the new one.
+    */
+    class Pin
+    {
+    public:
+        explicit Pin(ParameterClass const& owner)
+            : owner(owner)
+        {
+            for (;;)
+            {
+                parity = owner.generation & 1;
+                // Full barrier: the count is visible before we check the
+                // generation again and before we load the current pointer
+                __sync_fetch_and_add(&owner.readers[parity], 1);
+                if ((owner.generation & 1) == parity)
+                    break;
+                __sync_fetch_and_sub(&owner.readers[parity], 1);
+            }
+        }
+
+        ~Pin()
+        {
+            __sync_fetch_and_sub(&owner.readers[parity], 1);
+        }
+
+    private:
+        ParameterClass const& owner;
+        unsigned int parity;
+
+        Pin(Pin const&);
+        Pin& operator=(Pin const&);
+    };
+
+    ParameterClass();
+    ParameterClass(ParameterClass const& other);
+    ParameterClass& operator=(ParameterClass const& other);
+    virtual ~ParameterClass();
+
+    /*
+        The most recently published values. The reference stays valid while
+        the caller holds a Pin, or until the next change when called from
+        the thread that sets parameters. All values in one snapshot belong
+        together, so read a snapshot once and use it for a whole computation.
+    */
+    Snapshot const& getSnapshot() const;
+
+    /*
+        Number of replaced snapshots not yet deleted or reused. A change
+        that would leave more than MaxRetired waits until the Pins of the
+        previous generation are released. Pins are short, so this only
+        happens when a reader was preempted while changes kept coming.
+    */
+    static const size_t MaxRetired = 32;
+    size_t getNumRetired() const;
+
     typedef ParameterType<bool> BoolParameter;    
     typedef ParameterType<int> IntParameter;
     typedef ParameterType<RealParam> RealParameter;
@@ -110,23 +206,11 @@ public:
 
 protected:
 
-    /*
-        We store the current parameter values in a vector for quick lookup.
-        The API guaranetees that this remains consistent whenever there is
-        a change to a parameter value via _setParamValue. This vector should
-        never be modified directly, and always accessed in a read-only manner.
-
-        The reasoning behind this is that we will call the functor methods
-        frequently, and they require access to the current parameter values.
-        Thus, we provide optimized access to the parameter values.
-    */
-    std::vector<bool> boolParamValues;    
-    std::vector<int> intParamValues;    
-    std::vector<RealParam> realParamValues;
-
     /*
         Use this during construction. It will make sure the various private
-        members relating to parameters are consistent.
+        members relating to parameters are consistent. Parameters are added
+        to the current snapshot in place, so this must not be called once
+        other threads can read the parameters.
     */
     // We could just overload addParameter() but then the API is strange.    
     void addBoolParameter(BoolParameter p);    
@@ -158,9 +242,40 @@ private:
     Index intParamIndex;
     Index realParamIndex;
 
+    /*
+        The current parameter values, in a snapshot for quick lookup by
+        index. The functor methods are called frequently and need the
+        values, so we provide optimized access to them. A change copies
+        the snapshot, modifies the copy and publishes it by swapping the
+        pointer; readers never see a partially updated set.
+    */
+    Snapshot* volatile current;
+
+    /*
+        Pins held, by generation parity (changed atomically). The generation
+        only moves on when no Pin of the generation before the current one
+        is held, so every held Pin belongs to the current generation or the
+        one before it, and the two never share a counter.
+    */
+    mutable volatile unsigned int readers[2];
+    volatile unsigned int generation;
+
+    // Snapshots replaced in the current generation, and in the one before.
+    // Pins of both generations may still be using them. A setter must not
+    // hold a Pin on the object itself, or it may wait for its own Pin.
+    std::vector<Snapshot*> retiring;
+    std::vector<Snapshot*> retired;
+
+    // Deleted snapshots kept for reuse, so that changes do not allocate
+    std::vector<Snapshot*> spare;
+
     void _setBoolParamValue(std::string const& name, bool const value);
     void _setIntParamValue(std::string const& name, int const value);
     void _setRealParamValue(std::string const& name, RealParam const value);        
+
+    Snapshot* copyCurrent();
+    void publish(Snapshot* next);
+    void reclaim();
 };
 
 
@@ -230,6 +345,74 @@ void ParameterType<ScalarParam>::validate(Scalar v)
 // ParameterClass
 //
 
+template <typename RealParam>
+ParameterClass<RealParam>::ParameterClass()
+    : current(new Snapshot),
+      generation(0)
+{
+    readers[0] = 0;
+    readers[1] = 0;
+}
+
+template <typename RealParam>
+ParameterClass<RealParam>::ParameterClass(ParameterClass const& other)
+    : boolParams(other.boolParams),
+      intParams(other.intParams),
+      realParams(other.realParams),
+      boolParamIndex(other.boolParamIndex),
+      intParamIndex(other.intParamIndex),
+      realParamIndex(other.realParamIndex),
+      current(new Snapshot(*other.current)),
+      generation(0)
+{
+    readers[0] = 0;
+    readers[1] = 0;
+}
+
+template <typename RealParam>
+ParameterClass<RealParam>& ParameterClass<RealParam>::operator=(ParameterClass const& other)
+{
+    if (this != &other)
+    {
+        boolParams = other.boolParams;
+        intParams = other.intParams;
+        realParams = other.realParams;
+        boolParamIndex = other.boolParamIndex;
+        intParamIndex = other.intParamIndex;
+        realParamIndex = other.realParamIndex;
+        Snapshot* next = copyCurrent();
+        *next = *other.current;
+        publish(next);
+    }
+    return *this;
+}
+
+template <typename RealParam>
+ParameterClass<RealParam>::~ParameterClass()
+{
+    // nobody may hold a Pin on an object being destroyed
+    delete current;
+    for (size_t i = 0; i < retiring.size(); i++)
+    {
+        delete retiring[i];
+    }
+    for (size_t i = 0; i < retired.size(); i++)
+    {
+        delete retired[i];
+    }
+    for (size_t i = 0; i < spare.size(); i++)
+    {
+        delete spare[i];
+    }
+}
+
+template <typename RealParam>
+inline
+ParameterSnapshot<RealParam> const& ParameterClass<RealParam>::getSnapshot() const
+{
+    return *current;
+}
+
 template <typename RealParam>
 inline
 std::vector<ParameterType<bool> > const& ParameterClass<RealParam>::getBoolParams() const
@@ -260,7 +443,7 @@ bool ParameterClass<RealParam>::getBoolParamValue(std::string const& name) const
     Index::const_iterator it;
     it = boolParamIndex.find( name );
     unsigned int index = it->second;
-    return boolParamValues[index];
+    return current->boolValues[index];
 }
 
 template <typename RealParam>
@@ -270,7 +453,7 @@ int ParameterClass<RealParam>::getIntParamValue(std::string const& name) const
     Index::const_iterator it;
     it = intParamIndex.find( name );
     unsigned int index = it->second;
-    return intParamValues[index];
+    return current->intValues[index];
 }
 
 template <typename RealParam>
@@ -280,7 +463,7 @@ RealParam ParameterClass<RealParam>::getRealParamValue(std::string const& name)
     Index::const_iterator it;
     it = realParamIndex.find( name );
     unsigned int index = it->second;
-    return realParamValues[index];
+    return current->realValues[index];
 }
 
 
@@ -386,13 +569,13 @@ void ParameterClass<RealParam>::addBoolParameter( BoolParameter p)
         // Add new parameter
         boolParamIndex[p.name] = boolParams.size();
         boolParams.push_back(p);
-        boolParamValues.push_back(p.value);
+        current->boolValues.push_back(p.value);
     }
     else
     {
         // Replace existing parameter
         boolParams[it->second] = p;
-        boolParamValues[it->second] = p.value;
+        current->boolValues[it->second] = p.value;
     }
 }
 
@@ -406,13 +589,13 @@ void ParameterClass<RealParam>::addIntParameter( IntParameter p)
         // Add new parameter
         intParamIndex[p.name] = intParams.size();
         intParams.push_back(p);
-        intParamValues.push_back(p.value);
+        current->intValues.push_back(p.value);
     }
     else
     {
         // Replace existing parameter
         intParams[it->second] = p;
-        intParamValues[it->second] = p.value;
+        current->intValues[it->second] = p.value;
     }
 }
 
@@ -426,13 +609,13 @@ void ParameterClass<RealParam>::addRealParameter( RealParameter p)
         // Add new parameter
         realParamIndex[p.name] = realParams.size();
         realParams.push_back(p);
-        realParamValues.push_back(p.value);
+        current->realValues.push_back(p.value);
     }
     else
     {
         // Replace existing parameter
         realParams[it->second] = p;
-        realParamValues[it->second] = p.value;
+        current->realValues[it->second] = p.value;
     }
 }
 
@@ -448,7 +631,10 @@ void ParameterClass<RealParam>::_setBoolParamValue(std::string const& name, bool
     {
         //boolParams[it->second].validate(value);
         boolParams[it->second].value = value;
-        boolParamValues[it->second] = value;
+
+        Snapshot* next = copyCurrent();
+        next->boolValues[it->second] = value;
+        publish(next);
     }
 }
 
@@ -461,7 +647,10 @@ void ParameterClass<RealParam>::_setIntParamValue(std::string const& name, int c
     {
         //intParams[it->second].validate(value);    
         intParams[it->second].value = value;
-        intParamValues[it->second] = value;
+
+        Snapshot* next = copyCurrent();
+        next->intValues[it->second] = value;
+        publish(next);
     }
 }
 
@@ -474,8 +663,82 @@ void ParameterClass<RealParam>::_setRealParamValue(std::string const& name, Real
     {
         //realParams[it->second].validate(value);
         realParams[it->second].value = value;
-        realParamValues[it->second] = value; 
+
+        Snapshot* next = copyCurrent();
+        next->realValues[it->second] = value;
+        publish(next);
+    }
+}
+
+
+
+
+template <typename RealParam>
+ParameterSnapshot<RealParam>* ParameterClass<RealParam>::copyCurrent()
+{
+    // A spare snapshot has the sizes of the current one, so the copy does
+    // not allocate
+    if (spare.empty())
+    {
+        return new Snapshot(*current);
     }
+    Snapshot* next = spare.back();
+    spare.pop_back();
+    *next = *current;
+    return next;
+}
+
+template <typename RealParam>
+void ParameterClass<RealParam>::publish(Snapshot* next)
+{
+    Snapshot* previous = current;
+    next->version = previous->version + 1;
+
+    // Full barrier: the snapshot is complete before the pointer changes,
+    // and the new pointer is visible before we look at the readers.
+    __sync_bool_compare_and_swap(&current, previous, next);
+    retiring.push_back(previous);
+    reclaim();
+}
+
+template <typename RealParam>
+void ParameterClass<RealParam>::reclaim()
+{
+    /*
+        A Pin is taken before the current pointer is loaded, so a snapshot
+        replaced in generation g can only be in use by Pins of generation g
+        or earlier. Moving to generation g + 1 requires that no Pin of
+        generation g - 1 is held (new Pins will share its counter). Once
+        that holds, the snapshots replaced in generation g - 1 are unused.
+
+        Pins are short, so the previous generation normally drains within
+        one batch of the stepping threads, and each change reclaims what
+        the change before it replaced. Otherwise up to MaxRetired snapshots
+        wait for a later change.
+    */
+    unsigned int previous = (generation + 1) & 1;
+    while (__sync_fetch_and_add(&readers[previous], 0) != 0)
+    {
+        if (getNumRetired() < MaxRetired)
+        {
+            return;
+        }
+        sched_yield();
+    }
+
+    spare.insert(spare.end(), retired.begin(), retired.end());
+    retired.swap(retiring);
+    retiring.clear();
+
+    // Full barrier: the lists are updated before new Pins can join the
+    // counter of the generation just reclaimed
+    __sync_fetch_and_add(&generation, 1);
+}
+
+template <typename RealParam>
+size_t ParameterClass<RealParam>::getNumRetired() const
+{
+    return retiring.size() + retired.size();
 }
 
 
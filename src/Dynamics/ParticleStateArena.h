@@ -0,0 +1,397 @@
+#ifndef DTS_PARTICLE_STATE_ARENA_H
+#define DTS_PARTICLE_STATE_ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "Vector.h"
+
+
+namespace DTS {
+
+/**
+ * Storage for the states of many particles in structure-of-arrays layout.
+ *
+ * All states share one 64-byte aligned block holding one row per coordinate:
+ * component i of state j lives at getData()[i * getStride() + j]. This is the
+ * layout Integrator::stepBatch expects, so a whole arena can be advanced in
+ * place with a single call:
+ *
+ *     integrator->stepBatch(arena.getData(), arena.getData(),
+ *                           arena.size(), arena.getStride());
+ *
+ * The stride is the capacity rounded up to a multiple of 64 bytes, so every
+ * row starts on a cache line. Removing a state moves the last state into its
+ * slot, so indices are not stable across swapRemove().
+ */
+template <typename ScalarParam>
+class ParticleStateArena
+{
+    public:
+    typedef ScalarParam Scalar;
+    typedef DTS::Vector<ScalarParam> State;
+
+    static const size_t Alignment = 64;
+
+    private:
+    int dimension;
+    size_t count;
+    size_t stride;
+    Scalar* data;
+
+    /* Constructors and destructors */
+    public:
+    explicit ParticleStateArena(int dimension = 0);
+    ParticleStateArena(ParticleStateArena const& other);
+    ~ParticleStateArena();
+
+    ParticleStateArena& operator=(ParticleStateArena const& other);
+
+    /* Generic Methods */
+    int getDimension(void) const;
+    void setDimension(int dimension); // also removes all states
+
+    size_t size(void) const;
+    bool empty(void) const;
+    size_t getStride(void) const;
+
+    void reserve(size_t capacity);
+    void resize(size_t newCount); // new states are zero
+    void clear(void);
+
+    Scalar* getData(void);
+    Scalar const* getData(void) const;
+    Scalar* getComponent(int component); // row of one coordinate
+    Scalar const* getComponent(int component) const;
+
+    Scalar operator()(size_t index, int component) const;
+    Scalar& operator()(size_t index, int component);
+
+    void getState(size_t index, State& state) const;
+    void setState(size_t index, State const& state);
+    void setState(size_t index, Scalar const* state);
+
+    /* Adding and removing states */
+    size_t append(State const& state); // returns index of the new state
+    size_t append(Scalar const* state);
+    size_t append(size_t n, State const& state); // n copies, returns first index
+    void swapRemove(size_t index);
+
+    private:
+    static Scalar* allocate(int dimension, size_t stride);
+    static size_t roundStride(size_t capacity);
+    void grow(size_t minCapacity);
+};
+
+
+/*******************
+ * Implementations *
+ *******************/
+
+/* Constructors and destructors */
+
+template <typename ScalarParam>
+ParticleStateArena<ScalarParam>::ParticleStateArena(int dimension)
+: dimension(dimension),
+  count(0),
+  stride(0),
+  data(0)
+{
+}
+
+template <typename ScalarParam>
+ParticleStateArena<ScalarParam>::ParticleStateArena(ParticleStateArena const& other)
+: dimension(other.dimension),
+  count(0),
+  stride(0),
+  data(0)
+{
+    *this = other;
+}
+
+template <typename ScalarParam>
+ParticleStateArena<ScalarParam>::~ParticleStateArena()
+{
+    std::free(data);
+}
+
+template <typename ScalarParam>
+ParticleStateArena<ScalarParam>&
+ParticleStateArena<ScalarParam>::operator=(ParticleStateArena const& other)
+{
+    if (this != &other)
+    {
+        setDimension(other.dimension);
+        reserve(other.count);
+        for (int i = 0; i < dimension && other.count > 0; ++i)
+        {
+            std::memcpy(getComponent(i), other.getComponent(i),
+                        other.count * sizeof(Scalar));
+        }
+        count = other.count;
+    }
+    return *this;
+}
+
+/* Generic Methods */
+
+template <typename ScalarParam>
+inline
+int ParticleStateArena<ScalarParam>::getDimension(void) const
+{
+    return dimension;
+}
+
+template <typename ScalarParam>
+void ParticleStateArena<ScalarParam>::setDimension(int newDimension)
+{
+    std::free(data);
+    data = 0;
+    dimension = newDimension;
+    count = 0;
+    stride = 0;
+}
+
+template <typename ScalarParam>
+inline
+size_t ParticleStateArena<ScalarParam>::size(void) const
+{
+    return count;
+}
+
+template <typename ScalarParam>
+inline
+bool ParticleStateArena<ScalarParam>::empty(void) const
+{
+    return count == 0;
+}
+
+template <typename ScalarParam>
+inline
+size_t ParticleStateArena<ScalarParam>::getStride(void) const
+{
+    return stride;
+}
+
+template <typename ScalarParam>
+void ParticleStateArena<ScalarParam>::reserve(size_t capacity)
+{
+    if (capacity <= stride)
+    {
+        return;
+    }
+
+    size_t newStride = roundStride(capacity);
+    Scalar* newData = allocate(dimension, newStride);
+    for (int i = 0; i < dimension && count > 0; ++i)
+    {
+        std::memcpy(newData + i * newStride, data + i * stride,
+                    count * sizeof(Scalar));
+    }
+
+    std::free(data);
+    data = newData;
+    stride = newStride;
+}
+
+template <typename ScalarParam>
+void ParticleStateArena<ScalarParam>::resize(size_t newCount)
+{
+    if (newCount > stride)
+    {
+        grow(newCount);
+    }
+    for (int i = 0; i < dimension; ++i)
+    {
+        Scalar* row = getComponent(i);
+        for (size_t j = count; j < newCount; ++j)
+        {
+            row[j] = Scalar(0);
+        }
+    }
+    count = newCount;
+}
+
+template <typename ScalarParam>
+inline
+void ParticleStateArena<ScalarParam>::clear(void)
+{
+    count = 0;
+}
+
+template <typename ScalarParam>
+inline
+ScalarParam* ParticleStateArena<ScalarParam>::getData(void)
+{
+    return data;
+}
+
+template <typename ScalarParam>
+inline
+ScalarParam const* ParticleStateArena<ScalarParam>::getData(void) const
+{
+    return data;
+}
+
+template <typename ScalarParam>
+inline
+ScalarParam* ParticleStateArena<ScalarParam>::getComponent(int component)
+{
+    return data + component * stride;
+}
+
+template <typename ScalarParam>
+inline
+ScalarParam const* ParticleStateArena<ScalarParam>::getComponent(int component) const
+{
+    return data + component * stride;
+}
+
+template <typename ScalarParam>
+inline
+ScalarParam ParticleStateArena<ScalarParam>::operator()(size_t index, int component) const
+{
+    return data[component * stride + index];
+}
+
+template <typename ScalarParam>
+inline
+ScalarParam& ParticleStateArena<ScalarParam>::operator()(size_t index, int component)
+{
+    return data[component * stride + index];
+}
+
+template <typename ScalarParam>
+inline
+void ParticleStateArena<ScalarParam>::getState(size_t index, State& state) const
+{
+    for (int i = 0; i < dimension; ++i)
+    {
+        state[i] = data[i * stride + index];
+    }
+}
+
+template <typename ScalarParam>
+inline
+void ParticleStateArena<ScalarParam>::setState(size_t index, State const& state)
+{
+    for (int i = 0; i < dimension; ++i)
+    {
+        data[i * stride + index] = state[i];
+    }
+}
+
+template <typename ScalarParam>
+inline
+void ParticleStateArena<ScalarParam>::setState(size_t index, Scalar const* state)
+{
+    for (int i = 0; i < dimension; ++i)
+    {
+        data[i * stride + index] = state[i];
+    }
+}
+
+/* Adding and removing states */
+
+template <typename ScalarParam>
+inline
+size_t ParticleStateArena<ScalarParam>::append(State const& state)
+{
+    if (count == stride)
+    {
+        grow(count + 1);
+    }
+    setState(count, state);
+    return count++;
+}
+
+template <typename ScalarParam>
+inline
+size_t ParticleStateArena<ScalarParam>::append(Scalar const* state)
+{
+    if (count == stride)
+    {
+        grow(count + 1);
+    }
+    setState(count, state);
+    return count++;
+}
+
+template <typename ScalarParam>
+size_t ParticleStateArena<ScalarParam>::append(size_t n, State const& state)
+{
+    size_t first = count;
+    if (count + n > stride)
+    {
+        grow(count + n);
+    }
+    for (int i = 0; i < dimension; ++i)
+    {
+        Scalar* row = getComponent(i);
+        Scalar value = state[i];
+        for (size_t j = first; j < first + n; ++j)
+        {
+            row[j] = value;
+        }
+    }
+    count += n;
+    return first;
+}
+
+template <typename ScalarParam>
+inline
+void ParticleStateArena<ScalarParam>::swapRemove(size_t index)
+{
+    --count;
+    if (index != count)
+    {
+        for (int i = 0; i < dimension; ++i)
+        {
+            data[i * stride + index] = data[i * stride + count];
+        }
+    }
+}
+
+/* Private methods */
+
+template <typename ScalarParam>
+ScalarParam* ParticleStateArena<ScalarParam>::allocate(int dimension, size_t stride)
+{
+    void* block = 0;
+    size_t bytes = dimension * stride * sizeof(Scalar);
+    if (bytes == 0)
+    {
+        return 0;
+    }
+    if (posix_memalign(&block, Alignment, bytes) != 0)
+    {
+        throw std::bad_alloc();
+    }
+    return static_cast<Scalar*>(block);
+}
+
+template <typename ScalarParam>
+inline
+size_t ParticleStateArena<ScalarParam>::roundStride(size_t capacity)
+{
+    size_t perLine = Alignment / sizeof(Scalar);
+    return (capacity + perLine - 1) / perLine * perLine;
+}
+
+template <typename ScalarParam>
+inline
+void ParticleStateArena<ScalarParam>::grow(size_t minCapacity)
+{
+    size_t capacity = 2 * stride;
+    if (capacity < minCapacity)
+    {
+        capacity = minCapacity;
+    }
+    reserve(capacity);
+}
+
+} // end namespace DTS
+
+#endif
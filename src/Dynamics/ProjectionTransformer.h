@@ -26,6 +26,8 @@ public:
     virtual void invTransform(Geometry::Vector<ScalarParam,3> const& v,
                               typename DynamicalModel<ScalarParam>::Vector & out) const;
 
+    virtual bool getProjection(typename DynamicalModel<ScalarParam>::Scalar* matrix) const;
+
     virtual typename DynamicalModel<ScalarParam>::Scalar getRadius(void) const;
 
     // necessary to find overloaded version
@@ -74,9 +76,10 @@ void ProjectionTransformer<ScalarParam>::transform(typename DynamicalModel<Scala
                                                    typename DynamicalModel<ScalarParam>::Vector & out) const
 {
     // A value of -1 means it will be mapped to the value 0.
-    int const& xIndex = this->intParamValues[0];
-    int const& yIndex = this->intParamValues[1];
-    int const& zIndex = this->intParamValues[2];
+    typename ParameterClass<ScalarParam>::Snapshot const& params = this->getSnapshot();
+    int const xIndex = params.intValues[0];
+    int const yIndex = params.intValues[1];
+    int const zIndex = params.intValues[2];
 
     out[0] = ( xIndex == -1 ? 0 : v[ xIndex ] );
     out[1] = ( yIndex == -1 ? 0 : v[ yIndex ] );
@@ -88,9 +91,10 @@ void ProjectionTransformer<ScalarParam>::invTransform(typename DynamicalModel<Sc
                                                       typename DynamicalModel<ScalarParam>::Vector & out) const
 {
     // A value of -1 means it will be mapped to the value 0.
-    int const& xIndex = this->intParamValues[0];
-    int const& yIndex = this->intParamValues[1];
-    int const& zIndex = this->intParamValues[2];
+    typename ParameterClass<ScalarParam>::Snapshot const& params = this->getSnapshot();
+    int const xIndex = params.intValues[0];
+    int const yIndex = params.intValues[1];
+    int const zIndex = params.intValues[2];
 
     if (xIndex > -1) out[xIndex] = v[0];
     if (yIndex > -1) out[yIndex] = v[1];
@@ -113,9 +117,10 @@ void ProjectionTransformer<ScalarParam>::transform(typename DynamicalModel<Scala
                                                    Geometry::Vector<ScalarParam, 3> & out) const
 {
     // A value of -1 means it will be mapped to the value 0.
-    int const& xIndex = this->intParamValues[0];
-    int const& yIndex = this->intParamValues[1];
-    int const& zIndex = this->intParamValues[2];
+    typename ParameterClass<ScalarParam>::Snapshot const& params = this->getSnapshot();
+    int const xIndex = params.intValues[0];
+    int const yIndex = params.intValues[1];
+    int const zIndex = params.intValues[2];
 
     out[0] = ( xIndex == -1 ? 0 : v[ xIndex ] );
     out[1] = ( yIndex == -1 ? 0 : v[ yIndex ] );
@@ -127,9 +132,10 @@ void ProjectionTransformer<ScalarParam>::invTransform(Geometry::Vector<ScalarPar
                                                       typename DynamicalModel<ScalarParam>::Vector & out) const
 {
     // A value of -1 means it will be mapped to the value 0.
-    int const& xIndex = this->intParamValues[0];
-    int const& yIndex = this->intParamValues[1];
-    int const& zIndex = this->intParamValues[2];
+    typename ParameterClass<ScalarParam>::Snapshot const& params = this->getSnapshot();
+    int const xIndex = params.intValues[0];
+    int const yIndex = params.intValues[1];
+    int const zIndex = params.intValues[2];
 
     if (xIndex > -1) out[xIndex] = v[0];
     if (yIndex > -1) out[yIndex] = v[1];
@@ -146,11 +152,28 @@ void ProjectionTransformer<ScalarParam>::invTransform(Geometry::Vector<ScalarPar
     }
 }
 
+template <typename ScalarParam>
+bool ProjectionTransformer<ScalarParam>::getProjection(typename DynamicalModel<ScalarParam>::Scalar* matrix) const
+{
+    // One row per display coordinate; a row of zeros for index -1
+    typename ParameterClass<ScalarParam>::Snapshot const& params = this->getSnapshot();
+    int const dimension = this->model.getDimension();
+
+    for (int i = 0; i < 3; i++)
+    {
+        int const index = params.intValues[i];
+        for (int j = 0; j < dimension; j++)
+        {
+            matrix[i * dimension + j] = (j == index ? 1 : 0);
+        }
+    }
+    return true;
+}
+
 template <typename ScalarParam>
 typename DynamicalModel<ScalarParam>::Scalar ProjectionTransformer<ScalarParam>::getRadius(void) const
 {   
     typedef typename CoordinateClass<ScalarParam>::Coordinates Coords;
-    typedef typename ParameterClass<double>::IntParameters IntParams;
     
     // use the radius from the mapped coordinates.
 
@@ -159,12 +182,12 @@ typename DynamicalModel<ScalarParam>::Scalar ProjectionTransformer<ScalarParam>:
     ScalarParam tempRadius;
     
     Coords const coords = this->model.getCoords();
-    IntParams const iparams = this->getIntParams();
+    std::vector<int> const& mapping = this->getSnapshot().intValues;
     
-    IntParams::const_iterator itr;
-    for (itr = iparams.begin(); itr != iparams.end(); ++itr)
+    std::vector<int>::const_iterator itr;
+    for (itr = mapping.begin(); itr != mapping.end(); ++itr)
     {
-        int i = (*itr).value;
+        int i = *itr;
         if (i > -1) 
         {
             // then the display Coordinate is mapped to *some* coordinate        
@@ -194,7 +217,7 @@ std::string ProjectionTransformer<ScalarParam>::getParameterDisplay(int paramete
 {
     std::string name;
     typename CoordinateClass<ScalarParam>::Coordinates coords = this->model.getCoords();
-    int coordinateIndex = this->intParamValues[parameterIndex];
+    int coordinateIndex = this->getSnapshot().intValues[parameterIndex];
     if (coordinateIndex == -1)
     {
         name = "0";
@@ -9,51 +9,62 @@ private:
 
     /* Elements: */
 
-    typedef void (RungeKutta4::*StepFunction)(Vector const& v, Vector & out);
+    typedef void (RungeKutta4::*StepFunction)(Scalar const* v, Scalar* out,
+                                              Scalar stepSize,
+                                              Snapshot const& params,
+                                              Context& context) const;
     StepFunction stepFunction;
 
-    // Vectors for intermediate calculations
-    Vector v0;
-    Vector v1;
-    Vector v2;
-    Vector vTemp;
+    // Number of states stepBatch processes per pass. The scratch for one
+    // pass (6 * dimension * BatchSize scalars) stays cache resident.
+    static const size_t BatchSize = 128;
 
 public:
 
     /* Constructors and destructors: */
 
     RungeKutta4(const Model& model, Scalar stepSize=.01)
-    : Integrator<double>(model),
-      v0(model.getDimension()),
-      v1(model.getDimension()),
-      v2(model.getDimension()),
-      vTemp(model.getDimension())
+    : Integrator<double>(model)
     {
         name = "rk4";
 
         addRealParameter( RealParameter("stepSize", stepSize, .0001, .2, .01, .0001) );
 
-        int dimension = model.getDimension();
+        if (model.getDimension() == 0)
+            throw IntegratorException();
+
+        setSpecialized(true);
+    }
+
+    virtual ~RungeKutta4()
+    {
+    }
+
+    /* Methods: */
+
+    // Selects the step kernel compiled for the model's dimension (the
+    // default, for dimensions up to 5) or the generic n-D kernel. Must not
+    // be called while other threads are stepping.
+    void setSpecialized(bool specialized)
+    {
+        int dimension = specialized ? model.getDimension() : 0;
 
         switch (dimension)
         {
-        case 0:
-            throw IntegratorException();
-            break;
         case 1:
-            stepFunction = &RungeKutta4::step_1d;
+            stepFunction = &RungeKutta4::step_fixed<1>;
             break;
         case 2:
-            stepFunction = &RungeKutta4::step_2d;
+            stepFunction = &RungeKutta4::step_fixed<2>;
             break;
         case 3:
-            stepFunction = &RungeKutta4::step_3d;
+            stepFunction = &RungeKutta4::step_fixed<3>;
             break;
         case 4:
-            stepFunction = &RungeKutta4::step_4d;
+            stepFunction = &RungeKutta4::step_fixed<4>;
             break;
         case 5:
-            stepFunction = &RungeKutta4::step_5d;
+            stepFunction = &RungeKutta4::step_fixed<5>;
             break;
         default:
             stepFunction = &RungeKutta4::step_nd;
@@ -61,55 +72,282 @@ public:
         }
     }
 
-    virtual ~RungeKutta4()
-    {
-    }
+    using Integrator<double>::step;
+    using Integrator<double>::stepBatch;
 
-    /* Methods: */
     inline
-    void step(Vector const& v, Vector &out)
+    void step(Scalar const* v, Scalar* out, Context& context) const
     {
+        Pin integratorPin(*this);
+        Pin modelPin(model);
+        Scalar stepSize = getSnapshot().realValues[0];
+
         // call pointer to member function
-        (this->*stepFunction)(v, out);
+        (this->*stepFunction)(v, out, stepSize, model.getSnapshot(), context);
+    }
+
+    void stepBatch(Scalar const* in, Scalar* out, size_t count, size_t stride,
+                   Context& context) const
+    {
+        Pin integratorPin(*this);
+        Pin modelPin(model);
+        Scalar stepSize = getSnapshot().realValues[0];
+        Snapshot const& params = model.getSnapshot();
+
+        Scalar* scratch = context.getScratch(6 * model.getDimension() * BatchSize);
+
+        for (size_t first = 0; first < count; first += BatchSize)
+        {
+            size_t n = count - first;
+            if (n > BatchSize)
+                n = BatchSize;
+            step_batch(in + first, out + first, n, stride, stepSize, params,
+                       scratch);
+        }
+    }
+
+    // Advances n <= BatchSize states. The arithmetic matches step_fixed
+    // followed by v += step, so batched and single states agree exactly.
+    // The time coordinate, if the model has one, is not integrated: its
+    // stage values and step are the same offsets for every state, and are
+    // added to its row directly.
+    void step_batch(Scalar const* in, Scalar* out, size_t n, size_t stride,
+                    Scalar stepSize, Snapshot const& params,
+                    Scalar* scratch) const
+    {
+        size_t size = model.getDimension() * BatchSize;
+        Scalar* v = scratch;
+        Scalar* k0 = v + size;
+        Scalar* k1 = k0 + size;
+        Scalar* k2 = k1 + size;
+        Scalar* k3 = k2 + size;
+        Scalar* kTemp = k3 + size;
+
+        /* Copy the states into the scratch so that in may alias out: */
+        int dimension = model.getDimension();
+        int time = model.getTimeCoordinate();
+        for (int i = 0; i < dimension; i++)
+        {
+            Scalar const* src = in + i * stride;
+            Scalar* dst = v + i * BatchSize;
+            for (size_t j = 0; j < n; j++)
+                dst[j] = src[j];
+        }
+
+        /* Calculate first half-step vector: */
+        model.evaluateBatch(v, k0, n, BatchSize, params);
+        scale(k0, stepSize * Scalar(0.5), n);
+
+        /* Calculate second half-step vector: */
+        add(v, k0, kTemp, n);
+        addTime(v, Scalar(1) * (stepSize * Scalar(0.5)), kTemp, n);
+        model.evaluateBatch(kTemp, k1, n, BatchSize, params);
+        scale(k1, stepSize * Scalar(0.5), n);
+
+        /* Calculate third half-step vector: */
+        add(v, k1, kTemp, n);
+        addTime(v, Scalar(1) * (stepSize * Scalar(0.5)), kTemp, n);
+        model.evaluateBatch(kTemp, k2, n, BatchSize, params);
+        scale(k2, stepSize, n);
+
+        /* Calculate fourth half-step vector: */
+        add(v, k2, kTemp, n);
+        addTime(v, Scalar(1) * stepSize, kTemp, n);
+        model.evaluateBatch(kTemp, k3, n, BatchSize, params);
+        scale(k3, stepSize, n);
+
+        /* Calculate step vector and advance the states: */
+        for (int i = 0; i < dimension; i++)
+        {
+            if (i == time)
+                continue;
+            Scalar const* vi = v + i * BatchSize;
+            Scalar const* k0i = k0 + i * BatchSize;
+            Scalar* k1i = k1 + i * BatchSize;
+            Scalar* k2i = k2 + i * BatchSize;
+            Scalar* k3i = k3 + i * BatchSize;
+            Scalar* dst = out + i * stride;
+            for (size_t j = 0; j < n; j++)
+            {
+                k1i[j] *= Scalar(2);
+                k2i[j] += k1i[j] + k0i[j];
+                k2i[j] *= Scalar(2);
+                k3i[j] += k2i[j];
+                k3i[j] /= Scalar(6);
+                dst[j] = vi[j] + k3i[j];
+            }
+        }
+
+        /* Advance the time coordinate, in place, by its step: */
+        if (time >= 0)
+        {
+            Scalar step = timeStep(stepSize);
+            Scalar const* src = in + time * stride;
+            Scalar* dst = out + time * stride;
+            for (size_t j = 0; j < n; j++)
+                dst[j] = src[j] + step;
+        }
     }
 
     // Computes one Runge-Kutta integration step vector
-    void step_nd(Vector const& v, Vector &out)
+    void step_nd(Scalar const* v, Scalar* out, Scalar stepSize,
+                 Snapshot const& params, Context& context) const
+    {
+        int dimension = model.getDimension();
+        Scalar* k0 = context.getScratch(4 * dimension);
+        Scalar* k1 = k0 + dimension;
+        Scalar* k2 = k1 + dimension;
+        Scalar* kTemp = k2 + dimension;
+
+        /* Calculate first half-step vector: */
+        model.evaluate(v, k0, params);
+        for (int i = 0; i < dimension; i++)
+            k0[i] *= stepSize * Scalar(0.5);
+
+        /* Calculate second half-step vector: */
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k0[i];
+        model.evaluate(kTemp, k1, params);
+        for (int i = 0; i < dimension; i++)
+            k1[i] *= stepSize * Scalar(0.5);
+
+        /* Calculate third half-step vector: */
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k1[i];
+        model.evaluate(kTemp, k2, params);
+        for (int i = 0; i < dimension; i++)
+            k2[i] *= stepSize;
+
+        /* Calculate fourth half-step vector: */
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k2[i];
+        model.evaluate(kTemp, out, params);
+        for (int i = 0; i < dimension; i++)
+            out[i] *= stepSize;
+
+        /* Calculate step vector: */
+        for (int i = 0; i < dimension; i++)
+        {
+            k1[i] *= Scalar(2);
+            k2[i] += k1[i];
+            k2[i] += k0[i];
+            k2[i] *= Scalar(2);
+            out[i] += k2[i];
+            out[i] /= Scalar(6);
+        }
+    }
+
+    // Same as step_nd, but the dimension is known at compile time so the
+    // intermediate vectors live on the stack and the loops unroll.
+    template <int dimension>
+    void step_fixed(Scalar const* v, Scalar* out, Scalar stepSize,
+                    Snapshot const& params, Context&) const
     {
-        Scalar stepSize = realParamValues[0];
+        Scalar k0[dimension], k1[dimension], k2[dimension], kTemp[dimension];
 
         /* Calculate first half-step vector: */
-        model(v, v0);
-        v0 *= stepSize * Scalar(0.5);
+        model.evaluate(v, k0, params);
+        for (int i = 0; i < dimension; i++)
+            k0[i] *= stepSize * Scalar(0.5);
 
         /* Calculate second half-step vector: */
-        vTemp = v;
-        vTemp += v0;
-        model(vTemp, v1);
-        v1 *= stepSize * Scalar(0.5);
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k0[i];
+        model.evaluate(kTemp, k1, params);
+        for (int i = 0; i < dimension; i++)
+            k1[i] *= stepSize * Scalar(0.5);
 
         /* Calculate third half-step vector: */
-        vTemp = v;
-        vTemp += v1;
-        model(vTemp, v2);
-        v2 *= stepSize;
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k1[i];
+        model.evaluate(kTemp, k2, params);
+        for (int i = 0; i < dimension; i++)
+            k2[i] *= stepSize;
 
         /* Calculate fourth half-step vector: */
-        vTemp = v;
-        vTemp += v2;
-        model(vTemp, out);
-        out *= stepSize;
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k2[i];
+        model.evaluate(kTemp, out, params);
+        for (int i = 0; i < dimension; i++)
+            out[i] *= stepSize;
 
         /* Calculate step vector: */
-        v1 *= Scalar(2);
-        v2 += v1;
-        v2 += v0;
-        v2 *= Scalar(2);
-        out += v2;
-        out /= Scalar(6);
+        for (int i = 0; i < dimension; i++)
+        {
+            k1[i] *= Scalar(2);
+            k2[i] += k1[i] + k0[i];
+            k2[i] *= Scalar(2);
+            out[i] += k2[i];
+            out[i] /= Scalar(6);
+        }
     }
 
-    #include "RungeKutta4Step.inc.h"
+protected:
+
+    // The step vector of a coordinate whose derivative is 1, computed with
+    // the operations step_fixed uses, so the result is bit for bit the same.
+    static Scalar timeStep(Scalar stepSize)
+    {
+        Scalar k0 = Scalar(1) * (stepSize * Scalar(0.5));
+        Scalar k1 = Scalar(1) * (stepSize * Scalar(0.5));
+        Scalar k2 = Scalar(1) * stepSize;
+        Scalar k3 = Scalar(1) * stepSize;
+
+        k1 *= Scalar(2);
+        k2 += k1 + k0;
+        k2 *= Scalar(2);
+        k3 += k2;
+        k3 /= Scalar(6);
+        return k3;
+    }
+
+private:
+
+    // Helpers for stepBatch; arrays have stride BatchSize. Except for
+    // addTime, they skip the row of the time coordinate.
+
+    void scale(Scalar* k, Scalar factor, size_t n) const
+    {
+        int dimension = model.getDimension();
+        int time = model.getTimeCoordinate();
+        for (int i = 0; i < dimension; i++)
+        {
+            if (i == time)
+                continue;
+            Scalar* ki = k + i * BatchSize;
+            for (size_t j = 0; j < n; j++)
+                ki[j] *= factor;
+        }
+    }
+
+    void add(Scalar const* a, Scalar const* b, Scalar* sum, size_t n) const
+    {
+        int dimension = model.getDimension();
+        int time = model.getTimeCoordinate();
+        for (int i = 0; i < dimension; i++)
+        {
+            if (i == time)
+                continue;
+            Scalar const* ai = a + i * BatchSize;
+            Scalar const* bi = b + i * BatchSize;
+            Scalar* si = sum + i * BatchSize;
+            for (size_t j = 0; j < n; j++)
+                si[j] = ai[j] + bi[j];
+        }
+    }
+
+    // Sets the time row of sum to that of a plus the stage offset, which is
+    // what add() would give for a derivative of 1.
+    void addTime(Scalar const* a, Scalar offset, Scalar* sum, size_t n) const
+    {
+        int time = model.getTimeCoordinate();
+        if (time < 0)
+            return;
+        Scalar const* ai = a + time * BatchSize;
+        Scalar* si = sum + time * BatchSize;
+        for (size_t j = 0; j < n; j++)
+            si[j] = ai[j] + offset;
+    }
 };
 
 #endif
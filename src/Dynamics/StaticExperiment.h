@@ -0,0 +1,46 @@
+#ifndef DTS_STATICEXPERIMENT
+#define DTS_STATICEXPERIMENT
+
+#include <Experiment.h>
+
+/** Base class for experiments whose model type is known at compile time.
+ *
+ * The experiment creates its ModelT and keeps a typed pointer to it next
+ * to Experiment::model, so the integrators it adds can be bound to ModelT
+ * rather than to the DynamicalModel interface:
+ * \code
+class LorenzExperiment : public StaticExperiment<Lorenz>
+{
+public:
+    LorenzExperiment()
+    {
+        addIntegrator( new StaticRungeKutta4<Lorenz>(*staticModel, .01) );
+        setIntegrator("rk4");
+        ...
+    }
+};
+ * \endcode
+ * Tools still see the experiment through Experiment<double>; only the
+ * integrator step changes. ModelT must be a GenericModel.
+ */
+template <class ModelT>
+class StaticExperiment : public Experiment<double>
+{
+public:
+    typedef ModelT Model;
+
+    StaticExperiment()
+    : Experiment<double>(),
+      staticModel(new ModelT)
+    {
+        model = staticModel;
+    }
+
+    virtual ~StaticExperiment() { }
+
+protected:
+    // Same object as model; owned (and deleted) by Experiment
+    ModelT *staticModel;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef STATIC_RUNGEKUTTA4_H
+#define STATIC_RUNGEKUTTA4_H
+
+#include <cstddef>
+
+#include "RungeKutta4.h"
+#include "Pack.h"
+
+/*
+    RungeKutta4 for a model type known at compile time.
+
+    ModelT is a GenericModel: it provides Dimension and the static template
+    rhs (see GenericModel.h). Instead of evaluating the model through the
+    virtual DynamicalModel interface, once per stage, this integrator calls
+    ModelT::rhs directly, so the compiler inlines the right-hand side into
+    the stages. stepBatch takes DTS_PACK_WIDTH states through all four
+    stages in registers, where RungeKutta4 takes a batch through each stage
+    in turn via scratch arrays.
+
+    The arithmetic is that of RungeKutta4, operation for operation, so both
+    integrators produce the same states. setSpecialized has no effect.
+*/
+template <class ModelT>
+class StaticRungeKutta4 : public RungeKutta4
+{
+public:
+    typedef DTS::Pack<double> Pack;
+
+    /* Constructors and destructors: */
+
+    StaticRungeKutta4(ModelT const& model, Scalar stepSize=.01)
+    : RungeKutta4(model, stepSize)
+    {
+    }
+
+    virtual ~StaticRungeKutta4()
+    {
+    }
+
+    /* Methods: */
+
+    using RungeKutta4::step;
+    using RungeKutta4::stepBatch;
+
+    void step(Scalar const* v, Scalar* out, Context&) const
+    {
+        Pin integratorPin(*this);
+        Pin modelPin(model);
+        Scalar stepSize = getSnapshot().realValues[0];
+
+        increment(v, out, stepSize, &model.getSnapshot().realValues[0]);
+    }
+
+    void stepBatch(Scalar const* in, Scalar* out, size_t count, size_t stride,
+                   Context&) const
+    {
+        Pin integratorPin(*this);
+        Pin modelPin(model);
+        Scalar stepSize = getSnapshot().realValues[0];
+        double const* params = &model.getSnapshot().realValues[0];
+
+        const int dimension = ModelT::Dimension;
+        const int time = model.getTimeCoordinate();
+
+        // The time coordinate is loaded, so rhs sees the stage times, but
+        // its row is stored below (see RungeKutta4)
+        Pack v[dimension];
+        Pack step[dimension];
+
+        size_t j = 0;
+        for (; j + Pack::width <= count; j += Pack::width)
+        {
+            for (int i = 0; i < dimension; i++)
+                v[i] = Pack::load(in + i * stride + j);
+
+            increment(v, step, stepSize, params);
+
+            for (int i = 0; i < dimension; i++)
+                if (i != time)
+                    (v[i] + step[i]).store(out + i * stride + j);
+        }
+
+        // Remaining states one at a time
+        Scalar vs[dimension];
+        Scalar steps[dimension];
+        for (; j < count; j++)
+        {
+            for (int i = 0; i < dimension; i++)
+                vs[i] = in[i * stride + j];
+
+            increment(vs, steps, stepSize, params);
+
+            for (int i = 0; i < dimension; i++)
+                if (i != time)
+                    out[i * stride + j] = vs[i] + steps[i];
+        }
+
+        if (time >= 0)
+        {
+            Scalar timeIncrement = timeStep(stepSize);
+            Scalar const* src = in + time * stride;
+            Scalar* dst = out + time * stride;
+            for (j = 0; j < count; j++)
+                dst[j] = src[j] + timeIncrement;
+        }
+    }
+
+private:
+
+    // One Runge-Kutta step vector, for S = double or S = Pack
+    template <class S>
+    static void increment(S const* v, S* out, Scalar stepSize,
+                          double const* params)
+    {
+        const int dimension = ModelT::Dimension;
+        S k0[dimension], k1[dimension], k2[dimension], kTemp[dimension];
+
+        /* Calculate first half-step vector: */
+        ModelT::rhs(v, k0, params);
+        for (int i = 0; i < dimension; i++)
+            k0[i] = k0[i] * S(stepSize * Scalar(0.5));
+
+        /* Calculate second half-step vector: */
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k0[i];
+        ModelT::rhs(kTemp, k1, params);
+        for (int i = 0; i < dimension; i++)
+            k1[i] = k1[i] * S(stepSize * Scalar(0.5));
+
+        /* Calculate third half-step vector: */
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k1[i];
+        ModelT::rhs(kTemp, k2, params);
+        for (int i = 0; i < dimension; i++)
+            k2[i] = k2[i] * S(stepSize);
+
+        /* Calculate fourth half-step vector: */
+        for (int i = 0; i < dimension; i++)
+            kTemp[i] = v[i] + k2[i];
+        ModelT::rhs(kTemp, out, params);
+        for (int i = 0; i < dimension; i++)
+            out[i] = out[i] * S(stepSize);
+
+        /* Calculate step vector: */
+        for (int i = 0; i < dimension; i++)
+        {
+            k1[i] = k1[i] * S(Scalar(2));
+            k2[i] = k2[i] + (k1[i] + k0[i]);
+            k2[i] = k2[i] * S(Scalar(2));
+            out[i] = out[i] + k2[i];
+            out[i] = out[i] / S(Scalar(6));
+        }
+    }
+};
+
+#endif
@@ -39,6 +39,9 @@ public:
         The first method allocates space for the output. The second method
         writes to a preallocated vector, which is assumed to be distinct from
         the input vector. There will be problems if v == out.
+
+        Threads other than the one that sets the parameters must hold a
+        ParameterClass::Pin on the transformer while transforming.
     */
     Vector transform(Vector const& v) const;
     virtual void transform(Vector const& v, Vector & out) const;
@@ -55,6 +58,17 @@ public:
     Vector invTransform(Geometry::Vector<ScalarParam,3> const& v) const;
     virtual void invTransform(Geometry::Vector<ScalarParam,3> const& v, Vector & out) const;
 
+    /*
+        Linear transformations can be applied on the GPU. If the
+        transformation is linear, this writes it as a 3 x dimension matrix
+        (row-major: matrix[i * dimension + j] maps component j to display
+        coordinate i) and returns true. Otherwise it returns false and
+        leaves matrix alone. The default implementation returns false, so
+        a subclass that overrides transform() is projected on the CPU
+        unless it overrides this as well.
+    */
+    virtual bool getProjection(Scalar* matrix) const;
+
     /* Generally you need to be careful.  If the coordinate ranges from 0, 2PI
      * and you map it to polar coordinates, then its range is now 0. So
      * the default point, center point, and radius is necessarily transformation
@@ -202,6 +216,12 @@ void Transformer<ScalarParam>::invTransform(Geometry::Vector<ScalarParam,3> cons
     }
 }
 
+template <typename ScalarParam>
+bool Transformer<ScalarParam>::getProjection(Scalar*) const
+{
+    return false;
+}
+
 template <typename ScalarParam>
 typename DynamicalModel<ScalarParam>::Vector Transformer<ScalarParam>::getDefaultPoint(void) const
 {
@@ -299,7 +319,6 @@ std::string Transformer<ScalarParam>::getParameterDisplay(int parameterIndex)
 template <typename ScalarParam>
 std::string Transformer<ScalarParam>::getParameterDisplay(std::string parameterName)
 {
-    typename ParameterClass<double>::IntParameters iparams = this->getIntParams();
     int paramIndex = this->getIntParamIndex(parameterName);
     std::string name;
     if (paramIndex >= 0)
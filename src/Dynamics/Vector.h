@@ -113,7 +113,6 @@ inline bool operator!=(const Vector<ScalarParam>& v1, const Vector<ScalarParam>&
 template <typename ScalarParam>
 inline Vector<ScalarParam> operator+(const Vector<ScalarParam>& v1, const Vector<ScalarParam>& v2)
 {
-	std::cout << "addition" << std::endl;
 	int dimension = v1.getDimension();
 	int dimension2 = v2.getDimension();
 	if (dimension2 < dimension)
@@ -205,7 +204,6 @@ Vector<ScalarParam>::Vector(void)
 {
 	components.resize(dimension);
 	allocations += 1;
-	std::cout << "default Allocations " << allocations << std::endl;
 }
 
 template <typename ScalarParam>
@@ -244,7 +242,6 @@ Vector<ScalarParam>::Vector(std::vector<ScalarParam> const& v)
         components[i] = v[i];
     }
     allocations += 1;
-	std::cout << "copyvector Allocations " << allocations << std::endl;    
 }
 
 template <typename ScalarParam>
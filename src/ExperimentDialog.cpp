@@ -11,11 +11,14 @@ GLMotif::PopupWindow* ExperimentDialog::createDialog()
     GLMotif::TextField* textField;
     GLMotif::Slider* slider;
     
-    RealParameters::iterator realItr;
-    RealParameters realParams;
-
-    IntParameters::iterator intItr;
-    IntParameters intParams;
+    // the simulation thread sets the parameters, so their values are read
+    // from pinned snapshots
+    Integrator<double>* integrator = experiment->integrator;
+    ParameterClass<double>::Pin modelPin(*experiment->model);
+    ParameterClass<double>::Pin integratorPin(*integrator);
+    ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+    shownIntegrator = integrator;
+    transformerVersion = experiment->transformer->getVersion();
 
 
     /** Layout **/
@@ -37,18 +40,20 @@ GLMotif::PopupWindow* ExperimentDialog::createDialog()
     factory.createLabel("Model2", "");
     factory.createLabel("Model3", "");    
         
-    realParams = experiment->model->getRealParams();
-    for (realItr = realParams.begin(); realItr != realParams.end(); ++realItr)
+    const RealParameters& modelParams = experiment->model->getRealParams();
+    const std::vector<double>& modelValues = experiment->model->getSnapshot().realValues;
+    for (size_t i = 0; i < modelParams.size(); i++)
     {
-        factory.createLabel("", realItr->name.c_str());
+        const RealParameter& param = modelParams[i];
+        factory.createLabel("", param.name.c_str());
         
-        textField = factory.createTextField( realItr->name.c_str(), 10 );
-        textField->setString( toString(realItr->value).c_str() );
+        textField = factory.createTextField( param.name.c_str(), 10 );
+        textField->setString( toString(modelValues[i]).c_str() );
         textFields.push_back( textField );
         
-        slider = factory.createSlider( realItr->name.c_str(), 15);
-        slider->setValueRange( realItr->minValue, realItr->maxValue, realItr->increment );
-        slider->setValue( realItr->value );
+        slider = factory.createSlider( param.name.c_str(), 15);
+        slider->setValueRange( param.minValue, param.maxValue, param.increment );
+        slider->setValue( modelValues[i] );
         slider->getValueChangedCallbacks().add(this, &ExperimentDialog::sliderModelCallback);        
         sliders.push_back( slider );
     }
@@ -62,24 +67,39 @@ GLMotif::PopupWindow* ExperimentDialog::createDialog()
     // Integrator
     //
 
-    std::string integrator = "Integrator: ";
-    integrator.append( experiment->integrator->getName() );
-    factory.createLabel("Integrator1", integrator.c_str());
-    factory.createLabel("Integrator2", "");
-    factory.createLabel("Integrator3", "");    
+    factory.createLabel("Integrator1", "Integrator:");
+
+    // radio buttons for the available integrators, after the label
+    std::vector<std::string> integratorNames = experiment->getIntegratorNames();
+    std::vector<std::string>::iterator nameItr;
+    for (nameItr = integratorNames.begin(); nameItr != integratorNames.end(); ++nameItr)
+    {
+        std::string toggleName = *nameItr + "toggle";
+        GLMotif::ToggleButton* toggle = factory.createToggleButton(
+                toggleName.c_str(), nameItr->c_str(),
+                *nameItr == integrator->getName());
+        toggle->getValueChangedCallbacks().add(this, &ExperimentDialog::integratorToggleCallback);
+        integratorToggles.push_back( toggle );
+    }
+    for (size_t i = integratorNames.size() + 1; i % 3 != 0; i++)
+    {
+        factory.createLabel("", "");
+    }
 
-    realParams = experiment->integrator->getRealParams();
-    for (realItr = realParams.begin(); realItr != realParams.end(); ++realItr)
+    const RealParameters& integratorParams = integrator->getRealParams();
+    const std::vector<double>& integratorValues = integrator->getSnapshot().realValues;
+    for (size_t i = 0; i < integratorParams.size(); i++)
     {
-        factory.createLabel("", realItr->name.c_str());
+        const RealParameter& param = integratorParams[i];
+        factory.createLabel("", param.name.c_str());
         
-        textField = factory.createTextField(realItr->name.c_str(), 10);
-        textField->setString(toString(realItr->value).c_str());
+        textField = factory.createTextField(param.name.c_str(), 10);
+        textField->setString(toString(integratorValues[i]).c_str());
         textFields.push_back( textField );
         
-        slider = factory.createSlider( realItr->name.c_str(), 20);
-        slider->setValueRange( realItr->minValue, realItr->maxValue, realItr->increment );
-        slider->setValue( realItr->value );
+        slider = factory.createSlider( param.name.c_str(), 20);
+        slider->setValueRange( param.minValue, param.maxValue, param.increment );
+        slider->setValue( integratorValues[i] );
         slider->getValueChangedCallbacks().add(this, &ExperimentDialog::sliderIntegratorCallback);
         sliders.push_back( slider );
     }
@@ -109,19 +129,22 @@ GLMotif::PopupWindow* ExperimentDialog::createDialog()
     coordStr.append(" )");    
     factory.createLabel("Transformer3", coordStr.c_str() );    
 
-    intParams = experiment->transformer->getIntParams();
-    for (intItr = intParams.begin(); intItr != intParams.end(); ++intItr)
+    const IntParameters& transformerParams = experiment->transformer->getIntParams();
+    const std::vector<int>& transformerValues = experiment->transformer->getSnapshot().intValues;
+    for (size_t i = 0; i < transformerParams.size(); i++)
     {
-        factory.createLabel("", intItr->name.c_str());
+        const IntParameter& param = transformerParams[i];
+        factory.createLabel("", param.name.c_str());
 
-        std::string displayParamName = intItr->name;
-        textField = factory.createTextField(intItr->name.c_str(), 10);
+        std::string displayParamName = param.name;
+        textField = factory.createTextField(param.name.c_str(), 10);
         textField->setString( experiment->transformer->getParameterDisplay(displayParamName).c_str() );
         textFields.push_back( textField );
+        transformerFields.push_back( textField );
         
-        slider = factory.createSlider( intItr->name.c_str(), 10);
-        slider->setValueRange( intItr->minValue, intItr->maxValue, intItr->increment );
-        slider->setValue( intItr->value );
+        slider = factory.createSlider( param.name.c_str(), 10);
+        slider->setValueRange( param.minValue, param.maxValue, param.increment );
+        slider->setValue( transformerValues[i] );
         slider->getValueChangedCallbacks().add(this, &ExperimentDialog::sliderTransformerCallback);        
         sliders.push_back( slider );
     }
@@ -145,7 +168,9 @@ void ExperimentDialog::sliderModelCallback(GLMotif::Slider::ValueChangedCallback
         if ( strcmp( cbData->slider->getName(), (*itr)->getName() ) == 0 )
         {
             (*itr)->setString(buff);
-            experiment->model->setRealParamValue(cbData->slider->getName(), value);
+            simulationQueue.post(makeChange(experiment->model,
+                    &ParameterClass<double>::setRealParamValue,
+                    std::string(cbData->slider->getName()), value));
             break;
         }
     }
@@ -155,8 +180,9 @@ void ExperimentDialog::sliderIntegratorCallback(GLMotif::Slider::ValueChangedCal
 {
     double value = cbData->value;
 
-    char buff[10];
-    snprintf(buff, sizeof(buff), "%3.4f", value);
+    // %g keeps small tolerances readable
+    char buff[16];
+    snprintf(buff, sizeof(buff), "%.4g", value);
   
     std::vector<GLMotif::TextField *>::iterator itr; 
     for (itr = textFields.begin(); itr != textFields.end(); ++itr )
@@ -165,7 +191,9 @@ void ExperimentDialog::sliderIntegratorCallback(GLMotif::Slider::ValueChangedCal
         {
             (*itr)->setString(buff);
             // need to try catch here...round off errors cause failure
-            experiment->integrator->setRealParamValue(cbData->slider->getName(), value);
+            simulationQueue.post(makeChange(shownIntegrator,
+                    &ParameterClass<double>::setRealParamValue,
+                    std::string(cbData->slider->getName()), value));
             break;
         }
     }
@@ -174,22 +202,63 @@ void ExperimentDialog::sliderIntegratorCallback(GLMotif::Slider::ValueChangedCal
 void ExperimentDialog::sliderTransformerCallback(GLMotif::Slider::ValueChangedCallbackData* cbData)
 {
     int value = static_cast<int>(cbData->value);
-    
-    char buff[10];
-    snprintf(buff, sizeof(buff), "%1i", value);
-  
-    std::vector<GLMotif::TextField *>::iterator itr; 
-    for (itr = textFields.begin(); itr != textFields.end(); ++itr )
+
+    // the text field follows in update(), once the change is applied
+    simulationQueue.post(makeChange(experiment->transformer,
+            &ParameterClass<double>::setIntParamValue,
+            std::string(cbData->slider->getName()), value));
+}
+
+void ExperimentDialog::integratorToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
+{
+    std::string name = cbData->toggle->getName();
+    name.erase(name.size() - std::string("toggle").size());
+
+    // fake radio-button behavior
+    std::vector<GLMotif::ToggleButton *>::iterator itr;
+    for (itr = integratorToggles.begin(); itr != integratorToggles.end(); ++itr)
     {
-        if ( strcmp( cbData->slider->getName(), (*itr)->getName() ) == 0 )
-        {   
-            std::string displayParamName = cbData->slider->getName();
-            experiment->transformer->setIntParamValue(displayParamName, value);
-            (*itr)->setString( experiment->transformer->getParameterDisplay(displayParamName).c_str() );
-            break;
+        (*itr)->setToggle(*itr == cbData->toggle);
+    }
+
+    // step tasks read experiment->integrator once per chunk, so it is
+    // switched between steps; update() rebuilds the dialog afterwards
+    simulationQueue.post(makeChange(experiment,
+            &Experiment<double>::setIntegrator, name));
+    Vrui::requestUpdate();
+}
+
+void ExperimentDialog::update()
+{
+    if (experiment->integrator == shownIntegrator)
+    {
+        unsigned int version = experiment->transformer->getVersion();
+        if (version != transformerVersion)
+        {
+            ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+            transformerVersion = version;
+            for (size_t i = 0; i < transformerFields.size(); i++)
+            {
+                std::string displayParamName = transformerFields[i]->getName();
+                transformerFields[i]->setString( experiment->transformer->getParameterDisplay(displayParamName).c_str() );
+            }
         }
+        return;
     }
 
+    // the parameter rows belong to the old integrator;
+    // hide() saves the position, so show() puts the new window in its place
+    bool shown = (state() == ACTIVE);
+    if (shown)
+        hide();
+
+    delete dialogWindow;
+    sliders.clear();
+    textFields.clear();
+    transformerFields.clear();
+    integratorToggles.clear();
+
+    dialogWindow = createDialog();
+    if (shown)
+        show();
 }
-    
-    
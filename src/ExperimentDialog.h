@@ -8,14 +8,28 @@
 
 #include "Dynamics/Experiment.h"
 #include "CaveDialog.h"
+#include "SimulationQueue.h"
 
 class ExperimentDialog : public CaveDialog
 {
 private:
     Experiment<double>* experiment;
 
+    // Parameter changes are applied by the simulation thread between steps
+    SimulationQueue& simulationQueue;
+
     std::vector<GLMotif::Slider *> sliders;
     std::vector<GLMotif::TextField *> textFields;  
+    std::vector<GLMotif::TextField *> transformerFields;
+    std::vector<GLMotif::ToggleButton *> integratorToggles;
+
+    // The integrator whose parameters are shown. Once the simulation thread
+    // has switched to another, the dialog is rebuilt in update(), also
+    // because a widget must not be deleted from its own callback.
+    Integrator<double>* shownIntegrator;
+
+    // Transformer version the transformer fields show
+    unsigned int transformerVersion;
 
     void intSliderCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);  
     void realSliderCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);
@@ -31,8 +45,10 @@ public:
     typedef ParameterClass<double>::RealParameters RealParameters;
     typedef ParameterClass<double>::IntParameters IntParameters;    
 
-    ExperimentDialog(GLMotif::PopupMenu *parentMenu, Experiment<double>* e)
-    : CaveDialog(parentMenu), experiment(e)
+    ExperimentDialog(GLMotif::PopupMenu *parentMenu, Experiment<double>* e,
+                     SimulationQueue& simulationQueue)
+    : CaveDialog(parentMenu), experiment(e), simulationQueue(simulationQueue),
+      shownIntegrator(0), transformerVersion(0)
     {
         dialogWindow = createDialog();
     }
@@ -40,7 +56,14 @@ public:
     virtual ~ExperimentDialog() 
     {
     }
+
+    /** Rebuild the dialog for a newly chosen integrator, if necessary, and
+     *  show the transformer parameters once a change to them is applied.
+     *  Call once per frame; a shown dialog stays in place.
+     */
+    void update();
     
+    void integratorToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
     void sliderModelCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);    
     void sliderIntegratorCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);
     void sliderTransformerCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);         
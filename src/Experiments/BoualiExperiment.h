@@ -1,20 +1,20 @@
 #ifndef FLOW_BOUALIZEXPERIMENT
 #define FLOW_BOUALIZEXPERIMENT
 
-#include "Experiment.h"
+#include "StaticExperiment.h"
 #include "Models/Bouali.h"
 
-#include "RungeKutta4.h"
+#include "StaticRungeKutta4.h"
+#include "DormandPrince.h"
 #include "ProjectionTransformer.h"
 
-class BoualiExperiment : public Experiment<double>
+class BoualiExperiment : public StaticExperiment<Bouali>
 {
 public:
-    BoualiExperiment() : Experiment<double>()
+    BoualiExperiment() : StaticExperiment<Bouali>()
     {
-        model = new Bouali();
-
-        addIntegrator( new RungeKutta4(*model, .01) );
+        addIntegrator( new StaticRungeKutta4<Bouali>(*staticModel, .01) );
+        addIntegrator( new DormandPrince(*model, .01) );
         setIntegrator("rk4");
 
         addTransformer( new ProjectionTransformer<double>(*model) );
@@ -1,20 +1,20 @@
 #ifndef DTS_LORENZEXPERIMENT
 #define DTS_LORENZEXPERIMENT
 
-#include "Experiment.h"
+#include "StaticExperiment.h"
 #include "Models/Lorenz.h"
 
-#include "RungeKutta4.h"
+#include "StaticRungeKutta4.h"
+#include "DormandPrince.h"
 #include "ProjectionTransformer.h"
 
-class LorenzExperiment : public Experiment<double>
+class LorenzExperiment : public StaticExperiment<Lorenz>
 {
 public:
-    LorenzExperiment() : Experiment<double>()
+    LorenzExperiment() : StaticExperiment<Lorenz>()
     {
-        model = new Lorenz();
-
-        addIntegrator( new RungeKutta4(*model, .01) );
+        addIntegrator( new StaticRungeKutta4<Lorenz>(*staticModel, .01) );
+        addIntegrator( new DormandPrince(*model, .01) );
         setIntegrator("rk4");
         
         addTransformer( new ProjectionTransformer<double>(*model) );
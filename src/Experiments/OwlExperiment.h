@@ -1,20 +1,20 @@
 #ifndef DTS_OWLEXPERIMENT
 #define DTS_OWLEXPERIMENT
 
-#include "Experiment.h"
+#include "StaticExperiment.h"
 #include "Models/Owl.h"
 
-#include "RungeKutta4.h"
+#include "StaticRungeKutta4.h"
+#include "DormandPrince.h"
 #include "ProjectionTransformer.h"
 
-class OwlExperiment : public Experiment<double>
+class OwlExperiment : public StaticExperiment<Owl>
 {
 public:
-    OwlExperiment() : Experiment<double>()
+    OwlExperiment() : StaticExperiment<Owl>()
     {
-        model = new Owl();
-
-        addIntegrator( new RungeKutta4(*model, .01) );
+        addIntegrator( new StaticRungeKutta4<Owl>(*staticModel, .01) );
+        addIntegrator( new DormandPrince(*model, .01) );
         setIntegrator("rk4");
         
         addTransformer( new ProjectionTransformer<double>(*model) );
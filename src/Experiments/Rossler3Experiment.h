@@ -1,20 +1,20 @@
 #ifndef DTS_ROSSLER3EXPERIMENT
 #define DTS_ROSSLER3EXPERIMENT
 
-#include "Experiment.h"
+#include "StaticExperiment.h"
 #include "Models/Rossler3.h"
 
-#include "RungeKutta4.h"
+#include "StaticRungeKutta4.h"
+#include "DormandPrince.h"
 #include "ProjectionTransformer.h"
 
-class Rossler3Experiment : public Experiment<double>
+class Rossler3Experiment : public StaticExperiment<Rossler3>
 {
 public:
-    Rossler3Experiment() : Experiment<double>()
+    Rossler3Experiment() : StaticExperiment<Rossler3>()
     {
-        model = new Rossler3();
-
-        addIntegrator( new RungeKutta4(*model, .1) );
+        addIntegrator( new StaticRungeKutta4<Rossler3>(*staticModel, .1) );
+        addIntegrator( new DormandPrince(*model, .1) );
         setIntegrator("rk4");
         
         addTransformer( new ProjectionTransformer<double>(*model) );
@@ -1,20 +1,20 @@
 #ifndef DTS_ROSSLER4EXPERIMENT
 #define DTS_ROSSLER4EXPERIMENT
 
-#include "Experiment.h"
+#include "StaticExperiment.h"
 #include "Models/Rossler4.h"
 
-#include "RungeKutta4.h"
+#include "StaticRungeKutta4.h"
+#include "DormandPrince.h"
 #include "ProjectionTransformer.h"
 
-class Rossler4Experiment : public Experiment<double>
+class Rossler4Experiment : public StaticExperiment<Rossler4>
 {
 public:
-    Rossler4Experiment() : Experiment<double>()
+    Rossler4Experiment() : StaticExperiment<Rossler4>()
     {
-        model = new Rossler4();
-
-        addIntegrator( new RungeKutta4(*model, .02) );
+        addIntegrator( new StaticRungeKutta4<Rossler4>(*staticModel, .02) );
+        addIntegrator( new DormandPrince(*model, .02) );
         setIntegrator("rk4");
         
         ProjectionTransformer<double> *t;
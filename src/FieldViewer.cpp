@@ -21,9 +21,14 @@
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <strings.h>
+#include <sys/time.h>
+#include <unistd.h>
 
 #include <Vrui/Vrui.h>
 #include <Vrui/Geometry.h>
+#include <Cluster/MulticastPipe.h>
 #include <IO/OpenFile.h>
 #include <IO/StandardDirectory.h>
 #include <Vrui/DisplayState.h>
@@ -87,24 +92,52 @@ Vrui::Scalar getAngle(const Vrui::Vector& u, const Vrui::Vector& v)
     return std::acos((u * v) / (Geometry::mag(u) * Geometry::mag(v)));
 }
 
+/** Returns the wall clock time in seconds.
+ */
+static double getWallTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return double(tv.tv_sec) + double(tv.tv_usec) * 1.0e-6;
+}
+
 
 Viewer::Viewer(int &argc, char** argv, char** appDefaults) :
    Vrui::Application(argc, argv, appDefaults),
    tools(ToolList()),
    experiment(NULL),
+   threadPool(NULL),
+   simulating(false),
+   simulationRate(0.0),
+   simulationStep(0),
+   displayedStep(0),
+   grantedStep(0),
+   grantedFraction(0.0),
    frameRateDialog(NULL),
    positionDialog(NULL),
    experimentDialog(NULL),
    currentOptionsDialog(NULL),
    optionsDialogs(DialogArray()),
    toolbox(0),
-   elapsedTime(0.0),
    absoluteTime(0.0),
    masterout(std::cout), nodeout(std::cout), debugout(std::cerr),
    showingLogo(false),
    firstTime(true),
-   startLogo(true)
+   startLogo(true),
+   logoStepSize(.01)
 {
+    // parse command line (Vrui has already removed its own arguments)
+    unsigned int numThreads = 0;
+    for (int i=1; i < argc; i++)
+    {
+        if (strcasecmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+    }
+
+    threadPool = new ThreadPool(numThreads);
+    masterout() << "Stepping with " << threadPool->getNumThreads() << " thread(s)." << std::endl;
 
     // load ToolBox
     ToolBox::ToolBoxFactory::instance();
@@ -138,10 +171,22 @@ Viewer::Viewer(int &argc, char** argv, char** appDefaults) :
     setExperiment("Lorenz", false);
     //setExperiment("Lorenz", false); // find out why we must do this twice in order to avoid flicker
 	//beginLogo();
+
+    // start stepping; on a cluster no step is taken before the first frame
+    // grants it
+    if (Vrui::getMainPipe() != 0)
+        simulationQueue.setLimit(0);
+    simulating = true;
+    simulationThread.start(this, &Viewer::simulationThreadMethod);
 }
 
 Viewer::~Viewer()
 {
+    // stop stepping before the tools go away
+    simulating = false;
+    simulationQueue.stop();
+    simulationThread.join();
+
     delete mainMenu;
 
     if (experimentDialog != NULL) delete experimentDialog;
@@ -153,6 +198,8 @@ Viewer::~Viewer()
         delete *tool;
     }
 
+    delete threadPool;
+
     // close all dynamic libs (plugins)
     for (DLList::iterator lib=dl_list.begin(); lib != dl_list.end(); ++lib)
     {
@@ -270,10 +317,11 @@ void Viewer::stepLogo()
     if (firstTime)
     {
         /* Spread some particles */
-        experiment->integrator->setRealParamValue("stepSize", .01);
+        logoStepSize = .01;
         std::map<std::string, AbstractDynamicsTool*>::iterator it = toolmap.find("DotSpreaderTool");
         if (it != toolmap.end())
         {
+           ParameterClass<double>::Pin transformerPin(*experiment->transformer);
            DTS::Vector<double> position = experiment->transformer->getCenterPoint();
            Vrui::Point pos;
            pos[0] = position[0];
@@ -294,13 +342,84 @@ void Viewer::stepLogo()
 
     }
 
-	double oldValue = experiment->integrator->getRealParamValue("stepSize");
-	double newValue = .9999 * oldValue;
+	// kept here rather than read back, since the change applies later
+	double newValue = .9999 * logoStepSize;
 	if (newValue < .0001)
 	{
 	    newValue = .0001;
 	}
-	experiment->integrator->setRealParamValue("stepSize", newValue);
+	logoStepSize = newValue;
+	simulationQueue.post(makeChange(experiment->integrator,
+	      &ParameterClass<double>::setRealParamValue, std::string("stepSize"), newValue));
+}
+
+void* Viewer::simulationThreadMethod()
+{
+   double lastStep = getWallTime();
+   double rateStart = lastStep;
+   unsigned int rateSteps = 0;
+
+   // on a cluster the steps are granted by the master's frame() instead
+   bool cluster = Vrui::getMainPipe() != 0;
+
+   while (simulating)
+   {
+      // changes apply between steps, even while stepping is paused
+      {
+         Threads::Mutex::Lock simulationLock(simulationMutex);
+         simulationQueue.apply(simulationStep);
+      }
+
+      double now = getWallTime();
+      if (cluster)
+      {
+         // at the limit, wait for more steps and the changes due with them
+         if (!simulationQueue.waitForLimit(simulationStep, 0.01))
+            continue;
+      }
+      else
+      {
+         // wait until the next step is due (a rate of zero pauses stepping)
+         double maxRate = frameRateDialog->getThrottledFrameRate();
+         double wait = maxRate > 0.0 ? lastStep + 1.0 / maxRate - now : 0.01;
+         if (wait > 0.0)
+         {
+            // sleep in short intervals so that rate changes take effect quickly
+            usleep((useconds_t) (std::min(wait, 0.01) * 1.0e6));
+            continue;
+         }
+         lastStep = now;
+      }
+
+      {
+         Threads::Mutex::Lock simulationLock(simulationMutex);
+
+         if (experiment != NULL)
+         {
+            for (ToolList::iterator tool=tools.begin(); tool != tools.end(); ++tool)
+            {
+               if ((*tool)->isDisabled())
+                  continue;
+
+               Threads::Mutex::Lock stepLock((*tool)->getStepMutex());
+               (*tool)->step();
+            }
+         }
+         simulationStep = simulationStep + 1;
+      }
+      simulationQueue.publish(simulationStep);
+      rateSteps++;
+
+      // update the measured rate about once a second
+      if (now - rateStart >= 1.0)
+      {
+         simulationRate = rateSteps / (now - rateStart);
+         rateStart = now;
+         rateSteps = 0;
+      }
+   }
+
+   return 0;
 }
 
 void Viewer::setRadioToggles(ToggleArray& toggles, const std::string& name)
@@ -423,21 +542,12 @@ void Viewer::renderTools(DTS::DataItem* dataItem) const
 
 void Viewer::frame()
 {
-   // frame rate
+   // frame rate (the tools are stepped by the simulation thread)
    double frameTime = Vrui::getCurrentFrameTime();
-   double throttledFrameRate = frameRateDialog->getThrottledFrameRate();
    frameRateDialog->setFrameRate(1.0/frameTime);
-   elapsedTime += frameTime;
+   frameRateDialog->setSimulationRate(simulationRate);
    absoluteTime += frameTime;
 
-   bool stepTools = false;
-   if (elapsedTime >= 1.0/throttledFrameRate)
-   {
-      stepTools = true;
-      //std::cout << "throttled value reached" << std::endl;
-      elapsedTime = 0.0;
-   }
-
     if(experiment == NULL)
     {
         if (!showingLogo)
@@ -468,6 +578,9 @@ void Viewer::frame()
         return;
     }
 
+   // show the parameters of a newly chosen integrator
+   experimentDialog->update();
+
    bool updatedExperiment = false;
    if ( experiment->isOutdated() )
    {
@@ -475,37 +588,18 @@ void Viewer::frame()
        experiment->updateVersion();
    }
 
-   // iterate over all tools and do required processing
-   for (ToolList::iterator tool=tools.begin(); tool != tools.end(); ++tool)
+   /* Update position whether the tool is disabled or not */
+   // If we want multiple users to be able to track various tools,
+   // we'll need to go back to the TrackerTool creation. For single
+   // position tracking, we just track the position of the first tool.
+   if (!tools.empty())
    {
-        /* Update position whether the tool is disabled or not */
-        // If we want multiple users to be able to track various tools,
-        // we'll need to go back to the TrackerTool creation. For single
-        // position tracking, we just track the position of the first tool.
-        if (tool == tools.begin())
-        {
-            //Vrui::getDeviceTransformation(input.getDevice(0)).getOrigin();
-            Vrui::Point position = tools[0]->toolBox()->deviceTransformationInModel().getOrigin();
-            positionDialog->setPosition(position);
-        }
-
-        if ((*tool)->isDisabled())
-        {
-            continue;
-        }
-        else
-        {
-            if (updatedExperiment)
-            {
-              (*tool)->updatedExperiment();
-            }
+       //Vrui::getDeviceTransformation(input.getDevice(0)).getOrigin();
+       Vrui::Point position = tools[0]->toolBox()->deviceTransformationInModel().getOrigin();
+       positionDialog->setPosition(position);
+   }
 
-            if (stepTools)
-            {
-             (*tool)->step();
-            }
-        }
-    }
+   lockSnapshots(updatedExperiment);
 
     if (startLogo && !showingLogo)
     {
@@ -522,6 +616,88 @@ void Viewer::frame()
     Vrui::requestUpdate();
 }
 
+void Viewer::lockSnapshots(bool updatedExperiment)
+{
+   Cluster::MulticastPipe* pipe = Vrui::getMainPipe();
+   bool showStep = true;
+
+   if (pipe == 0)
+   {
+      // changes apply before the next step
+      simulationQueue.schedule(simulationStep);
+   }
+   else if (Vrui::isMaster())
+   {
+      // no simulation thread goes past the last limit, so the changes posted
+      // since then apply after it on every node
+      unsigned int boundary = grantedStep;
+
+      // show the granted steps once they are published, and grant more
+      showStep = simulationQueue.getPublishedStep() == grantedStep;
+      if (showStep)
+      {
+         displayedStep = grantedStep;
+
+         // a rate of zero pauses stepping
+         double maxRate = frameRateDialog->getThrottledFrameRate();
+         grantedFraction += std::max(maxRate, 0.0) * Vrui::getCurrentFrameTime();
+         unsigned int steps = (unsigned int) grantedFraction;
+         grantedFraction -= steps;
+         grantedStep += steps;
+      }
+
+      pipe->write<unsigned int>(displayedStep);
+      pipe->write<unsigned int>(boundary);
+      pipe->write<unsigned int>(grantedStep);
+      pipe->flush();
+
+      simulationQueue.schedule(boundary);
+   }
+   else
+   {
+      unsigned int step = pipe->read<unsigned int>();
+      unsigned int boundary = pipe->read<unsigned int>();
+      grantedStep = pipe->read<unsigned int>();
+
+      // the master has published this step; the limit keeps this node from
+      // going past it
+      showStep = step != displayedStep;
+      if (showStep)
+      {
+         simulationQueue.waitForStep(step);
+         displayedStep = step;
+      }
+
+      simulationQueue.schedule(boundary);
+   }
+
+   for (ToolList::iterator tool=tools.begin(); tool != tools.end(); ++tool)
+   {
+      if ((*tool)->isDisabled())
+         continue;
+
+      if (updatedExperiment)
+      {
+         Threads::Mutex::Lock stepLock((*tool)->getStepMutex());
+         (*tool)->updatedExperiment();
+      }
+
+      // pick up the latest simulation results for display()
+      if (showStep)
+         (*tool)->lockSnapshot();
+   }
+
+   // only now may the simulation go past the step shown
+   if (pipe != 0)
+      simulationQueue.setLimit(grantedStep);
+}
+
+void Viewer::settleSimulation()
+{
+   if (Vrui::getMainPipe() != 0)
+      simulationQueue.waitForStep(grantedStep);
+}
+
 void Viewer::beginLogo()
 {
 	showingLogo = true;
@@ -650,6 +826,9 @@ void Viewer::toolCreationCallback(Vrui::ToolManager::ToolCreationCallbackData* c
 
    if (toolbox == 0) // If we don't already have a ToolBox
    {
+      settleSimulation();
+      Threads::Mutex::Lock simulationLock(simulationMutex);
+
       // store it
       toolbox = toolBox;
 
@@ -729,6 +908,11 @@ void Viewer::toolDestructionCallback(Vrui::ToolManager::ToolDestructionCallbackD
    if (toolBox != 0 && toolBox == toolbox)
    {
       // need to fix this to handle multiple users each with their own toolbox
+      settleSimulation();
+      Threads::Mutex::Lock simulationLock(simulationMutex);
+
+      // queued changes refer to the tools
+      simulationQueue.flush();
       tools.clear();
       toolmap.clear();
 
@@ -754,6 +938,7 @@ void Viewer::resetView()
     {
         // if experiment defines default view, go there.
         // otherwise, go to center.
+        ParameterClass<double>::Pin transformerPin(*experiment->transformer);
         DTS::Vector<double> center = experiment->transformer->getCenterPoint();
         Vrui::Point p;
         p[0] = center[0];
@@ -856,6 +1041,7 @@ void Viewer::dynamicsMenuCallback(GLMotif::ToggleButton::ValueChangedCallbackDat
 	if (it != toolmap.end())
 	{
 		StaticSolverTool* tool = static_cast<StaticSolverTool*>(it->second);
+		ParameterClass<double>::Pin transformerPin(*experiment->transformer);
 		tool->addStaticSolution(experiment->transformer->getDefaultPoint());
 	}
 
@@ -882,6 +1068,13 @@ void Viewer::setExperiment(std::string name, bool updateToggle)
 {
    bool popup=false;
 
+   // keep the simulation thread away while the experiment changes
+   settleSimulation();
+   Threads::Mutex::Lock simulationLock(simulationMutex);
+
+   // queued changes refer to the current experiment
+   simulationQueue.flush();
+
    // delete current dynamical model
    if (experiment != NULL)
       delete experiment;
@@ -912,7 +1105,7 @@ void Viewer::setExperiment(std::string name, bool updateToggle)
    experiment = Factory[name]();
 
    // create/assign parameter dialog
-   experimentDialog = new ExperimentDialog(mainMenu, experiment);
+   experimentDialog = new ExperimentDialog(mainMenu, experiment, simulationQueue);
    if (dialogExisted)
    {
         experimentDialog->setTransformation(oldTrans);
@@ -23,6 +23,8 @@
 // Vrui includes
 //
 #include <Vrui/Application.h>
+#include <Threads/Mutex.h>
+#include <Threads/Thread.h>
 #include <GL/GLObject.h>
 #include <IO/OpenFile.h>
 
@@ -40,6 +42,8 @@
 #include "PositionDialog.h"
 #include "FrameRateDialog.h"
 #include "ExperimentDialog.h"
+#include "SimulationQueue.h"
+#include "ThreadPool.h"
 
 // External includes
 //
@@ -94,9 +98,46 @@ class Viewer: public Vrui::Application, public GLObject
 
       void setExperiment(std::string, bool updateToggle=true);
 
+      /** Worker threads shared by all tools for stepping particles.
+       */
+      ThreadPool* getThreadPool() const
+      {
+         return threadPool;
+      }
+
+      /** Changes to the simulation made by the user interface are posted
+       *  here; the simulation thread applies them between steps.
+       */
+      SimulationQueue& getSimulationQueue()
+      {
+         return simulationQueue;
+      }
+
+      /** Steps taken by the simulation. On the simulation thread, in a step
+       *  or a change, this is the same on every cluster node.
+       */
+      unsigned int getSimulationStep() const
+      {
+         return simulationStep;
+      }
+
    private:
       ToolList tools; ///< Array of all tools currently being used.
       Experiment<Scalar> *experiment;
+      ThreadPool* threadPool; ///< Workers for stepping (size set by -threads <n>).
+
+      /* Simulation thread: steps the tools independently of frame() */
+      Threads::Thread simulationThread;
+      Threads::Mutex simulationMutex; ///< Held while stepping; guards tools and experiment.
+      SimulationQueue simulationQueue; ///< Changes waiting for the simulation thread.
+      volatile bool simulating; ///< Cleared to stop the simulation thread.
+      volatile double simulationRate; ///< Measured simulation steps per second.
+      volatile unsigned int simulationStep; ///< Steps taken by the simulation thread.
+
+      /* Cluster lockstep (see lockSnapshots()) */
+      unsigned int displayedStep; ///< Step whose snapshots render() shows.
+      unsigned int grantedStep; ///< Steps the simulation may take so far.
+      double grantedFraction; ///< Master: part of a step owed to the rate.
 
       FrameRateDialog* frameRateDialog; ///< Dialog for throttling the frame rate.
       PositionDialog* positionDialog; ///< Dialog for displaying cursor position.
@@ -122,7 +163,6 @@ class Viewer: public Vrui::Application, public GLObject
       DLList dl_list; ///< Dynamic library (plugin) list.
       std::vector<std::string> experiment_names; ///< Names of all experiments (obtained from plugins).
 
-      double elapsedTime; // Cummulative time between frames (that is reset frequently)
       double absoluteTime;
 
       /* Output streams */
@@ -133,6 +173,7 @@ class Viewer: public Vrui::Application, public GLObject
       bool showingLogo; // whether the logo is presently being showed
       bool firstTime; // for the first time the logo is drawn
       bool startLogo;
+      double logoStepSize; // step size while the logo is shown, shrinking
 
       /* Internal methods */
 
@@ -146,6 +187,39 @@ class Viewer: public Vrui::Application, public GLObject
        */
       void setRadioToggles(ToggleArray& toggles, const std::string& name);
 
+      /** Body of the simulation thread.
+       *
+       * Steps all enabled tools, no faster than the maximum rate set in the
+       * frame rate dialog, until simulating is cleared. Before each step it
+       * applies the changes from the user interface that are due. Tools
+       * publish their results as snapshots, which frame() picks up.
+       *
+       * On a cluster no node is paced by the clock. Every node steps up to
+       * the limit granted by the master's frame() and waits there.
+       */
+      void* simulationThreadMethod();
+
+      /** Makes the newest snapshots of all enabled tools visible to render(),
+       *  and schedules the changes posted since the last frame.
+       *
+       * On a cluster the master never waits for the simulation. Once its
+       * simulation thread has published the steps granted last frame, it
+       * shows that step and grants the steps due at the maximum rate. It
+       * sends the step shown, the boundary of the changes and the new limit
+       * to the slaves, which show the same step, waiting for their own
+       * simulation thread to publish it if needed. Every node applies the
+       * changes after the same step.
+       */
+      void lockSnapshots(bool updatedExperiment);
+
+      /** Waits on a cluster until the simulation has taken all steps
+       *  granted so far; it takes no more before the next frame. Tools or
+       *  experiments changed afterwards, outside the queue, thus change
+       *  after the same step on every node. Call without holding the
+       *  simulation mutex.
+       */
+      void settleSimulation();
+
       /** Internal method for loading plugins (dlls).
        *
        * Searches the plugins directory for dynamic libraries. Each library
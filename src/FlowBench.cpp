@@ -0,0 +1,578 @@
+/*******************************************************************************
+ FlowBench: Headless integrator throughput benchmark.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** Steps particles of an experiment plugin without a display.
+ *
+ * Usage:
+ * \code
+ * flow-bench [--plugins DIR | --plugin FILE] [--experiment NAME]
+ *            [--integrator NAME] [--particles N] [--steps M] [--threads T]
+ *            [--mode batch|single] [--generic] [--rhs-reps R] [--quantize]
+ *            [--virtual]
+ * \endcode
+ *
+ * The particles start near the model's default point and are advanced M
+ * times, split over T threads exactly as the dot spreader does. "batch"
+ * steps ranges with Integrator::stepBatch, "single" calls step() once per
+ * particle. --generic disables the kernels specialized for the model
+ * dimension (RungeKutta4 single steps only). --virtual replaces the
+ * experiment's rk4 integrator, which plugins bind to their model type
+ * (StaticRungeKutta4), by a RungeKutta4 with the same step size that
+ * evaluates the model through DynamicalModel. The cost of one right-hand
+ * side evaluation is measured separately on one thread. --quantize also
+ * projects the final particles and quantizes them as the dot spreader's
+ * compact vertices, reporting the position error and the cost of both
+ * vertex formats. Without a GL context only host memory is measured: the
+ * copy throughputs are those of memcpy, not of an upload to the GPU. The
+ * results are written to stdout as one JSON object.
+ */
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+// STL includes
+//
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Project includes
+//
+#include "Dynamics/Factory.h"
+#include "Dynamics/ParticleStateArena.h"
+#include "Dynamics/Pack.h"
+#include "Dynamics/RungeKutta4.h"
+#include "Quantizer.h"
+#include "ThreadPool.h"
+
+///< Global object the experiment plugins register with
+ExperimentFactory Factory;
+
+typedef DTS::ParticleStateArena<double> StateArray;
+
+namespace
+{
+
+/** Benchmark settings taken from the command line. */
+struct Options
+{
+   std::string pluginDir;
+   std::string plugin;
+   std::string experiment;
+   std::string integrator;
+   size_t particles;
+   size_t steps;
+   unsigned int threads;
+   bool batch;
+   bool specialized;
+   size_t rhsReps;
+   bool quantize;
+   bool virtualModel;
+
+   Options() :
+      pluginDir("plugins"), particles(10000), steps(1000), threads(0),
+      batch(true), specialized(true), rhsReps(100), quantize(false),
+      virtualModel(false)
+   {
+   }
+};
+
+double getWallTime()
+{
+   struct timeval tv;
+   gettimeofday(&tv, 0);
+   return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/** Peak resident set size of this process in kilobytes. */
+long getPeakRss()
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+   return usage.ru_maxrss / 1024; // bytes on Darwin
+#else
+   return usage.ru_maxrss;
+#endif
+}
+
+std::string jsonString(const std::string& value)
+{
+   std::string result="\"";
+   for (std::string::const_iterator c=value.begin(); c != value.end(); ++c)
+   {
+      if (*c == '"' || *c == '\\')
+         result+='\\';
+      result+=*c;
+   }
+   return result+"\"";
+}
+
+void usage(const char* program)
+{
+   std::cerr << "usage: " << program
+         << " [--plugins DIR | --plugin FILE] [--experiment NAME]\n"
+         << "       [--integrator NAME] [--particles N] [--steps M] [--threads T]\n"
+         << "       [--mode batch|single] [--generic] [--rhs-reps R] [--quantize]\n"
+         << "       [--virtual]" << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+   for (int i=1; i < argc; i++)
+   {
+      std::string arg=argv[i];
+
+      if (arg == "--generic")
+      {
+         options.specialized=false;
+         continue;
+      }
+      if (arg == "--quantize")
+      {
+         options.quantize=true;
+         continue;
+      }
+      if (arg == "--virtual")
+      {
+         options.virtualModel=true;
+         continue;
+      }
+
+      // everything else takes a value
+      if (i + 1 >= argc)
+         return false;
+      std::string value=argv[++i];
+
+      if (arg == "--plugins")
+         options.pluginDir=value;
+      else if (arg == "--plugin")
+         options.plugin=value;
+      else if (arg == "--experiment")
+         options.experiment=value;
+      else if (arg == "--integrator")
+         options.integrator=value;
+      else if (arg == "--particles")
+         options.particles=strtoul(value.c_str(), 0, 10);
+      else if (arg == "--steps")
+         options.steps=strtoul(value.c_str(), 0, 10);
+      else if (arg == "--threads")
+         options.threads=strtoul(value.c_str(), 0, 10);
+      else if (arg == "--rhs-reps")
+         options.rhsReps=strtoul(value.c_str(), 0, 10);
+      else if (arg == "--mode" && (value == "batch" || value == "single"))
+         options.batch=(value == "batch");
+      else
+         return false;
+   }
+   return options.particles > 0 && options.rhsReps > 0;
+}
+
+/** Opens one plugin, which registers its experiment with the Factory. */
+bool openPlugin(const std::string& file)
+{
+   if (dlopen(file.c_str(), RTLD_NOW) == 0)
+   {
+      std::cerr << dlerror() << std::endl;
+      return false;
+   }
+   return true;
+}
+
+/** Opens every plugin library in directory. */
+bool openPlugins(const std::string& directory)
+{
+   DIR* dir=opendir(directory.c_str());
+   if (dir == 0)
+   {
+      std::cerr << "Cannot read plugin directory " << directory << std::endl;
+      return false;
+   }
+
+   bool ok=true;
+   struct dirent* entry;
+   while ((entry=readdir(dir)) != 0)
+   {
+      std::string name=entry->d_name;
+      if (name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0)
+         ok=openPlugin(directory + "/" + name) && ok;
+   }
+   closedir(dir);
+   return ok;
+}
+
+/** Advances a range of particles, like the dot spreader step task. */
+class StepTask: public ThreadPool::Task
+{
+   public:
+      StepTask(ThreadPool& pool, Integrator<double>& integrator,
+            StateArray& states, bool batch) :
+         pool(pool), integrator(integrator), states(states), batch(batch)
+      {
+      }
+
+      void run(size_t begin, size_t end, unsigned int thread)
+      {
+         ThreadPool::Scratch& scratch=pool.getScratch(thread);
+
+         if (batch)
+         {
+            double* first=states.getData() + begin;
+            integrator.stepBatch(first, first, end - begin,
+                  states.getStride(), scratch.integrator);
+            return;
+         }
+
+         int dimension=states.getDimension();
+         scratch.state.setDimension(dimension);
+         scratch.display.setDimension(dimension);
+         for (size_t i=begin; i < end; i++)
+         {
+            states.getState(i, scratch.state);
+            integrator.step(scratch.state, scratch.display, scratch.integrator);
+            for (int j=0; j < dimension; j++)
+               states(i, j)+=scratch.display[j];
+         }
+      }
+
+   private:
+      ThreadPool& pool;
+      Integrator<double>& integrator;
+      StateArray& states;
+      bool batch;
+};
+
+/** Vertex of the dot spreader, projected on the CPU (ColorPoint). */
+struct FloatVertex
+{
+   unsigned char color[4];
+   float pos[3];
+};
+
+/** Same, with the position quantized (QuantizedPoint). The colors are
+ *  uploaded apart, only when they change, so they are not part of it.
+ */
+struct CompactVertex
+{
+   short pos[3];
+   short w;
+};
+
+/** Results of quantizing the projected particles. */
+struct QuantizeResult
+{
+   double boxHalfWidth;
+   double maxError; ///< Largest error of a coordinate inside the box.
+   double rmsError; ///< Root mean square of those errors.
+   size_t clamped; ///< Particles outside the box, or diverged.
+   double nsPerQuantize; ///< Per particle, projection excluded.
+   double floatHostCopyGBps; ///< memcpy throughput of the float vertices.
+   double compactHostCopyGBps; ///< Same, for the compact vertices.
+
+   QuantizeResult() :
+      boxHalfWidth(0.0), maxError(0.0), rmsError(0.0), clamped(0),
+      nsPerQuantize(0.0), floatHostCopyGBps(0.0), compactHostCopyGBps(0.0)
+   {
+   }
+};
+
+/** Bytes copied per second, in GB/s, for reps copies of size bytes from
+ *  host memory to host memory.
+ */
+double measureCopy(const void* source, size_t size, size_t reps)
+{
+   std::vector<char> target(size);
+   double start=getWallTime();
+   for (size_t r=0; r < reps; r++)
+      memcpy(&target[0], source, size);
+   double elapsed=getWallTime() - start;
+
+   volatile char sink=target[size - 1];
+   (void) sink;
+
+   return elapsed > 0.0 ? double(size) * double(reps) / elapsed * 1e-9 : 0.0;
+}
+
+/** Projects the particles like the dot spreader, then compares its float
+ *  vertices with the compact ones quantized within twice the
+ *  transformer's radius around its center point.
+ */
+QuantizeResult measureQuantize(const Transformer<double>& transformer,
+      const StateArray& states, size_t reps)
+{
+   QuantizeResult result;
+   size_t count=states.size();
+   std::vector<FloatVertex> vertices(count);
+   std::vector<CompactVertex> compact(count);
+
+   DTS::Vector<double> state(states.getDimension());
+   DTS::Vector<double> display(3);
+   for (size_t i=0; i < count; i++)
+   {
+      states.getState(i, state);
+      transformer.transform(state, display);
+      for (int j=0; j < 3; j++)
+         vertices[i].pos[j]=display[j];
+      for (int j=0; j < 4; j++)
+         vertices[i].color[j]=255;
+   }
+
+   DTS::Vector<double> center=transformer.getCenterPoint();
+   double box[3]= { center[0], center[1], center[2] };
+   result.boxHalfWidth=2.0 * transformer.getRadius();
+   DTS::Quantizer quantizer;
+   quantizer.setBox(box, result.boxHalfWidth);
+
+   double start=getWallTime();
+   for (size_t r=0; r < reps; r++)
+   {
+      for (size_t i=0; i < count; i++)
+      {
+         for (int j=0; j < 3; j++)
+            compact[i].pos[j]=quantizer.quantize(vertices[i].pos[j], j);
+         compact[i].w=1;
+      }
+   }
+   result.nsPerQuantize=(getWallTime() - start) * 1e9 / (double(reps) * double(count));
+
+   // error of the dequantized positions; clamped ones are reported apart
+   double sumSquares=0.0;
+   size_t inside=0;
+   for (size_t i=0; i < count; i++)
+   {
+      bool clamped=false;
+      double errors[3];
+      for (int j=0; j < 3; j++)
+      {
+         short q=compact[i].pos[j];
+         clamped=clamped || q == DTS::Quantizer::Range || q == -DTS::Quantizer::Range;
+         errors[j]=std::fabs(quantizer.dequantize(q, j) - double(vertices[i].pos[j]));
+      }
+      if (clamped)
+      {
+         result.clamped++;
+         continue;
+      }
+      for (int j=0; j < 3; j++)
+      {
+         result.maxError=errors[j] > result.maxError ? errors[j] : result.maxError;
+         sumSquares+=errors[j] * errors[j];
+      }
+      inside++;
+   }
+   if (inside > 0)
+      result.rmsError=std::sqrt(sumSquares / (3.0 * inside));
+
+   result.floatHostCopyGBps=measureCopy(&vertices[0], count * sizeof(FloatVertex), reps);
+   result.compactHostCopyGBps=measureCopy(&compact[0], count * sizeof(CompactVertex), reps);
+   return result;
+}
+
+/** Nanoseconds per right-hand side evaluation on the calling thread. */
+double measureRhs(const DynamicalModel<double>& model, const StateArray& states,
+      size_t reps, bool batch)
+{
+   int dimension=states.getDimension();
+   size_t count=states.size();
+   size_t stride=states.getStride();
+   std::vector<double> out(dimension * stride);
+   std::vector<double> point(dimension);
+
+   double start=getWallTime();
+   for (size_t r=0; r < reps; r++)
+   {
+      if (batch)
+      {
+         model.evaluateBatch(states.getData(), &out[0], count, stride);
+         continue;
+      }
+
+      for (size_t i=0; i < count; i++)
+      {
+         for (int j=0; j < dimension; j++)
+            point[j]=states(i, j);
+         model.evaluate(&point[0], &out[i * dimension]);
+      }
+   }
+   double elapsed=getWallTime() - start;
+
+   // keep the evaluations from being optimized away
+   volatile double sink=out[0];
+   (void) sink;
+
+   return elapsed * 1e9 / (double(reps) * double(count));
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+   Options options;
+   if (!parseOptions(argc, argv, options))
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   bool loaded=options.plugin.empty() ? openPlugins(options.pluginDir)
+         : openPlugin(options.plugin);
+   if (!loaded || Factory.empty())
+   {
+      std::cerr << "No experiment plugins loaded" << std::endl;
+      return 1;
+   }
+
+   // pick the experiment; the name may be omitted when there is only one
+   if (options.experiment.empty() && Factory.size() == 1)
+      options.experiment=Factory.begin()->first;
+
+   ExperimentFactory::iterator maker=Factory.find(options.experiment);
+   if (maker == Factory.end())
+   {
+      std::cerr << "Choose an experiment with --experiment:";
+      for (ExperimentFactory::iterator it=Factory.begin(); it != Factory.end(); ++it)
+         std::cerr << " " << it->first;
+      std::cerr << std::endl;
+      return 1;
+   }
+
+   Experiment<double>* experiment=(*maker->second)();
+
+   try
+   {
+      if (!options.integrator.empty())
+         experiment->setIntegrator(options.integrator);
+   }
+   catch (std::exception& e)
+   {
+      std::cerr << e.what() << ": " << options.integrator << std::endl;
+      delete experiment;
+      return 1;
+   }
+
+   /* Step rk4 through the virtual model interface if asked to: */
+   DynamicalModel<double>& model=*experiment->model;
+   RungeKutta4* virtualRk4=0;
+   if (options.virtualModel && experiment->integrator->getName() == "rk4")
+   {
+      double stepSize=experiment->integrator->getRealParamValue("stepSize");
+      virtualRk4=new RungeKutta4(model, stepSize);
+   }
+
+   Integrator<double>& integrator=virtualRk4 ? *virtualRk4 : *experiment->integrator;
+   RungeKutta4* rk4=dynamic_cast<RungeKutta4*> (&integrator);
+   if (rk4 != 0)
+      rk4->setSpecialized(options.specialized);
+
+   /* Spread the particles around the default point: */
+   int dimension=model.getDimension();
+   DTS::Vector<double> center=model.getDefaultPoint();
+
+   StateArray states(dimension);
+   states.resize(options.particles);
+   unsigned int seed=1;
+   for (size_t i=0; i < options.particles; i++)
+   {
+      for (int j=0; j < dimension; j++)
+      {
+         seed=seed * 1103515245u + 12345u;
+         states(i, j)=center[j] + 1e-3 * ((seed >> 8) / double(1 << 24) - 0.5);
+      }
+   }
+
+   double rhsNs=measureRhs(model, states, options.rhsReps, options.batch);
+
+   /* Step the particles: */
+   ThreadPool pool(options.threads);
+   StepTask task(pool, integrator, states, options.batch);
+   size_t grain=options.batch ? 1024 : 256;
+
+   double start=getWallTime();
+   for (size_t s=0; s < options.steps; s++)
+      pool.parallelFor(states.size(), grain, task);
+   double elapsed=getWallTime() - start;
+
+   // sum of the final states, to compare runs of the same configuration
+   double checksum=0.0;
+   size_t diverged=0;
+   for (size_t i=0; i < states.size(); i++)
+   {
+      for (int j=0; j < dimension; j++)
+      {
+         double x=states(i, j);
+         if (x == x && std::fabs(x) <= 1e300)
+            checksum+=x;
+         else
+            diverged++;
+      }
+   }
+
+   double particleSteps=double(options.particles) * double(options.steps);
+
+   QuantizeResult quantized;
+   if (options.quantize)
+      quantized=measureQuantize(*experiment->transformer, states, options.rhsReps);
+
+   printf("{\n");
+   printf("  \"experiment\": %s,\n", jsonString(options.experiment).c_str());
+   printf("  \"integrator\": %s,\n", jsonString(integrator.getName()).c_str());
+   printf("  \"dimension\": %d,\n", dimension);
+   printf("  \"particles\": %lu,\n", (unsigned long) options.particles);
+   printf("  \"steps\": %lu,\n", (unsigned long) options.steps);
+   printf("  \"threads\": %u,\n", pool.getNumThreads());
+   printf("  \"mode\": %s,\n", options.batch ? "\"batch\"" : "\"single\"");
+   printf("  \"specialized\": %s,\n", options.specialized ? "true" : "false");
+   printf("  \"virtual\": %s,\n", virtualRk4 ? "true" : "false");
+   printf("  \"pack_width\": %d,\n", DTS_PACK_WIDTH);
+   printf("  \"seconds\": %.6f,\n", elapsed);
+   printf("  \"steps_per_sec\": %.6g,\n", elapsed > 0.0 ? particleSteps / elapsed : 0.0);
+   printf("  \"ns_per_rhs\": %.4f,\n", rhsNs);
+   printf("  \"peak_rss_kb\": %ld,\n", getPeakRss());
+   printf("  \"diverged_components\": %lu,\n", (unsigned long) diverged);
+   if (options.quantize)
+   {
+      printf("  \"quantize\": {\n");
+      printf("    \"float_bytes_per_particle\": %lu,\n", (unsigned long) sizeof(FloatVertex));
+      printf("    \"compact_bytes_per_particle\": %lu,\n", (unsigned long) sizeof(CompactVertex));
+      printf("    \"box_half_width\": %.6g,\n", quantized.boxHalfWidth);
+      printf("    \"max_error\": %.6g,\n", quantized.maxError);
+      printf("    \"rms_error\": %.6g,\n", quantized.rmsError);
+      printf("    \"max_error_relative\": %.6g,\n", quantized.boxHalfWidth > 0.0
+            ? quantized.maxError / quantized.boxHalfWidth : 0.0);
+      printf("    \"clamped_particles\": %lu,\n", (unsigned long) quantized.clamped);
+      printf("    \"ns_per_quantize\": %.4f,\n", quantized.nsPerQuantize);
+      printf("    \"float_host_copy_gbps\": %.4f,\n", quantized.floatHostCopyGBps);
+      printf("    \"compact_host_copy_gbps\": %.4f\n", quantized.compactHostCopyGBps);
+      printf("  },\n");
+   }
+   printf("  \"checksum\": %.17g\n", checksum);
+   printf("}\n");
+
+   delete virtualRk4;
+   delete experiment;
+   return 0;
+}
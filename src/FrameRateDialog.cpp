@@ -16,12 +16,17 @@ GLMotif::PopupWindow* FrameRateDialog::createDialog()
   GLMotif::RowColumn* frameRateDialog = factory.createRowColumn("FrameRateDialog", 3);
   factory.setLayout(frameRateDialog);
 
-  factory.createLabel("FrameRateLabel", "Vrui Frame Rate");
+  factory.createLabel("FrameRateLabel", "Render Frame Rate");
   currentFrameRate = factory.createTextField("CurrentFrameRate", 10);
   currentFrameRate->setString("120.0");
   factory.createLabel("DummyLabel", "");
 
-  factory.createLabel("ThrottledFrameRateLabel", "Maximum DTS Frame Rate");
+  factory.createLabel("SimulationRateLabel", "Simulation Steps/sec");
+  currentSimulationRate = factory.createTextField("CurrentSimulationRate", 10);
+  currentSimulationRate->setString("0.0");
+  factory.createLabel("DummyLabel2", "");
+
+  factory.createLabel("ThrottledFrameRateLabel", "Maximum Simulation Rate");
   currentThrottledFrameRate = factory.createTextField("CurrentThrottledFrameRate", 10);
   currentThrottledFrameRate->setString("60.0");
   throttledFrameRateSlider = factory.createSlider("ThrottledFrameRateSlider", 15.0);
@@ -54,6 +59,14 @@ void FrameRateDialog::setFrameRate(double frameRate)
   currentFrameRate->setString(buff);
 }
 
+void FrameRateDialog::setSimulationRate(double stepsPerSecond)
+{
+  char buff[10];
+  snprintf(buff, sizeof(buff), "%3.2f", stepsPerSecond);
+
+  currentSimulationRate->setString(buff);
+}
+
 double FrameRateDialog::getThrottledFrameRate()
 {
   return throttledFrameRate;
@@ -9,6 +9,7 @@ class FrameRateDialog : public CaveDialog
   GLMotif::Slider *throttledFrameRateSlider;
   GLMotif::TextField *currentThrottledFrameRate;
   GLMotif::TextField *currentFrameRate;
+  GLMotif::TextField *currentSimulationRate;
 
   double throttledFrameRate;
 
@@ -28,6 +29,9 @@ public:
   virtual ~FrameRateDialog() { }
 
   void setFrameRate(double frameRate);
+  void setSimulationRate(double stepsPerSecond);
+
+  // Upper bound on simulation steps per second (read by the simulation thread)
   double getThrottledFrameRate();
 };
 
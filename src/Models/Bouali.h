@@ -3,16 +3,18 @@
 
 #include <limits>
 
-#include <DynamicalModel.h>
+#include <GenericModel.h>
 #include <Coordinate.h>
 #include <Parameter.h>
 
 // http://arxiv.org/abs/1204.0045
-class Bouali : public DynamicalModel<double>
+class Bouali : public GenericModel<Bouali>
 {
 public:
+    static const int Dimension = 4;
+
     Bouali(Scalar alpha=0.3, Scalar s=1)
-    : DynamicalModel<double>()
+    : GenericModel<Bouali>()
     {
         name = "Bouali";
 
@@ -20,7 +22,7 @@ public:
         addCoordinate( Coordinate("x", -3, -5, 5) );
         addCoordinate( Coordinate("y", .6, 0, 20) );
         addCoordinate( Coordinate("z", 1.2, -5, 5) );
-        addCoordinate( Coordinate("t", 0, 0, inf) );
+        addTimeCoordinate( Coordinate("t", 0, 0, inf) );
 
         addRealParameter( RealParameter("alpha", alpha, 0, 10,  .3,    0.01) );
         addRealParameter( RealParameter("s",   s,   0, 8, 1, 0.01) );
@@ -35,12 +37,17 @@ public:
 
     virtual ~Bouali() { }
 
-    virtual void operator()(Vector const& p, Vector & out) const
+    // Right-hand side for S = double or S = DTS::Pack<double>
+    template <class S>
+    static void rhs(S const* p, S* out, double const* params)
     {
-        out[0] = p[0] * (4 - p[1]) + realParamValues[0] * p[2];
+        Scalar const alpha = params[0];
+        Scalar const s = params[1];
+
+        out[0] = p[0] * (4 - p[1]) + alpha * p[2];
         out[1] = -p[1] * (1 - p[0] * p[0]);
-        out[2] = -p[0] * (1.5 - realParamValues[1] * p[2]) - 0.05 * p[2];
-        out[3] = 1;
+        out[2] = -p[0] * (1.5 - s * p[2]) - 0.05 * p[2];
+        out[3] = S(1);
     }
 };
 
@@ -3,15 +3,17 @@
 
 #include <limits>
 
-#include <DynamicalModel.h>
+#include <GenericModel.h>
 #include <Coordinate.h>
 #include <Parameter.h>
 
-class Lorenz : public DynamicalModel<double>
+class Lorenz : public GenericModel<Lorenz>
 {
 public:
+    static const int Dimension = 4;
+
     Lorenz(Scalar sigma=10, Scalar rho=28, Scalar beta=8/3.0)
-    : DynamicalModel<double>()
+    : GenericModel<Lorenz>()
     {
         name = "Lorenz";
 
@@ -19,7 +21,7 @@ public:
         addCoordinate( Coordinate("x", 1, -30, 30) );
         addCoordinate( Coordinate("y", 1, -30, 30) );
         addCoordinate( Coordinate("z", 1, 0, 50) );
-        addCoordinate( Coordinate("t", 0, 0, inf) ); 
+        addTimeCoordinate( Coordinate("t", 0, 0, inf) ); 
 
         addRealParameter( RealParameter("sigma", sigma, 0, 20,  10,    0.1) );
         addRealParameter( RealParameter("rho",   rho,   0, 100, 28,    0.1) );
@@ -35,12 +37,18 @@ public:
 
     virtual ~Lorenz() { }
 
-    virtual void operator()(Vector const& p, Vector & out) const
+    // Right-hand side for S = double or S = DTS::Pack<double>
+    template <class S>
+    static void rhs(S const* p, S* out, double const* params)
     {
-        out[0] = realParamValues[0] * (p[1] - p[0]);
-        out[1] = realParamValues[1] * p[0] - p[1] - p[0] * p[2];
-        out[2] = p[0] * p[1] - realParamValues[2] * p[2];
-        out[3] = 1;
+        Scalar const sigma = params[0];
+        Scalar const rho = params[1];
+        Scalar const beta = params[2];
+
+        out[0] = sigma * (p[1] - p[0]);
+        out[1] = rho * p[0] - p[1] - p[0] * p[2];
+        out[2] = p[0] * p[1] - beta * p[2];
+        out[3] = S(1);
     }
 };
 
@@ -3,15 +3,17 @@
 
 #include <limits>
 
-#include <DynamicalModel.h>
+#include <GenericModel.h>
 #include <Coordinate.h>
 #include <Parameter.h>
 
-class Owl : public DynamicalModel<double>
+class Owl : public GenericModel<Owl>
 {
 public:
+    static const int Dimension = 4;
+
     Owl(Scalar a=10, Scalar b=10, Scalar c=13)
-    : DynamicalModel<double>()
+    : GenericModel<Owl>()
     {
         name = "Owl";
 
@@ -19,7 +21,7 @@ public:
         addCoordinate( Coordinate("x", .5, -15, 15) );
         addCoordinate( Coordinate("y", .5, -15, 15) );
         addCoordinate( Coordinate("z", .5, 0, 20) );
-        addCoordinate( Coordinate("t", 0, 0, inf) );        
+        addTimeCoordinate( Coordinate("t", 0, 0, inf) );        
 
         addRealParameter( RealParameter("a", a, -20, 20,  10, .01) );
         addRealParameter( RealParameter("b", b, -20, 20,  10, .01) );
@@ -34,12 +36,18 @@ public:
 
     virtual ~Owl() { }
 
-    virtual void operator()(Vector const& p, Vector & out) const
+    // Right-hand side for S = double or S = DTS::Pack<double>
+    template <class S>
+    static void rhs(S const* p, S* out, double const* params)
     {
-        out[0] = -realParamValues[0] * (p[0] + p[1]);
-        out[1] = -p[1] - realParamValues[1] * p[0] * p[2];
-        out[2] = 10 * p[0] * p[1] + realParamValues[2];
-        out[3] = 1;
+        Scalar const a = params[0];
+        Scalar const b = params[1];
+        Scalar const c = params[2];
+
+        out[0] = -a * (p[0] + p[1]);
+        out[1] = -p[1] - b * p[0] * p[2];
+        out[2] = 10 * p[0] * p[1] + c;
+        out[3] = S(1);
     }
 };
 
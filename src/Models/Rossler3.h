@@ -3,15 +3,17 @@
 
 #include <limits>
 
-#include <DynamicalModel.h>
+#include <GenericModel.h>
 #include <Coordinate.h>
 #include <Parameter.h>
 
-class Rossler3 : public DynamicalModel<double>
+class Rossler3 : public GenericModel<Rossler3>
 {
 public:
+    static const int Dimension = 4;
+
     Rossler3(Scalar a=.2,  Scalar b=.2, Scalar c=5.7)
-    : DynamicalModel<double>()
+    : GenericModel<Rossler3>()
     {
         name = "Rossler";
 
@@ -19,7 +21,7 @@ public:
         addCoordinate( Coordinate("x", 5, -20, 20) );
         addCoordinate( Coordinate("y", 5, -15, 10) );
         addCoordinate( Coordinate("z", 5, 0, 20) );
-        addCoordinate( Coordinate("t", 0, 0, inf) );   
+        addTimeCoordinate( Coordinate("t", 0, 0, inf) );   
 
         addRealParameter( RealParameter("a", a, -.5,    .5,  0.2, 0.01) );
         addRealParameter( RealParameter("b", b, -.5,    .5,  0.2, 0.01) );
@@ -35,12 +37,18 @@ public:
 
     virtual ~Rossler3() { }
 
-    virtual void operator()(Vector const& p, Vector & out) const
+    // Right-hand side for S = double or S = DTS::Pack<double>
+    template <class S>
+    static void rhs(S const* p, S* out, double const* params)
     {
+        Scalar const a = params[0];
+        Scalar const b = params[1];
+        Scalar const c = params[2];
+
         out[0] = -p[1] - p[2];
-        out[1] = p[0] + realParamValues[0] * p[1];
-        out[2] = realParamValues[1] + p[2] * (p[0] - realParamValues[2]);
-        out[3] = 1;
+        out[1] = p[0] + a * p[1];
+        out[2] = b + p[2] * (p[0] - c);
+        out[3] = S(1);
     }
 };
 
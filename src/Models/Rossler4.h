@@ -3,15 +3,17 @@
 
 #include <limits>
 
-#include <DynamicalModel.h>
+#include <GenericModel.h>
 #include <Coordinate.h>
 #include <Parameter.h>
 
-class Rossler4 : public DynamicalModel<double>
+class Rossler4 : public GenericModel<Rossler4>
 {
 public:
+    static const int Dimension = 5;
+
     Rossler4(Scalar a=.25,  Scalar b=-.5, Scalar c=2.2, Scalar d=.05)
-    : DynamicalModel<double>()
+    : GenericModel<Rossler4>()
     {
         name = "Hyperchaos";
 
@@ -20,7 +22,7 @@ public:
         addCoordinate( Coordinate("y", 0, -80, 10) );
         addCoordinate( Coordinate("z", 0, 0, 30) );
         addCoordinate( Coordinate("w", 15, 0, 70) );        
-        addCoordinate( Coordinate("t", 0, 0, inf) );                
+        addTimeCoordinate( Coordinate("t", 0, 0, inf) );                
 
         addRealParameter( RealParameter("a", a, 0,    2.0,  0.25, 0.01) );
         addRealParameter( RealParameter("b", b, -2,   2.0, -0.50, 0.01) );
@@ -38,13 +40,20 @@ public:
 
     virtual ~Rossler4() { }
 
-    virtual void operator()(Vector const& p, Vector & out) const
+    // Right-hand side for S = double or S = DTS::Pack<double>
+    template <class S>
+    static void rhs(S const* p, S* out, double const* params)
     {
+        Scalar const a = params[0];
+        Scalar const b = params[1];
+        Scalar const c = params[2];
+        Scalar const d = params[3];
+
         out[0] = -p[1] - p[2];
-        out[1] = p[0] + realParamValues[0] * p[1] + p[3];
-        out[2] = realParamValues[2] + p[0] * p[2];
-        out[3] = realParamValues[1] * p[2] + realParamValues[3] * p[3];
-        out[4] = 1;
+        out[1] = p[0] + a * p[1] + p[3];
+        out[2] = c + p[0] * p[2];
+        out[3] = b * p[2] + d * p[3];
+        out[4] = S(1);
     }
 };
 
@@ -0,0 +1,197 @@
+/*******************************************************************************
+ ParameterCheck: Stress test for parameter snapshot reclamation.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+
+/** Changes a parameter while other threads pin it without pause.
+ *
+ * Usage:
+ * \code
+ * parameter-check [--readers R] [--changes N] [--max-retired M]
+ * \endcode
+ *
+ * R reader threads pin the parameters, check that the snapshot they see
+ * is consistent and release the Pin, over and over, as stepping threads
+ * do with one Pin per batch. Meanwhile the main thread publishes N changes
+ * as fast as it can, like a slider being dragged without pause. The check
+ * fails if the number of replaced snapshots waiting to be reclaimed ever
+ * exceeds M (by default ParameterClass::MaxRetired), or if a reader sees a
+ * torn snapshot. The exit status is 0 on success.
+ */
+
+#include <pthread.h>
+
+// STL includes
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Project includes
+//
+#include "Dynamics/Parameter.h"
+
+namespace
+{
+
+/** Parameters whose values are all set to the same number by each change. */
+class CheckParameters: public ParameterClass<double>
+{
+   public:
+      static const int NumValues = 8;
+
+      CheckParameters() :
+         version(0)
+      {
+         for (int i=0; i < NumValues; i++)
+         {
+            char name[16];
+            sprintf(name, "p%d", i);
+            addRealParameter(RealParameter(name, 0.0, -1e9, 1e9, 0.0, 1.0));
+         }
+      }
+
+      /** Sets all values to value, one change per value. */
+      void setAll(double value)
+      {
+         for (int i=0; i < NumValues; i++)
+         {
+            char name[16];
+            sprintf(name, "p%d", i);
+            setRealParamValue(name, value);
+         }
+      }
+
+   protected:
+      unsigned int updateVersion()
+      {
+         return ++version;
+      }
+
+   private:
+      unsigned int version;
+};
+
+struct Reader
+{
+   CheckParameters* parameters;
+   volatile bool* done;
+   unsigned long pins;
+   unsigned long torn;
+   pthread_t thread;
+};
+
+void* readerMain(void* argument)
+{
+   Reader& reader=*static_cast<Reader*> (argument);
+   while (!*reader.done)
+   {
+      ParameterClass<double>::Pin pin(*reader.parameters);
+      const ParameterClass<double>::Snapshot& snapshot=reader.parameters->getSnapshot();
+
+      // a change sets the values in order, so within one snapshot they
+      // never increase with the index
+      for (int i=1; i < CheckParameters::NumValues; i++)
+      {
+         if (snapshot.realValues[i] > snapshot.realValues[i - 1])
+         {
+            reader.torn++;
+            break;
+         }
+      }
+      reader.pins++;
+   }
+   return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+   int numReaders=4;
+   unsigned long numChanges=200000;
+   size_t maxRetired=ParameterClass<double>::MaxRetired;
+
+   for (int i=1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "--readers") == 0 && i + 1 < argc)
+         numReaders=atoi(argv[++i]);
+      else if (strcmp(argv[i], "--changes") == 0 && i + 1 < argc)
+         numChanges=strtoul(argv[++i], 0, 10);
+      else if (strcmp(argv[i], "--max-retired") == 0 && i + 1 < argc)
+         maxRetired=strtoul(argv[++i], 0, 10);
+      else
+      {
+         std::cerr << "usage: " << argv[0]
+               << " [--readers R] [--changes N] [--max-retired M]" << std::endl;
+         return 2;
+      }
+   }
+
+   CheckParameters parameters;
+   volatile bool done=false;
+
+   std::vector<Reader> readers(numReaders);
+   for (int i=0; i < numReaders; i++)
+   {
+      readers[i].parameters=&parameters;
+      readers[i].done=&done;
+      readers[i].pins=0;
+      readers[i].torn=0;
+      pthread_create(&readers[i].thread, 0, readerMain, &readers[i]);
+   }
+
+   size_t peakRetired=0;
+   unsigned long changes=0;
+   for (unsigned long value=1; changes < numChanges; value++)
+   {
+      parameters.setAll(double(value));
+      changes+=CheckParameters::NumValues;
+
+      size_t retired=parameters.getNumRetired();
+      if (retired > peakRetired)
+         peakRetired=retired;
+   }
+
+   done=true;
+   unsigned long pins=0;
+   unsigned long torn=0;
+   for (int i=0; i < numReaders; i++)
+   {
+      pthread_join(readers[i].thread, 0);
+      pins+=readers[i].pins;
+      torn+=readers[i].torn;
+   }
+
+   bool passed=peakRetired <= maxRetired && torn == 0;
+
+   std::cout << "{" << std::endl;
+   std::cout << "  \"readers\": " << numReaders << "," << std::endl;
+   std::cout << "  \"changes\": " << changes << "," << std::endl;
+   std::cout << "  \"pins\": " << pins << "," << std::endl;
+   std::cout << "  \"peak_retired\": " << peakRetired << "," << std::endl;
+   std::cout << "  \"final_retired\": " << parameters.getNumRetired() << "," << std::endl;
+   std::cout << "  \"torn\": " << torn << "," << std::endl;
+   std::cout << "  \"passed\": " << (passed ? "true" : "false") << std::endl;
+   std::cout << "}" << std::endl;
+
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+/*******************************************************************************
+ QuantizedPoint: Compact vertex of a particle.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef QUANTIZED_POINT_H
+#define QUANTIZED_POINT_H
+
+// Vrui includes
+//
+#include <GL/gl.h>
+
+/** Position of a particle in 8 instead of 16 bytes.
+ *
+ * The position is quantized by a DTS::Quantizer and drawn with
+ * glVertexPointer(4, GL_SHORT, ...). The fourth component is 1 for a
+ * plain point; shaders that read gl_Vertex.w get an attribute there
+ * instead, such as the quantized speed of a sprayed particle. Colors are
+ * not part of the vertex: they change far less often than positions and
+ * are uploaded on their own.
+ */
+struct QuantizedPoint
+{
+      GLshort pos[3]; ///< Quantized position of the particle.
+      GLshort w; ///< Homogeneous coordinate, or a per-particle attribute.
+};
+
+#endif
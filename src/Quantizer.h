@@ -0,0 +1,93 @@
+/*******************************************************************************
+ Quantizer: 16-bit quantization of display coordinates.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+#include <cmath>
+
+namespace DTS
+{
+
+/** Maps display coordinates to 16-bit integers and back.
+ *
+ * The integers cover a cube around a center point, which render() undoes
+ * with a translation and a uniform scaling of the modelview matrix:
+ * \code
+ *   x = offset + scale * q,  q in [-Range, Range]
+ * \endcode
+ * Points outside the cube are clamped to its faces, non-finite ones to
+ * its corner. The error of a point inside is at most scale / 2 per axis.
+ */
+class Quantizer
+{
+   public:
+      static const int Range=32767; ///< Largest magnitude of a quantized value.
+
+      Quantizer() :
+         scale(1.0f)
+      {
+         for (int j=0; j < 3; j++)
+            offset[j]=0.0f;
+      }
+
+      /** Covers the cube of half width halfWidth around center. */
+      void setBox(const double center[3], double halfWidth)
+      {
+         // a degenerate box would quantize everything to the center
+         if (!(halfWidth > 0.0 && halfWidth < 1e30))
+            halfWidth=1.0;
+
+         for (int j=0; j < 3; j++)
+            offset[j]=center[j];
+         scale=float(halfWidth / Range);
+      }
+
+      short quantize(double x, int axis) const
+      {
+         double q=(x - offset[axis]) / scale;
+         if (!(q > -Range)) // also catches NaN
+            return -Range;
+         if (q > Range)
+            return Range;
+         return short(std::floor(q + 0.5));
+      }
+
+      float dequantize(short q, int axis) const
+      {
+         return offset[axis] + scale * q;
+      }
+
+      const float* getOffset() const
+      {
+         return offset;
+      }
+
+      float getScale() const
+      {
+         return scale;
+      }
+
+   private:
+      float offset[3];
+      float scale;
+};
+
+} // namespace DTS
+
+#endif
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ QuasiRandom: Low-discrepancy point sequences.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef QUASI_RANDOM_H
+#define QUASI_RANDOM_H
+
+#include <cmath>
+
+namespace DTS
+{
+
+/** Low-discrepancy ("quasi-random") sequences.
+ *
+ * Point i of a sequence depends on i alone, like the counter-based random
+ * numbers, but the points fill space evenly instead of in clumps and
+ * holes, so fewer of them give the same coverage.
+ */
+namespace QuasiRandom
+{
+
+/** Element index of the van der Corput sequence in base, in [0, 1): the
+ *  digits of index mirrored at the radix point. Element index of the
+ *  Halton sequence takes the bases 2, 3, 5, ... for its coordinates.
+ */
+inline double radicalInverse(unsigned int index, unsigned int base)
+{
+   double inverse=0.0;
+   double digitScale=1.0 / base;
+   double scale=digitScale;
+   while (index > 0)
+   {
+      inverse+=(index % base) * scale;
+      index/=base;
+      scale*=digitScale;
+   }
+   return inverse;
+}
+
+/** Point index of count points spread evenly over the unit sphere, on a
+ *  spiral whose turns advance by the golden angle (Fibonacci sphere).
+ */
+inline void fibonacciSphere(unsigned int index, unsigned int count, double point[3])
+{
+   static const double GoldenAngle=M_PI * (3.0 - std::sqrt(5.0));
+
+   // equal area bands, centered, so the poles are not sampled twice
+   double z=1.0 - (2.0 * index + 1.0) / count;
+   double r=std::sqrt(1.0 - z * z);
+   double theta=GoldenAngle * index;
+   point[0]=r * std::cos(theta);
+   point[1]=r * std::sin(theta);
+   point[2]=z;
+}
+
+/** Point index of the unit ball, mapped from the Halton point in bases
+ *  2, 3 and 5 by a volume-preserving map, so the points stay even.
+ */
+inline void haltonBall(unsigned int index, double point[3])
+{
+   // skip the corner point 0 of the sequence
+   index++;
+
+   double r=std::pow(radicalInverse(index, 2), 1.0 / 3.0);
+   double z=2.0 * radicalInverse(index, 3) - 1.0;
+   double theta=2.0 * M_PI * radicalInverse(index, 5);
+   double s=std::sqrt(1.0 - z * z);
+   point[0]=r * s * std::cos(theta);
+   point[1]=r * s * std::sin(theta);
+   point[2]=r * z;
+}
+
+} // namespace QuasiRandom
+
+} // namespace DTS
+
+#endif
@@ -0,0 +1,164 @@
+/*******************************************************************************
+ SimulationQueue: Changes to the simulation, applied between two steps.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#include "SimulationQueue.h"
+
+#include <time.h>
+
+//
+// SimulationQueue methods
+//
+
+SimulationQueue::SimulationQueue() :
+   limited(false), limit(0), publishedStep(0), stopped(false)
+{
+   pthread_mutex_init(&mutex, 0);
+   pthread_cond_init(&limitCond, 0);
+   pthread_cond_init(&publishCond, 0);
+}
+
+SimulationQueue::~SimulationQueue()
+{
+   for (EntryList::iterator entry=entries.begin(); entry != entries.end(); ++entry)
+   {
+      delete entry->change;
+   }
+
+   pthread_cond_destroy(&publishCond);
+   pthread_cond_destroy(&limitCond);
+   pthread_mutex_destroy(&mutex);
+}
+
+void SimulationQueue::post(Change* change)
+{
+   Entry entry;
+   entry.change = change;
+   entry.scheduled = false;
+   entry.boundary = 0;
+
+   pthread_mutex_lock(&mutex);
+   entries.push_back(entry);
+   pthread_mutex_unlock(&mutex);
+}
+
+void SimulationQueue::schedule(unsigned int boundary)
+{
+   pthread_mutex_lock(&mutex);
+   for (EntryList::reverse_iterator entry=entries.rbegin(); entry != entries.rend()
+         && !entry->scheduled; ++entry)
+   {
+      entry->scheduled = true;
+      entry->boundary = boundary;
+   }
+   pthread_mutex_unlock(&mutex);
+}
+
+void SimulationQueue::setLimit(unsigned int limit)
+{
+   pthread_mutex_lock(&mutex);
+   limited = true;
+   this->limit = limit;
+   pthread_cond_broadcast(&limitCond);
+   pthread_mutex_unlock(&mutex);
+}
+
+void SimulationQueue::waitForStep(unsigned int step)
+{
+   pthread_mutex_lock(&mutex);
+   while (!stopped && !reached(publishedStep, step))
+   {
+      pthread_cond_wait(&publishCond, &mutex);
+   }
+   pthread_mutex_unlock(&mutex);
+}
+
+void SimulationQueue::flush()
+{
+   EntryList due;
+   pthread_mutex_lock(&mutex);
+   due.swap(entries);
+   pthread_mutex_unlock(&mutex);
+
+   applyEntries(due);
+}
+
+void SimulationQueue::stop()
+{
+   pthread_mutex_lock(&mutex);
+   stopped = true;
+   pthread_cond_broadcast(&limitCond);
+   pthread_cond_broadcast(&publishCond);
+   pthread_mutex_unlock(&mutex);
+}
+
+void SimulationQueue::apply(unsigned int step)
+{
+   // the changes are applied without the lock, so posting never waits for
+   // a long change such as a release
+   EntryList due;
+   pthread_mutex_lock(&mutex);
+   while (!entries.empty() && entries.front().scheduled
+         && reached(step, entries.front().boundary))
+   {
+      due.push_back(entries.front());
+      entries.pop_front();
+   }
+   pthread_mutex_unlock(&mutex);
+
+   applyEntries(due);
+}
+
+bool SimulationQueue::waitForLimit(unsigned int step, double seconds)
+{
+   pthread_mutex_lock(&mutex);
+   if (limited && reached(step, limit) && !stopped)
+   {
+      timespec timeout;
+      clock_gettime(CLOCK_REALTIME, &timeout);
+      long nanoseconds = timeout.tv_nsec + (long) (seconds * 1.0e9);
+      timeout.tv_sec += nanoseconds / 1000000000L;
+      timeout.tv_nsec = nanoseconds % 1000000000L;
+
+      pthread_cond_timedwait(&limitCond, &mutex, &timeout);
+   }
+   bool allowed = !limited || !reached(step, limit);
+   pthread_mutex_unlock(&mutex);
+
+   return allowed;
+}
+
+void SimulationQueue::publish(unsigned int step)
+{
+   pthread_mutex_lock(&mutex);
+   publishedStep = step;
+   pthread_cond_broadcast(&publishCond);
+   pthread_mutex_unlock(&mutex);
+}
+
+//
+// SimulationQueue internal methods
+//
+
+void SimulationQueue::applyEntries(EntryList& due)
+{
+   for (EntryList::iterator entry=due.begin(); entry != due.end(); ++entry)
+   {
+      entry->change->apply();
+      delete entry->change;
+   }
+}
@@ -0,0 +1,277 @@
+/*******************************************************************************
+ SimulationQueue: Changes to the simulation, applied between two steps.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef SIMULATION_QUEUE_H
+#define SIMULATION_QUEUE_H
+
+#include <pthread.h>
+
+// STL includes
+//
+#include <deque>
+
+
+/** Changes made by the user interface, applied by the simulation thread
+ *  between two steps.
+ *
+ * The main thread posts changes as events arrive. Once per frame it stamps
+ * the changes posted since the last frame with a boundary, the number of
+ * steps after which they apply (schedule()). Before each step the simulation
+ * thread applies the changes that are due, in the order they were posted.
+ * A change thus never lands in the middle of a step, and the simulation
+ * thread is the only one that sets parameters.
+ *
+ * On a cluster the simulation may also be held to a limit on the number of
+ * steps. The master distributes the boundaries and the limits, so every node
+ * applies the same changes after the same step and can show the same step
+ * (see Viewer::lockSnapshots()).
+ *
+ * Step counts are compared modulo 2^32, so they may wrap around.
+ */
+class SimulationQueue
+{
+   public:
+      /** A deferred change. The queue deletes it once it is applied. */
+      class Change
+      {
+         public:
+            virtual ~Change()
+            {
+            }
+
+            virtual void apply() = 0;
+      };
+
+      SimulationQueue();
+      ~SimulationQueue();
+
+      /* Main thread */
+
+      /** Queues change. It applies after the boundary given to the next call
+       *  of schedule().
+       */
+      void post(Change* change);
+
+      /** Stamps the changes posted since the last call: they apply once the
+       *  simulation has taken boundary steps (at once if it has taken more).
+       */
+      void schedule(unsigned int boundary);
+
+      /** Lets the simulation take no more than limit steps in total. Without
+       *  a call it steps freely.
+       */
+      void setLimit(unsigned int limit);
+
+      /** Waits until the snapshots of step steps are published, or stop()
+       *  is called.
+       */
+      void waitForStep(unsigned int step);
+
+      /** Applies all queued changes now, stamped or not. The caller keeps
+       *  the simulation thread from stepping while it does.
+       */
+      void flush();
+
+      /** Wakes all waiting threads and keeps them from waiting again. */
+      void stop();
+
+      /* Simulation thread */
+
+      /** Applies the changes that are due after step steps. */
+      void apply(unsigned int step);
+
+      /** Returns whether the limit allows a step after step steps. If it
+       *  does not, waits for a new limit for up to the given time first.
+       */
+      bool waitForLimit(unsigned int step, double seconds);
+
+      /** Records that the snapshots of step steps are published. */
+      void publish(unsigned int step);
+
+      /** Number of steps whose snapshots were last published. */
+      unsigned int getPublishedStep() const
+      {
+         return publishedStep;
+      }
+
+   private:
+      struct Entry
+      {
+         Change* change;
+         bool scheduled; ///< Whether boundary is set.
+         unsigned int boundary;
+      };
+      typedef std::deque<Entry> EntryList;
+
+      pthread_mutex_t mutex;
+      pthread_cond_t limitCond; ///< Signaled when the limit changes.
+      pthread_cond_t publishCond; ///< Signaled when a step is published.
+
+      EntryList entries; ///< Scheduled changes, then posted ones (guarded by mutex).
+      bool limited;
+      unsigned int limit;
+      volatile unsigned int publishedStep;
+      bool stopped;
+
+      /* Prevent copying */
+      SimulationQueue(const SimulationQueue&);
+      SimulationQueue& operator=(const SimulationQueue&);
+
+      /* Internal methods */
+      static bool reached(unsigned int step, unsigned int target)
+      {
+         return int(step - target) >= 0;
+      }
+      void applyEntries(EntryList& due);
+};
+
+/** A change that calls a method of an object without arguments. */
+template <class Target>
+class MethodChange0: public SimulationQueue::Change
+{
+   public:
+      typedef void (Target::*Method)();
+
+      MethodChange0(Target* target, Method method) :
+         target(target), method(method)
+      {
+      }
+
+      virtual void apply()
+      {
+         (target->*method)();
+      }
+
+   private:
+      Target* target;
+      Method method;
+};
+
+/** A change that calls a method of an object with one argument. The
+ *  argument is copied when the change is made.
+ */
+template <class Target, class Arg1, class Value1>
+class MethodChange1: public SimulationQueue::Change
+{
+   public:
+      typedef void (Target::*Method)(Arg1);
+
+      MethodChange1(Target* target, Method method, const Value1& value1) :
+         target(target), method(method), value1(value1)
+      {
+      }
+
+      virtual void apply()
+      {
+         (target->*method)(value1);
+      }
+
+   private:
+      Target* target;
+      Method method;
+      Value1 value1;
+};
+
+/** A change that calls a method of an object with two arguments. */
+template <class Target, class Arg1, class Value1, class Arg2, class Value2>
+class MethodChange2: public SimulationQueue::Change
+{
+   public:
+      typedef void (Target::*Method)(Arg1, Arg2);
+
+      MethodChange2(Target* target, Method method, const Value1& value1,
+            const Value2& value2) :
+         target(target), method(method), value1(value1), value2(value2)
+      {
+      }
+
+      virtual void apply()
+      {
+         (target->*method)(value1, value2);
+      }
+
+   private:
+      Target* target;
+      Method method;
+      Value1 value1;
+      Value2 value2;
+};
+
+/** A change that calls a method of an object with three arguments. */
+template <class Target, class Arg1, class Value1, class Arg2, class Value2,
+      class Arg3, class Value3>
+class MethodChange3: public SimulationQueue::Change
+{
+   public:
+      typedef void (Target::*Method)(Arg1, Arg2, Arg3);
+
+      MethodChange3(Target* target, Method method, const Value1& value1,
+            const Value2& value2, const Value3& value3) :
+         target(target), method(method), value1(value1), value2(value2),
+               value3(value3)
+      {
+      }
+
+      virtual void apply()
+      {
+         (target->*method)(value1, value2, value3);
+      }
+
+   private:
+      Target* target;
+      Method method;
+      Value1 value1;
+      Value2 value2;
+      Value3 value3;
+};
+
+/** Makes a change that calls object->method(values...) when applied. */
+template <class Object, class Target>
+inline SimulationQueue::Change* makeChange(Object* object, void (Target::*method)())
+{
+   return new MethodChange0<Target> (object, method);
+}
+
+template <class Object, class Target, class Arg1, class Value1>
+inline SimulationQueue::Change* makeChange(Object* object,
+      void (Target::*method)(Arg1), const Value1& value1)
+{
+   return new MethodChange1<Target, Arg1, Value1> (object, method, value1);
+}
+
+template <class Object, class Target, class Arg1, class Value1, class Arg2,
+      class Value2>
+inline SimulationQueue::Change* makeChange(Object* object,
+      void (Target::*method)(Arg1, Arg2), const Value1& value1,
+      const Value2& value2)
+{
+   return new MethodChange2<Target, Arg1, Value1, Arg2, Value2> (object,
+         method, value1, value2);
+}
+
+template <class Object, class Target, class Arg1, class Value1, class Arg2,
+      class Value2, class Arg3, class Value3>
+inline SimulationQueue::Change* makeChange(Object* object,
+      void (Target::*method)(Arg1, Arg2, Arg3), const Value1& value1,
+      const Value2& value2, const Value3& value3)
+{
+   return new MethodChange3<Target, Arg1, Value1, Arg2, Value2, Arg3, Value3> (
+         object, method, value1, value2, value3);
+}
+
+#endif
@@ -0,0 +1,38 @@
+/*******************************************************************************
+ SpeedPoint: Simple class for describing a particle's position and speed.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef SPEED_POINT_H
+#define SPEED_POINT_H
+
+// Vrui includes
+//
+#include <Geometry/Point.h>
+#include <GL/gl.h>
+
+/** Data structure describing the position and speed of a particle.
+ *
+ * Uploaded as a four component vertex: the shader takes the speed from
+ * the w component and colors the particle through a color map texture.
+ */
+struct SpeedPoint
+{
+      Geometry::Point<float,3> pos; ///< The position of the particle.
+      GLfloat speed; ///< Squared distance moved in the last step.
+};
+
+#endif
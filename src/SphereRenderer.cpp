@@ -0,0 +1,189 @@
+/*******************************************************************************
+ SphereRenderer: Shader-based rendering of spheres as impostors.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#include "SphereRenderer.h"
+
+#include <cstddef>
+
+// Vrui includes
+//
+#include <GL/Extensions/GLARBVertexShader.h>
+#include <GL/Extensions/GLARBFragmentShader.h>
+
+namespace DTS
+{
+
+//
+// SphereRenderer methods
+//
+
+SphereRenderer::SphereRenderer() :
+   vertexShaderObject(0), fragmentShaderObject(0), programObject(0)
+{
+   /* Source code for vertex and fragment programs: */
+   static const char* vertexProgram="\
+      varying vec3 rayEye; \
+      varying vec3 centerEye; \
+      varying float radiusEye; \
+      varying float highlight; \
+      \
+      void main() \
+      { \
+      vec4 center; \
+      vec3 view,right,up; \
+      float eyeDistance,scale; \
+      \
+      /* Transform the center and the radius to eye coordinates: */ \
+      center=gl_ModelViewMatrix*gl_Vertex; \
+      centerEye=center.xyz/center.w; \
+      radiusEye=gl_MultiTexCoord0.z*length(gl_ModelViewMatrix[0].xyz); \
+      highlight=gl_MultiTexCoord0.w; \
+      \
+      /* Quad facing the eye, covering the silhouette of the sphere: */ \
+      eyeDistance=length(centerEye); \
+      view=eyeDistance>0.0?centerEye/eyeDistance:vec3(0.0,0.0,-1.0); \
+      right=normalize(cross(view,abs(view.y)<0.99?vec3(0.0,1.0,0.0):vec3(1.0,0.0,0.0))); \
+      up=cross(right,view); \
+      scale=eyeDistance>radiusEye*1.01?eyeDistance/sqrt(eyeDistance*eyeDistance-radiusEye*radiusEye):10.0; \
+      rayEye=centerEye+(right*gl_MultiTexCoord0.x+up*gl_MultiTexCoord0.y)*(radiusEye*scale); \
+      \
+      gl_FrontColor=gl_Color; \
+      gl_Position=gl_ProjectionMatrix*vec4(rayEye,1.0); \
+      }";
+   static const char* fragmentProgram="\
+      uniform vec4 highlightColors[2]; \
+      \
+      varying vec3 rayEye; \
+      varying vec3 centerEye; \
+      varying float radiusEye; \
+      varying float highlight; \
+      \
+      void main() \
+      { \
+      vec3 direction,position,normal,light,halfway; \
+      vec4 material,color,clip; \
+      float b,c,discriminant,nl,nh; \
+      \
+      /* Intersect the view ray with the sphere: */ \
+      direction=normalize(rayEye); \
+      b=dot(direction,centerEye); \
+      c=dot(centerEye,centerEye)-radiusEye*radiusEye; \
+      discriminant=b*b-c; \
+      if(discriminant<0.0) \
+         discard; \
+      position=direction*(b-sqrt(discriminant)); \
+      normal=(position-centerEye)/radiusEye; \
+      \
+      material=gl_Color; \
+      if(highlight>1.5) \
+         material=highlightColors[1]; \
+      else if(highlight>0.5) \
+         material=highlightColors[0]; \
+      \
+      /* Light with light source 0, the color as ambient and diffuse: */ \
+      light=normalize(gl_LightSource[0].position.xyz-position*gl_LightSource[0].position.w); \
+      halfway=normalize(light-direction); \
+      nl=max(dot(normal,light),0.0); \
+      nh=max(dot(normal,halfway),0.0); \
+      color=(gl_LightModel.ambient+gl_LightSource[0].ambient)*material; \
+      color+=gl_LightSource[0].diffuse*material*nl; \
+      if(nl>0.0) \
+         color+=gl_LightSource[0].specular*pow(nh,80.0); \
+      gl_FragColor=vec4(color.rgb,material.a); \
+      \
+      /* Depth of the sphere surface, not of the quad: */ \
+      clip=gl_ProjectionMatrix*vec4(position,1.0); \
+      gl_FragDepth=(gl_DepthRange.diff*clip.z/clip.w+gl_DepthRange.near+gl_DepthRange.far)*0.5; \
+      }";
+
+   /* Compile and link the sphere shader program: */
+   vertexShaderObject=glCompileVertexShaderFromString(vertexProgram);
+   fragmentShaderObject=glCompileFragmentShaderFromString(fragmentProgram);
+   programObject=glLinkShader(vertexShaderObject, fragmentShaderObject);
+   highlightColorsLocation=glGetUniformLocationARB(programObject, "highlightColors");
+}
+
+SphereRenderer::~SphereRenderer()
+{
+   glDeleteObjectARB(programObject);
+   glDeleteObjectARB(vertexShaderObject);
+   glDeleteObjectARB(fragmentShaderObject);
+}
+
+void SphereRenderer::appendSphere(VertexArray& vertices, const Point& center,
+      GLfloat radius, const Color& color, int highlight)
+{
+   static const GLfloat corners[4][2]= { { -1.0f, -1.0f }, { 1.0f, -1.0f },
+         { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+   size_t first=vertices.size();
+   vertices.resize(first + 4);
+   for (int k=0; k < 4; k++)
+   {
+      Vertex& vertex=vertices[first + k];
+      for (int j=0; j < 3; j++)
+         vertex.center[j]=center[j];
+      for (int j=0; j < 4; j++)
+         vertex.color[j]=color[j];
+      vertex.corner[0]=corners[k][0];
+      vertex.corner[1]=corners[k][1];
+      vertex.radius=radius;
+      vertex.highlight=highlight;
+   }
+}
+
+void SphereRenderer::draw(const VertexArray& vertices, const Color* highlightColors) const
+{
+   if (!vertices.empty())
+      draw(&vertices[0], vertices.size(), highlightColors);
+}
+
+void SphereRenderer::draw(const Vertex* vertices, GLsizei count,
+      const Color* highlightColors) const
+{
+   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+   glUseProgramObjectARB(programObject);
+   if (highlightColors != 0)
+   {
+      GLfloat colors[NumHighlights][4];
+      for (int i=0; i < NumHighlights; i++)
+      {
+         for (int j=0; j < 4; j++)
+            colors[i][j]=highlightColors[i][j] / 255.0f;
+      }
+      glUniform4fvARB(highlightColorsLocation, NumHighlights, colors[0]);
+   }
+
+   // vertices may be an offset into a bound buffer: no dereferencing
+   const char* base=reinterpret_cast<const char*> (vertices);
+   GLsizei stride=sizeof(Vertex);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, stride, base + offsetof(Vertex, center));
+   glEnableClientState(GL_COLOR_ARRAY);
+   glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(Vertex, color));
+   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+   glTexCoordPointer(4, GL_FLOAT, stride, base + offsetof(Vertex, corner));
+
+   glDrawArrays(GL_QUADS, 0, count);
+
+   glUseProgramObjectARB(0);
+   glPopClientAttrib();
+}
+
+} // namespace DTS
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ SphereRenderer: Shader-based rendering of spheres as impostors.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef SPHERE_RENDERER_H
+#define SPHERE_RENDERER_H
+
+#include <cstddef>
+#include <vector>
+
+// Vrui includes
+//
+#include <GL/gl.h>
+#include <GL/GLColor.h>
+#include <GL/Extensions/GLARBShaderObjects.h>
+#include <Geometry/Point.h>
+
+namespace DTS
+{
+
+/** Draws lit spheres as ray-cast impostors, replacing glDrawSphereIcosahedron.
+ *
+ * Every sphere becomes one quad facing the viewer, just large enough to
+ * cover the sphere's silhouette. The fragment shader intersects the view
+ * ray with the sphere, discards the fragments that miss it and writes
+ * the depth of the hit, so the impostors intersect other geometry like
+ * real spheres. Lighting uses light source 0 with the sphere color as
+ * ambient and diffuse material, which matches the GLMaterials used for
+ * the icosahedra.
+ *
+ * A sphere carries a highlight index; spheres with a nonzero index take
+ * their color from the highlight colors passed to draw() instead, so a
+ * selected sphere needs no draw call of its own. All spheres go into one
+ * vertex array and are drawn with one call:
+ * \code
+ *   SphereRenderer::VertexArray vertices;
+ *   SphereRenderer::appendSphere(vertices, center, radius, color, highlight);
+ *   // more spheres
+ *   dataItem->sphereRenderer->draw(vertices, highlightColors);
+ * \endcode
+ */
+class SphereRenderer
+{
+   public:
+      typedef Geometry::Point<float,3> Point;
+      typedef GLColor<GLubyte, 4> Color;
+
+      static const int NumHighlights=2; ///< Highlight indices besides 0.
+
+      /// One corner of the quad of one sphere.
+      struct Vertex
+      {
+         GLfloat center[3]; ///< Sphere center.
+         GLubyte color[4]; ///< Color of unhighlighted spheres.
+         GLfloat corner[2]; ///< -1 or 1: the corner of the quad.
+         GLfloat radius; ///< Sphere radius.
+         GLfloat highlight; ///< 0, or 1 to NumHighlights for a highlight color.
+      };
+
+      typedef std::vector<Vertex> VertexArray;
+
+      /** Compiles the shaders. Needs a current GL context with the shader
+       *  extensions initialized.
+       */
+      SphereRenderer();
+      ~SphereRenderer();
+
+      /** Appends the quad of one sphere to vertices. */
+      static void appendSphere(VertexArray& vertices, const Point& center,
+            GLfloat radius, const Color& color, int highlight=0);
+
+      /** Draws the spheres of vertices. highlightColors holds NumHighlights
+       *  colors, or is 0 if no sphere is highlighted.
+       */
+      void draw(const VertexArray& vertices, const Color* highlightColors=0) const;
+
+      /** Same, for count vertices at vertices, which is an offset into the
+       *  bound GL_ARRAY_BUFFER_ARB if there is one.
+       */
+      void draw(const Vertex* vertices, GLsizei count, const Color* highlightColors=0) const;
+
+   private:
+      GLhandleARB vertexShaderObject, fragmentShaderObject, programObject;
+      GLint highlightColorsLocation; ///< Location of the highlight color uniform array.
+
+      /* Prevent copying */
+      SphereRenderer(const SphereRenderer&);
+      SphereRenderer& operator=(const SphereRenderer&);
+};
+
+} // namespace DTS
+
+#endif
@@ -0,0 +1,223 @@
+/*******************************************************************************
+ StreamingBuffer: Ring of vertex buffers for per-frame vertex uploads.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#include "StreamingBuffer.h"
+
+// Vrui includes
+//
+#include <GL/GLExtensionManager.h>
+
+namespace
+{
+
+//
+// Entry points of GL_ARB_sync, GL_ARB_map_buffer_range and
+// GL_ARB_buffer_storage, which have no Vrui extension classes
+//
+
+typedef struct __GLsync* SyncObject;
+typedef unsigned long long SyncTimeout;
+
+typedef SyncObject (GLAPIENTRY *FenceSyncProc)(GLenum condition, GLbitfield flags);
+typedef GLenum (GLAPIENTRY *ClientWaitSyncProc)(SyncObject sync, GLbitfield flags, SyncTimeout timeout);
+typedef void (GLAPIENTRY *DeleteSyncProc)(SyncObject sync);
+typedef GLvoid* (GLAPIENTRY *MapBufferRangeProc)(GLenum target, GLintptrARB offset, GLsizeiptrARB length, GLbitfield access);
+typedef void (GLAPIENTRY *BufferStorageProc)(GLenum target, GLsizeiptrARB size, const GLvoid* data, GLbitfield flags);
+
+const GLenum SyncGpuCommandsComplete=0x9117;
+const GLbitfield SyncFlushCommandsBit=0x00000001;
+const GLenum TimeoutExpired=0x911B;
+const SyncTimeout WaitTimeout=1000000; // 1 ms, in nanoseconds
+
+const GLbitfield MapWriteBit=0x0002;
+const GLbitfield MapPersistentBit=0x0040;
+const GLbitfield MapCoherentBit=0x0080;
+
+FenceSyncProc fenceSync=0;
+ClientWaitSyncProc clientWaitSync=0;
+DeleteSyncProc deleteSync=0;
+MapBufferRangeProc mapBufferRange=0;
+BufferStorageProc bufferStorage=0;
+
+/** Loads the entry points once; returns whether all were found. */
+bool initPersistentMapping()
+{
+   if (fenceSync == 0)
+   {
+      fenceSync=GLExtensionManager::getFunction<FenceSyncProc>("glFenceSync");
+      clientWaitSync=GLExtensionManager::getFunction<ClientWaitSyncProc>("glClientWaitSync");
+      deleteSync=GLExtensionManager::getFunction<DeleteSyncProc>("glDeleteSync");
+      mapBufferRange=GLExtensionManager::getFunction<MapBufferRangeProc>("glMapBufferRange");
+      bufferStorage=GLExtensionManager::getFunction<BufferStorageProc>("glBufferStorage");
+   }
+   return fenceSync != 0 && clientWaitSync != 0 && deleteSync != 0
+         && mapBufferRange != 0 && bufferStorage != 0;
+}
+
+}
+
+namespace DTS
+{
+
+//
+// StreamingBuffer methods
+//
+
+StreamingBuffer::StreamingBuffer() :
+   version(0), count(0), persistent(false), current(0), writing(0)
+{
+   persistent=isPersistentSupported() && initPersistentMapping();
+
+   for (unsigned int i=0; i < NumBuffers; i++)
+   {
+      glGenBuffersARB(1, &slots[i].bufferId);
+      slots[i].capacity=0;
+      slots[i].pointer=0;
+      slots[i].sync=0;
+   }
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+   for (unsigned int i=0; i < NumBuffers; i++)
+   {
+      deleteFence(slots[i]);
+
+      if (slots[i].pointer != 0)
+      {
+         glBindBufferARB(GL_ARRAY_BUFFER_ARB, slots[i].bufferId);
+         glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+      }
+      glDeleteBuffersARB(1, &slots[i].bufferId);
+   }
+   glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+}
+
+bool StreamingBuffer::isPersistentSupported()
+{
+   return GLExtensionManager::isExtensionSupported("GL_ARB_buffer_storage")
+         && GLExtensionManager::isExtensionSupported("GL_ARB_map_buffer_range")
+         && GLExtensionManager::isExtensionSupported("GL_ARB_sync");
+}
+
+void* StreamingBuffer::map(size_t size)
+{
+   writing=(current + 1) % NumBuffers;
+   Slot& slot=slots[writing];
+
+   glBindBufferARB(GL_ARRAY_BUFFER_ARB, slot.bufferId);
+
+   if (persistent)
+   {
+      // the GPU may still be drawing the data this buffer held
+      waitFence(slot);
+
+      if (slot.capacity < size)
+         allocate(slot, size);
+      return slot.pointer;
+   }
+
+   // orphan the old storage (or grow), then map the new storage
+   if (slot.capacity < size)
+      slot.capacity=size + size / 2;
+   glBufferDataARB(GL_ARRAY_BUFFER_ARB, slot.capacity, 0, GL_STREAM_DRAW_ARB);
+   return glMapBufferARB(GL_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+}
+
+bool StreamingBuffer::unmap()
+{
+   // a persistent mapping is coherent, the writes are already visible
+   if (!persistent)
+   {
+      glBindBufferARB(GL_ARRAY_BUFFER_ARB, slots[writing].bufferId);
+      if (!glUnmapBufferARB(GL_ARRAY_BUFFER_ARB))
+         return false;
+   }
+
+   current=writing;
+   return true;
+}
+
+void StreamingBuffer::bind() const
+{
+   glBindBufferARB(GL_ARRAY_BUFFER_ARB, slots[current].bufferId);
+}
+
+void StreamingBuffer::fence()
+{
+   if (!persistent)
+      return;
+
+   Slot& slot=slots[current];
+   deleteFence(slot);
+   slot.sync=fenceSync(SyncGpuCommandsComplete, 0);
+}
+
+//
+// StreamingBuffer internal methods
+//
+
+void StreamingBuffer::waitFence(Slot& slot)
+{
+   if (slot.sync == 0)
+      return;
+
+   // The ring is deep enough that this normally returns at once
+   GLenum result;
+   do
+   {
+      result=clientWaitSync(static_cast<SyncObject> (slot.sync),
+            SyncFlushCommandsBit, WaitTimeout);
+   } while (result == TimeoutExpired);
+
+   deleteFence(slot);
+}
+
+void StreamingBuffer::deleteFence(Slot& slot)
+{
+   if (slot.sync != 0)
+   {
+      deleteSync(static_cast<SyncObject> (slot.sync));
+      slot.sync=0;
+   }
+}
+
+/** Gives the (bound) slot a larger persistently mapped buffer. Buffer
+ *  storage cannot be resized, so the buffer object is replaced.
+ */
+void StreamingBuffer::allocate(Slot& slot, size_t size)
+{
+   GLbitfield flags=MapWriteBit | MapPersistentBit | MapCoherentBit;
+
+   if (slot.pointer != 0)
+   {
+      glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+      slot.pointer=0;
+   }
+   glDeleteBuffersARB(1, &slot.bufferId);
+   glGenBuffersARB(1, &slot.bufferId);
+   glBindBufferARB(GL_ARRAY_BUFFER_ARB, slot.bufferId);
+
+   slot.capacity=size + size / 2;
+   bufferStorage(GL_ARRAY_BUFFER_ARB, slot.capacity, 0, flags);
+   slot.pointer=mapBufferRange(GL_ARRAY_BUFFER_ARB, 0, slot.capacity, flags);
+   if (slot.pointer == 0)
+      slot.capacity=0;
+}
+
+} // namespace DTS
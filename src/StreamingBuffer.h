@@ -0,0 +1,120 @@
+/*******************************************************************************
+ StreamingBuffer: Ring of vertex buffers for per-frame vertex uploads.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef STREAMING_BUFFER_H
+#define STREAMING_BUFFER_H
+
+#include <cstddef>
+
+// Vrui includes
+//
+#include <GL/gl.h>
+#include <GL/Extensions/GLARBVertexBufferObject.h>
+
+namespace DTS
+{
+
+/** A ring of vertex buffers for vertex data that changes every frame.
+ *
+ * Each upload goes to the next buffer of the ring, so the GPU can still
+ * draw from the previous ones. With GL_ARB_buffer_storage and GL_ARB_sync
+ * the buffers are mapped once and stay mapped (persistent mapping); a
+ * fence per buffer keeps a write from overtaking draws that still read
+ * it. Otherwise each upload orphans the buffer before mapping it, which
+ * lets the driver hand out fresh storage instead of stalling. Either way
+ * a buffer is only reallocated when the data outgrows it.
+ *
+ * Usage, in the GL context the buffer was created in:
+ * \code
+ *   if (buffer.version != dataVersion)
+ *   {
+ *      void* mapped=buffer.map(size);
+ *      // write size bytes to mapped
+ *      if (buffer.unmap())
+ *         buffer.version=dataVersion;
+ *   }
+ *   buffer.bind();
+ *   // draw calls
+ *   buffer.fence();
+ * \endcode
+ */
+class StreamingBuffer
+{
+   public:
+      static const unsigned int NumBuffers=3; ///< Length of the ring.
+
+      unsigned int version; ///< User version of the data in the current buffer.
+      GLsizei count; ///< User item count of the data in the current buffer.
+
+      /** Creates the buffers. Needs a current GL context with the vertex
+       *  buffer object extension initialized.
+       */
+      StreamingBuffer();
+      ~StreamingBuffer();
+
+      /** Whether the local OpenGL supports persistent mapping. */
+      static bool isPersistentSupported();
+
+      bool isPersistent() const
+      {
+         return persistent;
+      }
+
+      /** Returns a write-only pointer to size bytes in the next buffer of
+       *  the ring, or 0 on failure. The pointer is valid until unmap().
+       */
+      void* map(size_t size);
+
+      /** Ends writing. On success the written buffer becomes the current
+       *  one; on failure (the driver lost the mapped data) the previous
+       *  buffer stays current and the data must be written again.
+       */
+      bool unmap();
+
+      /** Binds the current buffer to GL_ARRAY_BUFFER_ARB. */
+      void bind() const;
+
+      /** Marks the end of the draw calls that read the current buffer. */
+      void fence();
+
+   private:
+      struct Slot
+      {
+         GLuint bufferId;
+         size_t capacity; ///< Allocated size in bytes.
+         void* pointer; ///< Persistent mapping, if any.
+         void* sync; ///< Fence after the last draw reading this buffer.
+      };
+
+      bool persistent;
+      Slot slots[NumBuffers];
+      unsigned int current; ///< Slot drawn by bind().
+      unsigned int writing; ///< Slot between map() and unmap().
+
+      /* Prevent copying */
+      StreamingBuffer(const StreamingBuffer&);
+      StreamingBuffer& operator=(const StreamingBuffer&);
+
+      void waitFence(Slot& slot);
+      void deleteFence(Slot& slot);
+      void allocate(Slot& slot, size_t size);
+};
+
+} // namespace DTS
+
+#endif
@@ -0,0 +1,169 @@
+/*******************************************************************************
+ ThreadPool: Persistent worker threads for stepping particles.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#include "ThreadPool.h"
+
+#include <unistd.h>
+
+//
+// ThreadPool methods
+//
+
+ThreadPool::ThreadPool(unsigned int numThreads) :
+   numThreads(numThreads > 0 ? numThreads : getDefaultNumThreads()),
+   generation(0), busyWorkers(0), shutdown(false), task(0), count(0),
+   grain(1), numChunks(0), nextChunk(0)
+{
+   pthread_mutex_init(&loopMutex, 0);
+   pthread_mutex_init(&mutex, 0);
+   pthread_cond_init(&workCond, 0);
+   pthread_cond_init(&doneCond, 0);
+
+   scratch.resize(this->numThreads);
+
+   // thread 0 is the caller of parallelFor, start the others
+   threads.resize(this->numThreads - 1);
+   workerArgs.resize(this->numThreads - 1);
+   for (unsigned int i=1; i < this->numThreads; i++)
+   {
+      workerArgs[i - 1].pool = this;
+      workerArgs[i - 1].thread = i;
+      pthread_create(&threads[i - 1], 0, workerMain, &workerArgs[i - 1]);
+   }
+}
+
+ThreadPool::~ThreadPool()
+{
+   pthread_mutex_lock(&mutex);
+   shutdown = true;
+   pthread_cond_broadcast(&workCond);
+   pthread_mutex_unlock(&mutex);
+
+   for (size_t i=0; i < threads.size(); i++)
+   {
+      pthread_join(threads[i], 0);
+   }
+
+   pthread_cond_destroy(&doneCond);
+   pthread_cond_destroy(&workCond);
+   pthread_mutex_destroy(&mutex);
+   pthread_mutex_destroy(&loopMutex);
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, Task& task)
+{
+   if (count == 0)
+      return;
+   if (grain == 0)
+      grain = 1;
+
+   size_t numChunks = (count + grain - 1) / grain;
+
+   // one loop at a time, even on the caller's thread alone (scratch 0)
+   pthread_mutex_lock(&loopMutex);
+
+   // not worth waking anybody up
+   if (numThreads == 1 || numChunks == 1)
+   {
+      task.run(0, count, 0);
+      pthread_mutex_unlock(&loopMutex);
+      return;
+   }
+
+   pthread_mutex_lock(&mutex);
+   this->task = &task;
+   this->count = count;
+   this->grain = grain;
+   this->numChunks = numChunks;
+   nextChunk = 0;
+   busyWorkers = numThreads - 1;
+   generation++;
+   pthread_cond_broadcast(&workCond);
+   pthread_mutex_unlock(&mutex);
+
+   runChunks(0);
+
+   // wait until every worker is done with this loop
+   pthread_mutex_lock(&mutex);
+   while (busyWorkers > 0)
+   {
+      pthread_cond_wait(&doneCond, &mutex);
+   }
+   this->task = 0;
+   pthread_mutex_unlock(&mutex);
+
+   pthread_mutex_unlock(&loopMutex);
+}
+
+unsigned int ThreadPool::getDefaultNumThreads()
+{
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return n > 0 ? (unsigned int) n : 1;
+}
+
+//
+// ThreadPool internal methods
+//
+
+void* ThreadPool::workerMain(void* args)
+{
+   WorkerArgs* a = static_cast<WorkerArgs*>(args);
+   a->pool->workerLoop(a->thread);
+   return 0;
+}
+
+void ThreadPool::workerLoop(unsigned int thread)
+{
+   unsigned int seenGeneration = 0;
+
+   pthread_mutex_lock(&mutex);
+   while (true)
+   {
+      while (!shutdown && generation == seenGeneration)
+      {
+         pthread_cond_wait(&workCond, &mutex);
+      }
+      if (shutdown)
+         break;
+      seenGeneration = generation;
+      pthread_mutex_unlock(&mutex);
+
+      runChunks(thread);
+
+      pthread_mutex_lock(&mutex);
+      if (--busyWorkers == 0)
+      {
+         pthread_cond_signal(&doneCond);
+      }
+   }
+   pthread_mutex_unlock(&mutex);
+}
+
+void ThreadPool::runChunks(unsigned int thread)
+{
+   while (true)
+   {
+      size_t chunk = __sync_fetch_and_add(&nextChunk, 1);
+      if (chunk >= numChunks)
+         break;
+
+      size_t begin = chunk * grain;
+      size_t end = begin + grain < count ? begin + grain : count;
+      task->run(begin, end, thread);
+   }
+}
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ ThreadPool: Persistent worker threads for stepping particles.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+
+// STL includes
+//
+#include <cstddef>
+#include <vector>
+
+// Project includes
+//
+#include "Vector.h"
+#include "IntegratorContext.h"
+
+
+/** A fixed set of worker threads that execute parallel loops.
+ *
+ * The threads are created once and sleep between loops, so a parallelFor()
+ * per frame costs a wake-up rather than a thread creation. The calling thread
+ * takes part in every loop as thread 0; a pool of one thread runs everything
+ * on the caller.
+ *
+ * Every thread owns a Scratch structure. A task may use the scratch of the
+ * thread it runs on without locking, because a thread runs one range at a
+ * time.
+ *
+ * Several threads may call parallelFor(), e.g. the simulation thread and
+ * the user interface; the loops then run one after the other, since they
+ * share the loop state and the caller's scratch. A task must not call
+ * parallelFor() itself.
+ */
+class ThreadPool
+{
+   public:
+      /** Per-thread temporary storage. */
+      struct Scratch
+      {
+         IntegratorContext<double> integrator; ///< Working storage for stepping.
+         DTS::Vector<double> state; ///< One model state.
+         DTS::Vector<double> display; ///< One transformed (3D) point.
+
+         Scratch() : display(3)
+         {
+         }
+      };
+
+      /** Body of a parallel loop. */
+      class Task
+      {
+         public:
+            virtual ~Task()
+            {
+            }
+
+            /** Process items [begin, end) on the given thread (0-based). */
+            virtual void run(size_t begin, size_t end, unsigned int thread) = 0;
+      };
+
+      /** Create a pool with the given total number of threads (including
+       *  the caller). Zero selects getDefaultNumThreads().
+       */
+      explicit ThreadPool(unsigned int numThreads=0);
+      ~ThreadPool();
+
+      unsigned int getNumThreads() const
+      {
+         return numThreads;
+      }
+
+      Scratch& getScratch(unsigned int thread)
+      {
+         return scratch[thread];
+      }
+
+      /** Run task over [0, count) in chunks of grain items and wait for all
+       *  chunks to finish. Each chunk is processed by exactly one thread;
+       *  which thread gets which chunk is unspecified.
+       */
+      void parallelFor(size_t count, size_t grain, Task& task);
+
+      /** Number of online processors. */
+      static unsigned int getDefaultNumThreads();
+
+   private:
+      unsigned int numThreads;
+      std::vector<pthread_t> threads;
+      std::vector<Scratch> scratch;
+
+      pthread_mutex_t loopMutex; ///< Held by parallelFor() for a whole loop.
+      pthread_mutex_t mutex;
+      pthread_cond_t workCond; ///< Signaled when a new loop starts.
+      pthread_cond_t doneCond; ///< Signaled when the last worker finishes.
+
+      /* State of the current loop (guarded by mutex) */
+      unsigned int generation; ///< Incremented for every loop.
+      unsigned int busyWorkers;
+      bool shutdown;
+      Task* task;
+      size_t count;
+      size_t grain;
+      size_t numChunks;
+      volatile size_t nextChunk; ///< Next unclaimed chunk (atomic).
+
+      struct WorkerArgs
+      {
+         ThreadPool* pool;
+         unsigned int thread;
+      };
+      std::vector<WorkerArgs> workerArgs;
+
+      /* Prevent copying */
+      ThreadPool(const ThreadPool&);
+      ThreadPool& operator=(const ThreadPool&);
+
+      /* Internal methods */
+      static void* workerMain(void* args);
+      void workerLoop(unsigned int thread);
+      void runChunks(unsigned int thread);
+};
+
+#endif
@@ -27,3 +27,8 @@ void AbstractDynamicsTool::grabbed(const ToolBox::ToolGrabEvent & toolGrabEvent)
    application->updateToolToggles();
    application->updateCurrentOptionsDialog();
 }
+
+void AbstractDynamicsTool::post(SimulationQueue::Change* change)
+{
+   application->getSimulationQueue().post(change);
+}
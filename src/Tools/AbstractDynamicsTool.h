@@ -23,6 +23,7 @@
 // Vrui includes
 //
 #include <Vrui/Vrui>
+#include <Threads/Mutex.h>
 
 // External includes
 //
@@ -32,6 +33,7 @@
 //
 #include "Dynamics/Experiment.h"
 #include "CaveDialog.h"
+#include "SimulationQueue.h"
 
 // Haven't yet decided how/where to make this globally available
 typedef double Scalar;
@@ -62,6 +64,19 @@ class AbstractDynamicsTool: public ToolBox::Tool
       bool locked; // when locked all user input is ignored but tools continue to step
       bool _needsGLSL;
 
+      /** Held by the simulation thread while the tool steps, and by the
+       *  changes the tool posts while they are applied. Event handlers
+       *  that change what render() reads must hold it as well.
+       */
+      Threads::Mutex stepMutex;
+
+      /** Queues a change to the simulated particles. Event handlers post
+       *  changes rather than making them, so that the simulation thread
+       *  makes them between two steps, after the same step on every
+       *  cluster node.
+       */
+      void post(SimulationQueue::Change* change);
+
    public:
 
       /* Interface */
@@ -78,8 +93,24 @@ class AbstractDynamicsTool: public ToolBox::Tool
       }
 
       virtual void render(DTS::DataItem* dataItem) const = 0;
+
+      /** Advance the simulation by one step. Called on the simulation
+       *  thread with the step mutex held.
+       */
       virtual void step() = 0;
 
+      /** Make the latest state published by step() visible to render().
+       *  Called on the main thread once per frame.
+       */
+      virtual void lockSnapshot()
+      {
+      }
+
+      Threads::Mutex& getStepMutex()
+      {
+         return stepMutex;
+      }
+
       /* ToolBox::Tool methods */
       virtual void moved(const ToolBox::MotionEvent & motionEvent) = 0;
       virtual void mainButtonPressed(const ToolBox::ButtonPressEvent & buttonPressEvent) = 0;
@@ -58,17 +58,42 @@ GLMotif::PopupWindow* DotSpreaderOptionsDialog::createDialog()
 
    pointSizeSlider->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::sliderCallback);
 
+   factory.createLabel("EscapeFactorLabel", "Escape Range");
+
+   escapeFactorValue=factory.createTextField("EscapeFactorTextField", 10);
+   escapeFactorValue->setString("10");
+
+   // multiples of the model's coordinate ranges particles may leave
+   escapeFactorSlider=factory.createSlider("EscapeFactorSlider", 15.0);
+   escapeFactorSlider->setValueRange(2.0, 100.0, 1.0);
+   escapeFactorSlider->setValue(10.0);
+
+   escapeFactorSlider->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::sliderCallback);
+
+   factory.createLabel("EscapedLabel", "Escaped / Recycled");
+
+   escapedValue=factory.createTextField("EscapedTextField", 10);
+   escapedValue->setString("0");
+   recycledValue=factory.createTextField("RecycledTextField", 10);
+   recycledValue->setString("0");
+
    // create distribution check boxes
    GLMotif::ToggleButton* surfaceDistributionToggle=factory.createCheckBox("SurfaceDistributionToggle", "Surface", true);
    GLMotif::ToggleButton* volumeDistributionToggle=factory.createCheckBox("VolumeDistributionToggle", "Volume");
+   GLMotif::ToggleButton* fibonacciDistributionToggle=factory.createCheckBox("FibonacciDistributionToggle", "Even Surface");
+   GLMotif::ToggleButton* haltonDistributionToggle=factory.createCheckBox("HaltonDistributionToggle", "Even Volume");
 
    // set callbacks for toggle buttons (check boxes)
    surfaceDistributionToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::distributionTogglesCallback);
    volumeDistributionToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::distributionTogglesCallback);
+   fibonacciDistributionToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::distributionTogglesCallback);
+   haltonDistributionToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::distributionTogglesCallback);
 
    // add toggle buttons to array for radio-button behavior
    distributionToggles.push_back(surfaceDistributionToggle);
    distributionToggles.push_back(volumeDistributionToggle);
+   distributionToggles.push_back(fibonacciDistributionToggle);
+   distributionToggles.push_back(haltonDistributionToggle);
 
    // create push buttons
    clearParticles = factory.createButton("ClearParticles", "Clear Particles");
@@ -76,6 +101,24 @@ GLMotif::PopupWindow* DotSpreaderOptionsDialog::createDialog()
    // assign callbacks for buttons
    clearParticles->getSelectCallbacks().add(this, &DotSpreaderOptionsDialog::buttonCallback);
 
+   // escaped particles are removed or released again
+   GLMotif::ToggleButton* removeEscapedToggle=factory.createCheckBox("RemoveEscapedToggle", "Remove Escaped", true);
+   GLMotif::ToggleButton* reseedEscapedToggle=factory.createCheckBox("ReseedEscapedToggle", "Re-seed Escaped");
+
+   removeEscapedToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::escapeTogglesCallback);
+   reseedEscapedToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::escapeTogglesCallback);
+
+   escapeToggles.push_back(removeEscapedToggle);
+   escapeToggles.push_back(reseedEscapedToggle);
+
+   // project the particles in the vertex shader instead of every step
+   GLMotif::ToggleButton* gpuProjectionToggle=factory.createCheckBox("GpuProjectionToggle", "GPU Projection");
+   gpuProjectionToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::gpuProjectionToggleCallback);
+
+   // upload CPU-projected particles as 8-byte quantized positions
+   GLMotif::ToggleButton* compactVerticesToggle=factory.createCheckBox("CompactVerticesToggle", "Compact Vertices");
+   compactVerticesToggle->getValueChangedCallbacks().add(this, &DotSpreaderOptionsDialog::compactVerticesToggleCallback);
+
    parameterDialog->manageChild();
 
    return parameterDialogPopup;
@@ -108,6 +151,13 @@ void DotSpreaderOptionsDialog::sliderCallback(GLMotif::Slider::ValueChangedCallb
       snprintf(buff, sizeof(buff), "%.2f", value);
       pointSizeValue->setString(buff);
    }
+   else if (name == "EscapeFactorSlider")
+   {
+      pTool->setEscapeFactor(value);
+
+      snprintf(buff, sizeof(buff), "%i", (int) value);
+      escapeFactorValue->setString(buff);
+   }
    else
    {
    }
@@ -129,6 +179,14 @@ void DotSpreaderOptionsDialog::distributionTogglesCallback(GLMotif::ToggleButton
    {
       pTool->setDistributionMethod(DotSpreaderData::VOLUME);
    }
+   else if (name == "FibonacciDistributionToggle")
+   {
+      pTool->setDistributionMethod(DotSpreaderData::FIBONACCI_SURFACE);
+   }
+   else if (name == "HaltonDistributionToggle")
+   {
+      pTool->setDistributionMethod(DotSpreaderData::HALTON_VOLUME);
+   }
 
    // fake radio-button behavior
    for (ToggleArray::iterator button=distributionToggles.begin(); button
@@ -140,6 +198,53 @@ void DotSpreaderOptionsDialog::distributionTogglesCallback(GLMotif::ToggleButton
          (*button)->setToggle(true);
 }
 
+void DotSpreaderOptionsDialog::escapeTogglesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
+{
+   std::string name=cbData->toggle->getName();
+
+   DotSpreaderTool* pTool=static_cast<DotSpreaderTool*> (tool);
+
+   if (name == "RemoveEscapedToggle")
+      pTool->setEscapePolicy(DotSpreaderData::REMOVE_ESCAPED);
+   else if (name == "ReseedEscapedToggle")
+      pTool->setEscapePolicy(DotSpreaderData::RESEED_ESCAPED);
+
+   // fake radio-button behavior
+   for (ToggleArray::iterator button=escapeToggles.begin(); button
+         != escapeToggles.end(); ++button)
+      (*button)->setToggle(strcmp((*button)->getName(), name.c_str()) == 0);
+}
+
+void DotSpreaderOptionsDialog::setEscapeCounts(unsigned long escaped, unsigned long recycled)
+{
+   char buff[20];
+
+   if (escaped != shownEscaped)
+   {
+      snprintf(buff, sizeof(buff), "%lu", escaped);
+      escapedValue->setString(buff);
+      shownEscaped=escaped;
+   }
+   if (recycled != shownRecycled)
+   {
+      snprintf(buff, sizeof(buff), "%lu", recycled);
+      recycledValue->setString(buff);
+      shownRecycled=recycled;
+   }
+}
+
+void DotSpreaderOptionsDialog::gpuProjectionToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
+{
+   DotSpreaderTool* pTool=static_cast<DotSpreaderTool*> (tool);
+   pTool->setGpuProjection(cbData->set);
+}
+
+void DotSpreaderOptionsDialog::compactVerticesToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
+{
+   DotSpreaderTool* pTool=static_cast<DotSpreaderTool*> (tool);
+   pTool->setCompactVertices(cbData->set);
+}
+
 void DotSpreaderOptionsDialog::buttonCallback(GLMotif::Button::SelectCallbackData* cbData)
 {
    std::string name = cbData->button->getName();
@@ -36,24 +36,35 @@ class DotSpreaderOptionsDialog: public CaveDialog
 
       GLMotif::Slider* numberOfParticlesSlider;
       GLMotif::Slider* pointSizeSlider;
+      GLMotif::Slider* escapeFactorSlider;
 
       GLMotif::TextField* numberOfParticlesValue;
       GLMotif::TextField* pointSizeValue;
+      GLMotif::TextField* escapeFactorValue;
+      GLMotif::TextField* escapedValue;
+      GLMotif::TextField* recycledValue;
+
+      unsigned long shownEscaped; ///< Counts shown in escapedValue and recycledValue.
+      unsigned long shownRecycled;
 
       GLMotif::Button* clearParticles;
 
       void sliderCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);
       void distributionTogglesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
+      void escapeTogglesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
       void buttonCallback(GLMotif::Button::SelectCallbackData* cbData);
+      void gpuProjectionToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
+      void compactVerticesToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 
       ToggleArray distributionToggles;
+      ToggleArray escapeToggles;
 
    protected:
       GLMotif::PopupWindow* createDialog();
 
    public:
       DotSpreaderOptionsDialog(GLMotif::PopupMenu *parentMenu, AbstractDynamicsTool *t) :
-         CaveDialog(parentMenu), tool(t)
+         CaveDialog(parentMenu), tool(t), shownEscaped(0), shownRecycled(0)
       {
          dialogWindow=createDialog();
       }
@@ -61,6 +72,9 @@ class DotSpreaderOptionsDialog: public CaveDialog
       virtual ~DotSpreaderOptionsDialog()
       {
       }
+
+      /** Shows the numbers of escaped and recycled particles. */
+      void setEscapeCounts(unsigned long escaped, unsigned long recycled);
 };
 
 #endif
@@ -19,6 +19,10 @@
  *******************************************************************************/
 #include "DotSpreaderTool.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
 // Vrui includes
 //
 #include <GL/Extensions/GLARBVertexShader.h>
@@ -199,6 +203,17 @@ void DotSpreaderTool::render(DTS::DataItem* dataItem) const
 
       float particleRadius=data.point_radius;
 
+      const DotSpreaderData::Snapshot& snapshot=data.snapshots.getLockedValue();
+
+      // unprojected states are projected by the shader with the current
+      // projection, or else here on the CPU
+      GLfloat projection[2][16];
+      bool shaderProjection=false;
+      #ifndef GHETTO
+      if (snapshot.gpuProjection && dataItem->hasShaders)
+         shaderProjection=getProjectionMatrices(projection);
+      #endif
+
       // Query the OpenGL viewing frustum
       GLFrustum<float> frustum;
       frustum.setFromGL();
@@ -215,9 +230,20 @@ void DotSpreaderTool::render(DTS::DataItem* dataItem) const
 
          /* Enable the vertex/fragment shader: */
          glEnable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
-         glUseProgramObjectARB(dataItem->programObject);
-         glUniform1fARB(dataItem->scaledParticleRadiusLocation, scaledParticleRadius);
-         glUniform1iARB(dataItem->tex0Location, 0);
+         if (shaderProjection)
+         {
+            glUseProgramObjectARB(dataItem->projectionProgramObject);
+            glUniform1fARB(dataItem->projectionScaledParticleRadiusLocation, scaledParticleRadius);
+            glUniform1iARB(dataItem->projectionTex0Location, 0);
+            glUniformMatrix4fvARB(dataItem->projectionMatrixLocations[0], 1, GL_FALSE, projection[0]);
+            glUniformMatrix4fvARB(dataItem->projectionMatrixLocations[1], 1, GL_FALSE, projection[1]);
+         }
+         else
+         {
+            glUseProgramObjectARB(dataItem->programObject);
+            glUniform1fARB(dataItem->scaledParticleRadiusLocation, scaledParticleRadius);
+            glUniform1iARB(dataItem->tex0Location, 0);
+         }
       }
       else
       {
@@ -254,24 +280,101 @@ void DotSpreaderTool::render(DTS::DataItem* dataItem) const
          glPointParameterfvARB(GL_POINT_DISTANCE_ATTENUATION_ARB, attenuation);
       }
 
-      glBindBufferARB(GL_ARRAY_BUFFER_ARB, dataItem->vertexBufferId);
       glEnableClientState(GL_VERTEX_ARRAY);
       glEnableClientState(GL_COLOR_ARRAY);
 
-      // If data has been modified, send to graphics card
-      if (dataItem->versionDS != data.currentVersion)
+      // pick the vertices to draw
+      DotSpreaderData::ParticleArray projected;
+      const void* vertices=0;
+      size_t vertexSize=sizeof(ColorPoint);
+      GLsizei numParticles;
+
+      bool compact=!snapshot.gpuProjection && snapshot.compact;
+
+      if (compact)
       {
-         dataItem->numParticlesDS = data.numPoints;
-         glBufferDataARB(GL_ARRAY_BUFFER_ARB, dataItem->numParticlesDS
-               * sizeof(ColorPoint), &data.particles[0], GL_DYNAMIC_DRAW_ARB);
+         numParticles=snapshot.compactParticles.size();
+         vertexSize=sizeof(QuantizedPoint);
+         if (numParticles > 0)
+            vertices=&snapshot.compactParticles[0];
+      }
+      else if (!snapshot.gpuProjection)
+      {
+         numParticles=snapshot.particles.size();
+         if (numParticles > 0)
+            vertices=&snapshot.particles[0];
+      }
+      else if (shaderProjection)
+      {
+         numParticles=snapshot.states.size();
+         vertexSize=sizeof(DotSpreaderData::StateVertex);
+         if (numParticles > 0)
+            vertices=&snapshot.states[0];
+      }
+      else
+      {
+         projectStates(snapshot.states, projected);
+         numParticles=projected.size();
+         if (numParticles > 0)
+            vertices=&projected[0];
+      }
 
-         dataItem->versionDS = data.currentVersion;
+      // the CPU-projected fallback is drawn from client memory
+      DTS::StreamingBuffer* buffer=dataItem->dotSpreaderBuffer;
+      if (snapshot.gpuProjection && !shaderProjection)
+         buffer=0;
+
+      // quantized positions are scaled back by the modelview matrix, and
+      // take their colors from an array that only changes with the colors
+      DTS::StreamingBuffer* colorBuffer=0;
+      GLsizei numColors=numParticles;
+      if (compact)
+      {
+         const float* offset=snapshot.quantizer.getOffset();
+         float scale=snapshot.quantizer.getScale();
+         glPushMatrix();
+         glTranslatef(offset[0], offset[1], offset[2]);
+         glScalef(scale, scale, scale);
+
+         const void* colors=numParticles > 0 ? &snapshot.colors[0] : 0;
+         colorBuffer=buffer ? dataItem->dotSpreaderColorBuffer : 0;
+         if (colorBuffer)
+         {
+            upload(*colorBuffer, colors, numParticles, sizeof(snapshot.colors[0]),
+                  snapshot.colorVersion);
+            colorBuffer->bind();
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, 0);
+            glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+            numColors=colorBuffer->count;
+         }
+         else
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors);
       }
 
-      glInterleavedArrays(GL_C4UB_V3F, sizeof(ColorPoint), 0);
+      if (buffer)
+      {
+         upload(*buffer, vertices, numParticles, vertexSize, snapshot.version);
+
+         // a failed upload leaves the arrays of an older snapshot, which
+         // may hold a different number of particles
+         buffer->bind();
+         setVertexPointers(0, shaderProjection, compact);
+         glDrawArrays(GL_POINTS, 0, std::min(buffer->count, numColors));
+         buffer->fence();
+         if (colorBuffer)
+            colorBuffer->fence();
+         glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+      }
+      else if (numParticles > 0)
+      {
+         setVertexPointers(vertices, shaderProjection, compact);
+         glDrawArrays(GL_POINTS, 0, numParticles);
+      }
 
-      glDrawArrays(GL_POINTS, 0, dataItem->numParticlesDS);
+      if (compact)
+         glPopMatrix();
 
+      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
       glDisableClientState(GL_COLOR_ARRAY);
       glDisableClientState(GL_VERTEX_ARRAY);
 
@@ -293,23 +396,317 @@ void DotSpreaderTool::render(DTS::DataItem* dataItem) const
    }
 }
 
+/** Converts the transformer's projection into the two matrices of the
+ *  projection shader, which take state components 0-3 and 4-7. Returns
+ *  false if the transformation is not linear.
+ */
+bool DotSpreaderTool::getProjectionMatrices(GLfloat matrices[2][16]) const
+{
+   int dimension=data.dimension;
+   double projection[3 * DotSpreaderData::MaxProjectedDimension];
+   ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+   if (dimension > DotSpreaderData::MaxProjectedDimension
+         || !experiment->transformer->getProjection(projection))
+      return false;
+
+   // column-major; column j takes state component j, row i gives display
+   // coordinate i
+   for (int m=0; m < 2; m++)
+   {
+      for (int j=0; j < 4; j++)
+      {
+         int component=4 * m + j;
+         for (int i=0; i < 4; i++)
+         {
+            matrices[m][4 * j + i]=(i < 3 && component < dimension)
+                  ? projection[i * dimension + component] : 0.0f;
+         }
+      }
+   }
+   return true;
+}
+
+/** Projects unprojected particles on the CPU, for drawing without the
+ *  projection shader.
+ */
+void DotSpreaderTool::projectStates(const DotSpreaderData::StateVertexArray& states,
+      DotSpreaderData::ParticleArray& particles) const
+{
+   int dimension=data.dimension;
+   DTS::Vector<double> state(dimension);
+   if (dimension > DotSpreaderData::MaxProjectedDimension)
+      dimension=DotSpreaderData::MaxProjectedDimension;
+   DTS::Vector<double> display(3);
+   ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+
+   particles.resize(states.size());
+   for (size_t i=0; i < states.size(); i++)
+   {
+      for (int j=0; j < dimension; j++)
+         state[j]=states[i].state[j];
+      experiment->transformer->transform(state, display);
+
+      for (int j=0; j < 4; j++)
+         particles[i].color[j]=states[i].color[j];
+      particles[i].pos[0]=display[0];
+      particles[i].pos[1]=display[1];
+      particles[i].pos[2]=display[2];
+   }
+}
+
+/** Writes count items of itemSize bytes to the next buffer of the ring,
+ *  unless it holds the given version of them already. On failure the
+ *  buffer keeps its previous version and count.
+ */
+void DotSpreaderTool::upload(DTS::StreamingBuffer& buffer, const void* items,
+      GLsizei count, size_t itemSize, unsigned int version)
+{
+   if (buffer.version == version)
+      return;
+
+   size_t size=count * itemSize;
+   void* mapped=count > 0 ? buffer.map(size) : 0;
+   if (mapped)
+   {
+      memcpy(mapped, items, size);
+      if (buffer.unmap())
+      {
+         buffer.count=count;
+         buffer.version=version;
+      }
+   }
+   else if (count == 0)
+   {
+      buffer.count=0;
+      buffer.version=version;
+   }
+}
+
+/** Sets the vertex arrays for vertices at base (an offset into the bound
+ *  buffer, or a client pointer), for the projection shader, as
+ *  QuantizedPoints or as ColorPoints. The shader gets state components 0-3
+ *  as the vertex and 4-7 as texture coordinates of unit 0. QuantizedPoints
+ *  carry no colors; render() sets the color array for them.
+ */
+void DotSpreaderTool::setVertexPointers(const void* base, bool unprojected,
+      bool compact)
+{
+   const char* first=static_cast<const char*> (base);
+
+   if (compact)
+   {
+      glVertexPointer(4, GL_SHORT, sizeof(QuantizedPoint), base);
+      return;
+   }
+
+   if (!unprojected)
+   {
+      glInterleavedArrays(GL_C4UB_V3F, sizeof(ColorPoint), base);
+      return;
+   }
+
+   GLsizei stride=sizeof(DotSpreaderData::StateVertex);
+   size_t state=offsetof(DotSpreaderData::StateVertex, state);
+
+   glColorPointer(4, GL_UNSIGNED_BYTE, stride,
+         first + offsetof(DotSpreaderData::StateVertex, color));
+   glVertexPointer(4, GL_FLOAT, stride, first + state);
+   glTexCoordPointer(4, GL_FLOAT, stride, first + state + 4 * sizeof(GLfloat));
+   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+/** Advances a range of dot spreader particles and flags the ones that
+ *  escape, for step() to recycle before they are published.
+ */
+class DotSpreaderStepTask: public ThreadPool::Task
+{
+   public:
+      DotSpreaderStepTask(ThreadPool& pool, DTSExperiment& experiment,
+            DotSpreaderData::StateArray& states, const DTS::EscapeTest<double>& escapeTest,
+            std::vector<unsigned char>& escaped) :
+         pool(pool), experiment(experiment), states(states), escapeTest(escapeTest),
+         escaped(escaped)
+      {
+      }
+
+      void run(size_t begin, size_t end, unsigned int thread)
+      {
+         ThreadPool::Scratch& scratch = pool.getScratch(thread);
+
+         double* first = states.getData() + begin;
+         experiment.integrator->stepBatch(first, first, end - begin,
+               states.getStride(), scratch.integrator);
+         escapeTest.mark(first, end - begin, states.getStride(), &escaped[begin]);
+      }
+
+   private:
+      ThreadPool& pool;
+      DTSExperiment& experiment;
+      DotSpreaderData::StateArray& states;
+      const DTS::EscapeTest<double>& escapeTest;
+      std::vector<unsigned char>& escaped;
+};
+
+/** Writes a range of dot spreader particles into the snapshot being
+ *  published, in the vertex layout render() uploads: projected on the CPU,
+ *  or as unprojected states when the snapshot is for the projection shader.
+ *  Compact snapshots get their colors only if copyColors is set.
+ */
+class DotSpreaderPublishTask: public ThreadPool::Task
+{
+   public:
+      DotSpreaderPublishTask(ThreadPool& pool, DTSExperiment& experiment,
+            const DotSpreaderData::StateArray& states, const DotSpreaderData::ParticleArray& particles,
+            DotSpreaderData::Snapshot& snapshot, bool copyColors) :
+         pool(pool), experiment(experiment), states(states), particles(particles),
+         snapshot(snapshot), copyColors(copyColors)
+      {
+      }
+
+      void run(size_t begin, size_t end, unsigned int thread)
+      {
+         ThreadPool::Scratch& scratch = pool.getScratch(thread);
+
+         if (snapshot.gpuProjection)
+         {
+            int dimension = states.getDimension();
+            for (size_t i=begin; i < end; i++)
+            {
+               DotSpreaderData::StateVertex& vertex = snapshot.states[i];
+               for (int j=0; j < 4; j++)
+                  vertex.color[j] = particles[i].color[j];
+               for (int j=0; j < dimension; j++)
+                  vertex.state[j] = states(i, j);
+               for (int j=dimension; j < DotSpreaderData::MaxProjectedDimension; j++)
+                  vertex.state[j] = 0.0f;
+            }
+            return;
+         }
+
+         ParameterClass<double>::Pin transformerPin(*experiment.transformer);
+         scratch.state.setDimension(states.getDimension());
+
+         if (snapshot.compact)
+         {
+            const DTS::Quantizer& quantizer = snapshot.quantizer;
+            DotSpreaderData::CompactParticleArray& vertices = snapshot.compactParticles;
+            for (size_t i=begin; i < end; i++)
+            {
+               states.getState(i, scratch.state);
+               experiment.transformer->transform(scratch.state, scratch.display);
+               for (int j=0; j < 3; j++)
+                  vertices[i].pos[j] = quantizer.quantize(scratch.display[j], j);
+               vertices[i].w = 1;
+            }
+
+            if (copyColors)
+            {
+               for (size_t i=begin; i < end; i++)
+                  snapshot.colors[i] = particles[i].color;
+            }
+            return;
+         }
+
+         DotSpreaderData::ParticleArray& vertices = snapshot.particles;
+         for (size_t i=begin; i < end; i++)
+         {
+            states.getState(i, scratch.state);
+            experiment.transformer->transform(scratch.state, scratch.display);
+            vertices[i].color = particles[i].color;
+            vertices[i].pos[0] = scratch.display[0];
+            vertices[i].pos[1] = scratch.display[1];
+            vertices[i].pos[2] = scratch.display[2];
+         }
+      }
+
+   private:
+      ThreadPool& pool;
+      DTSExperiment& experiment;
+      const DotSpreaderData::StateArray& states;
+      const DotSpreaderData::ParticleArray& particles;
+      DotSpreaderData::Snapshot& snapshot;
+      bool copyColors;
+};
+
 void DotSpreaderTool::step()
 {
    // exit if simulation is paused (dragging release sphere)
-   if (!data.running)
+   if (!data.running || data.numPoints == 0)
       return;
 
-   for (int i=0; i < data.numPoints; i++)
+   // advance all particles in place, split over the worker threads
+   ThreadPool* pool = application->getThreadPool();
+   escapeTest.setBounds(*experiment->model, data.escapeFactor);
+   escaped.assign(data.states.size(), 0);
+   DotSpreaderStepTask task(*pool, *experiment, data.states, escapeTest, escaped);
+   pool->parallelFor(data.states.size(), StepGrainSize, task);
+
+   // escaped particles are removed or released again before publishing,
+   // so they are never drawn
+   recycleEscaped();
+   escaped.clear();
+
+   // write the new positions into the snapshot for render()
+   DotSpreaderData::Snapshot& snapshot=data.snapshots.startNewValue();
+   snapshot.gpuProjection=data.gpuProjection
+         && data.dimension <= DotSpreaderData::MaxProjectedDimension;
+   snapshot.compact=data.compactVertices && !snapshot.gpuProjection;
+   bool copyColors=false;
+   if (snapshot.gpuProjection)
    {
-      experiment->integrator->step(data.states[i], tempState);
-      data.states[i] += tempState;
-      experiment->transformer->transform(data.states[i], tempDisplay);
-      data.particles[i].pos[0] = tempDisplay[0];
-      data.particles[i].pos[1] = tempDisplay[1];
-      data.particles[i].pos[2] = tempDisplay[2];
+      snapshot.states.resize(data.states.size());
+      snapshot.particles.clear();
+      snapshot.compactParticles.clear();
+      snapshot.colors.clear();
+      snapshot.colorVersion=0;
    }
+   else if (snapshot.compact)
+   {
+      snapshot.compactParticles.resize(data.states.size());
+      snapshot.particles.clear();
+      snapshot.states.clear();
+
+      // the colors are only copied when they changed since this snapshot
+      // last held them
+      copyColors=snapshot.colorVersion != data.colorVersion;
+      if (copyColors)
+         snapshot.colors.resize(data.states.size());
+      snapshot.colorVersion=data.colorVersion;
+
+      // quantize within twice the radius of the attractor
+      ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+      DTS::Vector<double> center=experiment->transformer->getCenterPoint();
+      double box[3]= { center[0], center[1], center[2] };
+      snapshot.quantizer.setBox(box, 2.0 * experiment->transformer->getRadius());
+   }
+   else
+   {
+      snapshot.particles.resize(data.states.size());
+      snapshot.states.clear();
+      snapshot.compactParticles.clear();
+      snapshot.colors.clear();
+      snapshot.colorVersion=0;
+   }
+
+   DotSpreaderPublishTask publish(*pool, *experiment, data.states, data.particles,
+         snapshot, copyColors);
+   pool->parallelFor(data.states.size(), StepGrainSize, publish);
 
    data.currentVersion++;
+   snapshot.escaped=data.escapedCount;
+   snapshot.recycled=data.recycledCount;
+   snapshot.version=data.currentVersion;
+   data.snapshots.postNewValue();
+}
+
+void DotSpreaderTool::lockSnapshot()
+{
+   if (data.snapshots.lockNewValue() && dialog != 0)
+   {
+      const DotSpreaderData::Snapshot& snapshot=data.snapshots.getLockedValue();
+      static_cast<DotSpreaderOptionsDialog*> (dialog)->setEscapeCounts(
+            snapshot.escaped, snapshot.recycled);
+   }
 }
 
 void DotSpreaderTool::moved(const ToolBox::MotionEvent & motionEvent)
@@ -333,7 +730,7 @@ void DotSpreaderTool::mainButtonPressed(const ToolBox::ButtonPressEvent & motion
    org=toolBox()->deviceTransformationInModel().getOrigin();
 
    // pause simulation (integration)
-   data.running=false;
+   post(makeChange(this, &DotSpreaderTool::applyPause));
 
    // set active (dragging) flag
    active=true;
@@ -360,94 +757,246 @@ void DotSpreaderTool::mainButtonReleased(const ToolBox::ButtonReleaseEvent & but
 }
 
 
-void DotSpreaderTool::releaseParticles(Vrui::Point pos, Vrui::Scalar radius)
+/** Places a range of released dot spreader particles in a sphere.
+ *
+ * Particle i takes its random numbers from the counter (i, step, draw,
+ * release), where release numbers the releases within the step, or point
+ * i of a low-discrepancy sequence, so where a particle lands does
+ * not depend on how the range is split. With a selection, only the
+ * particles it flags are placed.
+ */
+class DotSpreaderReleaseTask: public ThreadPool::Task
 {
-   // release particles distributed within sphere
-   double x, y, z;
-
-   double xMin=pos[0] - radius;
-   double xMax=pos[0] + radius;
-   double yMin=pos[1] - radius;
-   double yMax=pos[1] + radius;
-   double zMin=pos[2] - radius;
-   double zMax=pos[2] + radius;
-   double deltaX=xMax - xMin;
-   double deltaY=yMax - yMin;
-   double deltaZ=zMax - zMin;
-
-   if (data.distribution == DotSpreaderData::SURFACE)
-   {
-      // distribute particles on surface of sphere
-      for (int i=0; i < data.numPoints; i++)
+   public:
+      DotSpreaderReleaseTask(ThreadPool& pool, DTSExperiment& experiment,
+            DotSpreaderData::StateArray& states, DotSpreaderData::ParticleArray& particles,
+            DotSpreaderData::Distribution distribution, const DTS::CounterRng& rng,
+            unsigned int step, unsigned int release, const Vrui::Point& center,
+            double radius, size_t count, const std::vector<unsigned char>* selected=0) :
+         pool(pool), experiment(experiment), states(states), particles(particles),
+         distribution(distribution), rng(rng), step(step), release(release),
+         center(center), radius(radius), count(count), selected(selected)
       {
-
-         double u=(double) rand() / (double) RAND_MAX * 2.0 * radius - radius;
-         double theta=(double) rand() / (double) RAND_MAX * 2.0 * M_PI;
-
-         x=Math::sqrt(radius * radius - u * u) * Math::cos(theta);
-         y=Math::sqrt(radius * radius - u * u) * Math::sin(theta);
-         z=u;
-
-         x+=pos[0];
-         y+=pos[1];
-         z+=pos[2];
-
-         data.particles[i].pos[0]=x;
-         data.particles[i].pos[1]=y;
-         data.particles[i].pos[2]=z;
-
-         tempDisplay[0] = x;
-         tempDisplay[1] = y;
-         tempDisplay[2] = z;
-         experiment->transformer->invTransform(tempDisplay, data.states[i]);
-
-         data.particles[i].color[0]=(unsigned int) (((x - xMin) / deltaX)
-               * 255.0);
-         data.particles[i].color[1]=(unsigned int) (((y - yMin) / deltaY)
-               * 255.0);
-         data.particles[i].color[2]=(unsigned int) (((z - zMin) / deltaZ)
-               * 255.0);
-         data.particles[i].color[3]=255;
       }
-   }
-   else if (data.distribution == DotSpreaderData::VOLUME)
-   {
-      // distribute particles within the sphere
-      for (int i=0; i < data.numPoints; i++)
+
+      void run(size_t begin, size_t end, unsigned int thread)
       {
+         ThreadPool::Scratch& scratch = pool.getScratch(thread);
+         scratch.state.setDimension(states.getDimension());
+
+         ParameterClass<double>::Pin transformerPin(*experiment.transformer);
 
-         do
+         for (size_t i=begin; i < end; i++)
          {
-            x=((double) rand() / (double) RAND_MAX) * 2.0 * radius - radius;
-            y=((double) rand() / (double) RAND_MAX) * 2.0 * radius - radius;
-            z=((double) rand() / (double) RAND_MAX) * 2.0 * radius - radius;
-         } while (x * x + y * y + z * z > radius * radius);
-
-         x+=pos[0];
-         y+=pos[1];
-         z+=pos[2];
-
-         data.particles[i].pos[0]=x;
-         data.particles[i].pos[1]=y;
-         data.particles[i].pos[2]=z;
-
-         tempDisplay[0] = x;
-         tempDisplay[1] = y;
-         tempDisplay[2] = z;
-         experiment->transformer->invTransform(tempDisplay, data.states[i]);
-
-         data.particles[i].color[0]=(unsigned int) (((x - xMin) / deltaX)
-               * 255.0);
-         data.particles[i].color[1]=(unsigned int) (((y - yMin) / deltaY)
-               * 255.0);
-         data.particles[i].color[2]=(unsigned int) (((z - zMin) / deltaZ)
-               * 255.0);
-         data.particles[i].color[3]=255;
+            if (selected && !(*selected)[i])
+               continue;
+
+            double u[4];
+            double offset[3];
+
+            if (distribution == DotSpreaderData::SURFACE)
+            {
+               // uniform height and angle give a uniform surface density
+               rng.uniform(i, step, 0, release, u);
+               double z=u[0] * 2.0 * radius - radius;
+               double theta=u[1] * 2.0 * M_PI;
+               offset[0]=Math::sqrt(radius * radius - z * z) * Math::cos(theta);
+               offset[1]=Math::sqrt(radius * radius - z * z) * Math::sin(theta);
+               offset[2]=z;
+            }
+            else if (distribution == DotSpreaderData::FIBONACCI_SURFACE)
+            {
+               DTS::QuasiRandom::fibonacciSphere(i, count, offset);
+               for (int j=0; j < 3; j++)
+                  offset[j]*=radius;
+            }
+            else if (distribution == DotSpreaderData::HALTON_VOLUME)
+            {
+               DTS::QuasiRandom::haltonBall(i, offset);
+               for (int j=0; j < 3; j++)
+                  offset[j]*=radius;
+            }
+            else
+            {
+               // rejection sampling from the cube, a new draw per attempt
+               DTS::CounterRng::Word draw=0;
+               do
+               {
+                  rng.uniform(i, step, draw++, release, u);
+                  for (int j=0; j < 3; j++)
+                     offset[j]=u[j] * 2.0 * radius - radius;
+               } while (offset[0] * offset[0] + offset[1] * offset[1]
+                     + offset[2] * offset[2] > radius * radius);
+            }
+
+            for (int j=0; j < 3; j++)
+            {
+               double x=center[j] + offset[j];
+               particles[i].pos[j]=x;
+               scratch.display[j]=x;
+
+               // color by position within the bounding box of the sphere
+               particles[i].color[j]=(unsigned int) ((offset[j] + radius)
+                     / (2.0 * radius) * 255.0);
+            }
+            particles[i].color[3]=255;
+
+            experiment.transformer->invTransform(scratch.display, scratch.state);
+            states.setState(i, scratch.state);
+         }
       }
-   }
 
+   private:
+      ThreadPool& pool;
+      DTSExperiment& experiment;
+      DotSpreaderData::StateArray& states;
+      DotSpreaderData::ParticleArray& particles;
+      DotSpreaderData::Distribution distribution;
+      const DTS::CounterRng& rng;
+      unsigned int step; ///< Simulation step of the release.
+      unsigned int release; ///< Number of the release within the step.
+      Vrui::Point center;
+      double radius;
+      size_t count; ///< Number of particles released.
+      const std::vector<unsigned char>* selected; ///< Particles to place, or 0 for all.
+};
+
+void DotSpreaderTool::releaseParticles(Vrui::Point pos, Vrui::Scalar radius)
+{
    // turn off active (dragging) flag
    active=false;
+
+   post(makeChange(this, &DotSpreaderTool::applyRelease, pos, radius));
+}
+
+//
+// DotSpreaderTool changes
+//
+
+void DotSpreaderTool::applyClear()
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.running = false;
+   data.currentVersion++;
+}
+
+void DotSpreaderTool::applyNumberOfParticles(unsigned int num)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.setNumberOfParticles(num);
+}
+
+void DotSpreaderTool::applyDistribution(DotSpreaderData::Distribution dist)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.distribution=dist;
+}
+
+void DotSpreaderTool::applyEscapePolicy(DotSpreaderData::EscapePolicy policy)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.escapePolicy=policy;
+}
+
+void DotSpreaderTool::applyEscapeFactor(double factor)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.escapeFactor=factor;
+}
+
+void DotSpreaderTool::applyPause()
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.running=false;
+}
+
+void DotSpreaderTool::applyRelease(Vrui::Point pos, Vrui::Scalar radius)
+{
+   // release particles distributed within sphere
+   Threads::Mutex::Lock stepLock(stepMutex);
+
+   // particles removed after escaping come back
+   data.states.resize(data.numPoints);
+   data.particles.resize(data.numPoints);
+   escaped.clear();
+
+   data.releaseCenter=pos;
+   data.releaseRadius=radius;
+   data.escapedCount=0;
+   data.recycledCount=0;
+   data.colorVersion++;
+
+   // every release draws new numbers from its step; the same releases at
+   // the same steps repeat the same particles, whatever the number of
+   // threads or the cluster node
+   unsigned int step=application->getSimulationStep();
+   ThreadPool* pool = application->getThreadPool();
+   DotSpreaderReleaseTask task(*pool, *experiment, data.states, data.particles,
+         data.distribution, rng, step, releases.next(step), pos, radius,
+         data.numPoints);
+   pool->parallelFor(data.numPoints, StepGrainSize, task);
+
    // resume simulation (integration)
    data.running=true;
 }
+
+/** Removes or releases again the particles flagged as escaped by the step
+ *  just taken. Removal moves the last particle into the freed slot.
+ */
+void DotSpreaderTool::recycleEscaped()
+{
+   // flags of an earlier release, or of a different number of particles
+   if (escaped.size() != data.states.size())
+   {
+      escaped.clear();
+      return;
+   }
+   if (std::find(escaped.begin(), escaped.end(), 1) == escaped.end())
+      return;
+
+   // both policies change colors: re-seeded particles are colored anew, and
+   // removal reorders the particles
+   data.colorVersion++;
+
+   if (data.escapePolicy == DotSpreaderData::RESEED_ESCAPED)
+   {
+      // re-seeded particles are placed at random, so even distributions do
+      // not put them back where they escaped from
+      DotSpreaderData::Distribution distribution=data.distribution;
+      if (distribution == DotSpreaderData::FIBONACCI_SURFACE)
+         distribution=DotSpreaderData::SURFACE;
+      else if (distribution == DotSpreaderData::HALTON_VOLUME)
+         distribution=DotSpreaderData::VOLUME;
+
+      size_t count=std::count(escaped.begin(), escaped.end(), 1);
+      data.escapedCount+=count;
+      data.recycledCount+=count;
+
+      // placed by the workers, which own the pool scratch while the loop runs;
+      // numbered with the releases of the step just taken
+      unsigned int step=application->getSimulationStep();
+      ThreadPool* pool=application->getThreadPool();
+      DotSpreaderReleaseTask release(*pool, *experiment, data.states, data.particles,
+            distribution, rng, step, releases.next(step), data.releaseCenter,
+            data.releaseRadius, data.numPoints, &escaped);
+      pool->parallelFor(data.states.size(), StepGrainSize, release);
+      return;
+   }
+
+   size_t i=0;
+   while (i < data.states.size())
+   {
+      if (!escaped[i])
+      {
+         ++i;
+         continue;
+      }
+
+      data.escapedCount++;
+      data.particles[i]=data.particles.back();
+      data.particles.pop_back();
+      data.states.swapRemove(i);
+      escaped[i]=escaped.back();
+      escaped.pop_back();
+   }
+}
@@ -22,6 +22,7 @@
 
 // Vrui includes
 //
+#include <Threads/TripleBuffer.h>
 #include <GL/GLFrustum.h>
 #include <GL/GLModels.h>
 
@@ -39,8 +40,14 @@
 #include "FieldViewer.h"
 #include "DataItem.h"
 #include "ColorPoint.h"
+#include "CounterRng.h"
+#include "QuasiRandom.h"
+#include "QuantizedPoint.h"
+#include "Quantizer.h"
 #include "AbstractDynamicsTool.h"
 #include "Dynamics/Vector.h"
+#include "Dynamics/ParticleStateArena.h"
+#include "Dynamics/EscapeTest.h"
 
 #include "DotSpreaderOptionsDialog.h"
 
@@ -62,14 +69,58 @@ class DotSpreaderData
       enum Distribution
       {
          SURFACE, ///< Distribute particles on surface of sphere.
-         VOLUME   ///< Distribute particles throughout volume of sphere.
+         VOLUME,  ///< Distribute particles throughout volume of sphere.
+         FIBONACCI_SURFACE, ///< Spread particles evenly on surface of sphere.
+         HALTON_VOLUME ///< Spread particles evenly throughout volume of sphere.
+      };
+
+      /// What becomes of particles that escape (see DTS::EscapeTest).
+      enum EscapePolicy
+      {
+         REMOVE_ESCAPED, ///< Stop integrating them.
+         RESEED_ESCAPED  ///< Release them again, in the last release sphere.
+      };
+
+      /// Largest model dimension the projection shader accepts.
+      static const int MaxProjectedDimension=8;
+
+      /// Vertex of an unprojected particle; the shader projects the state.
+      struct StateVertex
+      {
+         GLubyte color[4];
+         GLfloat state[MaxProjectedDimension]; ///< Unused components are 0.
       };
 
       typedef std::vector<ColorPoint> ParticleArray;
-      typedef std::vector<DTS::Vector<double> > StateArray;
+      typedef std::vector<QuantizedPoint> CompactParticleArray;
+      typedef std::vector<GLColor<GLubyte, 4> > ColorArray;
+      typedef std::vector<StateVertex> StateVertexArray;
+      typedef DTS::ParticleStateArena<double> StateArray;
+
+      /// Particles as of one simulation step, as seen by render().
+      struct Snapshot
+      {
+         bool gpuProjection; ///< Whether states (true) or particles (false) holds the particles.
+         bool compact; ///< Whether compactParticles and colors replace particles.
+         ParticleArray particles; ///< Projected on the CPU by the step tasks.
+         CompactParticleArray compactParticles; ///< Same positions, quantized by quantizer.
+         ColorArray colors; ///< Colors of compactParticles, copied when they change.
+         unsigned int colorVersion; ///< Value of DotSpreaderData::colorVersion when colors was copied.
+         DTS::Quantizer quantizer;
+         StateVertexArray states; ///< Unprojected, for the projection shader.
+         unsigned long escaped; ///< Particles escaped since the last release.
+         unsigned long recycled; ///< Escaped particles released again.
+         unsigned int version; ///< Value of currentVersion when published.
+
+         Snapshot() :
+            gpuProjection(false), compact(false), colorVersion(0), escaped(0),
+                  recycled(0), version(0)
+         {
+         }
+      };
 
    private:
-      ParticleArray particles;
+      ParticleArray particles; ///< Release positions and colors.
       StateArray states;
 
       bool running;
@@ -77,14 +128,28 @@ class DotSpreaderData
       float point_radius;
       Distribution distribution;
       int dimension;
+      bool gpuProjection; ///< Publish unprojected states when the dimension allows it.
+      bool compactVertices; ///< Publish CPU-projected particles quantized.
+
+      EscapePolicy escapePolicy;
+      double escapeFactor; ///< Scale of the model's coordinate ranges a particle may leave.
+      unsigned long escapedCount; ///< Since the last release.
+      unsigned long recycledCount; ///< Since the last release.
+      Vrui::Point releaseCenter; ///< Sphere of the last release.
+      double releaseRadius;
 
       unsigned int currentVersion;
+      unsigned int colorVersion; ///< Changed when the colors or the order of particles change.
+      Threads::TripleBuffer<Snapshot> snapshots; ///< Written by step(), read by render().
 
       // numPoints(50000), point_radius(0.1),
 
       DotSpreaderData() :
          running(false), numPoints(10000), point_radius(0.05),
-               distribution(SURFACE), dimension(0), currentVersion(0)
+               distribution(SURFACE), dimension(0), gpuProjection(false),
+               compactVertices(false), escapePolicy(REMOVE_ESCAPED),
+               escapeFactor(10.0), escapedCount(0), recycledCount(0),
+               releaseRadius(0.0), currentVersion(0), colorVersion(1)
       {
       }
 
@@ -96,27 +161,18 @@ class DotSpreaderData
       void setNumberOfParticles(int num)
       {
          particles.resize(num);
-
-         if (num > numPoints)
-         {
-            for (int i=numPoints; i < num; i++)
-            {
-               particles.push_back(ColorPoint());
-               states.push_back(DTS::Vector<double>(dimension));
-            }
-         }
+         states.resize(num);
          numPoints=num;
+         colorVersion++;
       }
 
       void init(int dimension)
       {
          this->dimension = dimension;
 
-         for (int i=0; i < numPoints; i++)
-         {
-            particles.push_back(ColorPoint());
-            states.push_back(DTS::Vector<double>(dimension));
-         }
+         particles.resize(numPoints);
+         states.setDimension(dimension);
+         states.resize(numPoints);
       }
 };
 
@@ -168,7 +224,7 @@ class DotSpreaderTool: public AbstractDynamicsTool, public GLObject
 
       DotSpreaderTool(ToolBox::ToolBox* toolBox, Viewer* app) :
          AbstractDynamicsTool(toolBox, app), dataInited(false),
-         active(false), tempDisplay(3)
+         active(false), rng(1234), tempDisplay(3)
       {
          icon(new Icon(this));
 
@@ -187,7 +243,7 @@ class DotSpreaderTool: public AbstractDynamicsTool, public GLObject
          experiment = e;
          tempState.setDimension( experiment->model->getDimension() );
 
-         if (!dataInited)
+         if (!dataInited || data.dimension != experiment->model->getDimension())
          {
             data.init( experiment->model->getDimension() );
             dataInited = true;
@@ -211,6 +267,7 @@ class DotSpreaderTool: public AbstractDynamicsTool, public GLObject
 
       virtual void render(DTS::DataItem* dataItem) const;
       virtual void step();
+      virtual void lockSnapshot();
 
       virtual CaveDialog* createOptionsDialog(GLMotif::PopupMenu *parent)
       {
@@ -222,18 +279,33 @@ class DotSpreaderTool: public AbstractDynamicsTool, public GLObject
 
       void clearParticles()
       {
-         data.running = false;
-         data.currentVersion++;
+         post(makeChange(this, &DotSpreaderTool::applyClear));
       }
 
       void setNumberOfParticles(unsigned int num)
       {
-         data.setNumberOfParticles(num);
+         post(makeChange(this, &DotSpreaderTool::applyNumberOfParticles, num));
       }
 
       void setDistributionMethod(DotSpreaderData::Distribution dist)
       {
-         data.distribution=dist;
+         post(makeChange(this, &DotSpreaderTool::applyDistribution, dist));
+      }
+
+      /** Sets whether particles that escape are removed or released again.
+       *  Either way they no longer cost integration steps.
+       */
+      void setEscapePolicy(DotSpreaderData::EscapePolicy policy)
+      {
+         post(makeChange(this, &DotSpreaderTool::applyEscapePolicy, policy));
+      }
+
+      /** Sets how far, as a multiple of the model's coordinate ranges
+       *  about their centers, particles may go before they escape.
+       */
+      void setEscapeFactor(double factor)
+      {
+         post(makeChange(this, &DotSpreaderTool::applyEscapeFactor, factor));
       }
 
       void setPointSize(float value)
@@ -241,14 +313,65 @@ class DotSpreaderTool: public AbstractDynamicsTool, public GLObject
          data.point_radius=value;
       }
 
+      /** Moves the projection of the particles into the vertex shader, so a
+       *  change of the displayed coordinates applies at once, even to a
+       *  paused cloud. Takes effect with the next step.
+       */
+      void setGpuProjection(bool enabled)
+      {
+         Threads::Mutex::Lock stepLock(stepMutex);
+         data.gpuProjection=enabled;
+      }
+
+      /** Publishes CPU-projected particles as 8-byte quantized positions
+       *  instead of 16-byte colored vertices, which halves the data uploaded
+       *  per step. The colors are uploaded on their own, only after a
+       *  release or when escaped particles are recycled. The positions are
+       *  quantized within twice the transformer's radius around its center
+       *  point; particles beyond are drawn on the faces of that cube. Takes
+       *  effect with the next step.
+       */
+      void setCompactVertices(bool enabled)
+      {
+         Threads::Mutex::Lock stepLock(stepMutex);
+         data.compactVertices=enabled;
+      }
+
+      /** Releases the particles in a sphere, between the next two steps. */
       void releaseParticles(Vrui::Point pos, Vrui::Scalar radius);
 
    private:
+      /// Particles per parallel work item (results do not depend on it).
+      static const size_t StepGrainSize = 1024;
+
+      /* Changes, applied by the simulation thread (see post()) */
+      void applyClear();
+      void applyNumberOfParticles(unsigned int num);
+      void applyDistribution(DotSpreaderData::Distribution dist);
+      void applyEscapePolicy(DotSpreaderData::EscapePolicy policy);
+      void applyEscapeFactor(double factor);
+      void applyPause();
+      void applyRelease(Vrui::Point pos, Vrui::Scalar radius);
+
+      bool getProjectionMatrices(GLfloat matrices[2][16]) const;
+      void projectStates(const DotSpreaderData::StateVertexArray& states,
+            DotSpreaderData::ParticleArray& particles) const;
+      static void upload(DTS::StreamingBuffer& buffer, const void* items,
+            GLsizei count, size_t itemSize, unsigned int version);
+      static void setVertexPointers(const void* base, bool unprojected, bool compact);
+      void recycleEscaped();
+
       DotSpreaderData data;
       bool dataInited;
 
       bool active;
 
+      DTS::CounterRng rng; ///< Places the released particles.
+      DTS::StepEvents releases; ///< Numbers the releases and re-seeds within a step.
+
+      DTS::EscapeTest<double> escapeTest;
+      std::vector<unsigned char> escaped; ///< Per particle, whether it escaped in the step being taken.
+
       Vrui::Point pos;
       Vrui::Point org;
       DTS::Vector<double> tempDisplay;
@@ -18,11 +18,14 @@
  along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
  *******************************************************************************/
 #include "DynamicSolverTool.h"
+#include "FieldViewer.h"
 
 // Vrui includes
 //
 #include <GL/GLModels.h>
 #include <GL/GLFrustum.h>
+#include <GL/GLExtensionManager.h>
+#include <GL/GLGeometryWrappers.h>
 #include <GL/GLModels.h>
 
 // OpenGL includes
@@ -33,6 +36,37 @@
 // STL includes
 //
 #include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+typedef void (GLAPIENTRY *MultiDrawArraysProc)(GLenum mode, const GLint* first,
+      const GLsizei* count, GLsizei primcount);
+
+/** glMultiDrawArrays (OpenGL 1.4), or one glDrawArrays per primitive where
+ *  the local OpenGL does not have it. */
+void multiDrawArrays(GLenum mode, const GLint* first, const GLsizei* count,
+      GLsizei primcount)
+{
+   static bool resolved=false;
+   static MultiDrawArraysProc multiDraw=0;
+   if (!resolved)
+   {
+      multiDraw=GLExtensionManager::getFunction<MultiDrawArraysProc>("glMultiDrawArrays");
+      resolved=true;
+   }
+
+   if (multiDraw != 0)
+   {
+      multiDraw(mode, first, count, primcount);
+      return;
+   }
+   for (GLsizei i=0; i < primcount; i++)
+      glDrawArrays(mode, first[i], count[i]);
+}
+
+}
 
 //
 // DynamicSolverTool::Icon methods
@@ -101,56 +135,156 @@ void DynamicSolverTool::initContext(GLContextData& contextData) const
 
 void DynamicSolverTool::render(DTS::DataItem* dataItem) const
 {
-   // draw lines
-   if (data.lineStyle == DynamicSolverData::BASIC)
+   // basic lines come from the trail buffer, which binds itself
+   if (frameCache.lineStyle == DynamicSolverData::BASIC)
       drawBasicLines(dataItem);
-   else if (data.lineStyle == DynamicSolverData::POLYLINE)
-      drawPolylines(dataItem);
+
+   // copy the frame cache to this context, unless it has it already
+   FramePointers pointers;
+   DTS::StreamingBuffer* buffer=bindFrame(dataItem, pointers);
+
+   // draw lines
+   if (frameCache.lineStyle == DynamicSolverData::POLYLINE)
+      drawPolylines(dataItem, pointers);
 
    // draw heads
    if (data.headStyle == DynamicSolverData::POINT)
-      drawPointHeads(dataItem);
+      drawPointHeads(dataItem, pointers);
    else if (data.headStyle == DynamicSolverData::SPHERE)
-      drawSphereHeads(dataItem);
+      drawSphereHeads(dataItem, pointers);
+
+   if (buffer != 0)
+   {
+      glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+      buffer->fence();
+   }
 }
 
-void DynamicSolverTool::step()
+/** Advances the heads of a range of lines and writes their projections
+ *  into the trail ring. The tails are not touched. */
+class DynamicSolverStepTask: public ThreadPool::Task
 {
-   // for each point array (line)
-   for (Data::MultiPointArray::iterator pointSet=data.points.begin(); pointSet
-         != data.points.end(); ++pointSet)
-   {
-      // for each point in line
-      for (Data::PointArray::iterator point=(*pointSet).begin(); point
-             != (*pointSet).end(); ++point)
+   public:
+      DynamicSolverStepTask(ThreadPool& pool, DTSExperiment& experiment,
+            DTS::ParticleStateArena<double>& points, DynamicSolverData::Trails& trails) :
+         pool(pool), experiment(experiment), points(points), trails(trails)
+      {
+      }
+
+      void run(size_t begin, size_t end, unsigned int thread)
       {
-         // if point is the first value (head)
-         if (point == (*pointSet).begin())
+         ThreadPool::Scratch& scratch = pool.getScratch(thread);
+         ParameterClass<double>::Pin transformerPin(*experiment.transformer);
+         scratch.state.setDimension(points.getDimension());
+
+         double* first = points.getData() + begin;
+         experiment.integrator->stepBatch(first, first, end - begin,
+               points.getStride(), scratch.integrator);
+
+         size_t history = trails.history;
+         for (size_t i=begin; i < end; i++)
          {
-            // save the position
-            prev=(*point);
-            // integrate and move point to next position
-            experiment->integrator->step(*point, temp);
-            (*point) += temp;
+            points.getState(i, scratch.state);
+            experiment.transformer->transform(scratch.state, scratch.display);
+
+            DynamicSolverData::DisplayPoint head;
+            head[0] = scratch.display[0];
+            head[1] = scratch.display[1];
+            head[2] = scratch.display[2];
+
+            DynamicSolverData::DisplayPoint* line = &trails.points[i * 2 * history];
+            line[trails.newest] = head;
+            line[trails.newest + history] = head;
          }
-         // for all other points (tail) simply set to previous point
-         else
+      }
+
+   private:
+      ThreadPool& pool;
+      DTSExperiment& experiment;
+      DTS::ParticleStateArena<double>& points;
+      DynamicSolverData::Trails& trails;
+};
+
+//
+// DynamicSolverData::Snapshot methods
+//
+
+void DynamicSolverData::Snapshot::update(const Trails& trails)
+{
+   size_t numLines = trails.getNumLines();
+   unsigned int ringSize = 2 * trails.history;
+
+   if (layout != trails.layout || history != trails.history
+         || trails.step - step >= trails.history)
+   {
+      // lines were added or removed, or this snapshot is too old
+      points = trails.points;
+
+      positions.resize(points.size());
+      for (size_t k=0; k < positions.size(); k++)
+         positions[k] = k % ringSize;
+
+      counts.assign(numLines, trails.history);
+   }
+   else
+   {
+      // copy the heads of the steps since this snapshot was written
+      for (unsigned long n=step + 1; n <= trails.step; n++)
+      {
+         unsigned int position = (trails.newest + trails.history
+               - (trails.step - n)) % trails.history;
+
+         for (size_t i=0; i < numLines; i++)
          {
-            // We avoid std::swap which uses the copy constructor.
-            temp = (*point);
-            (*point) = prev;
-            prev = temp;
+            size_t k = i * ringSize + position;
+            points[k] = trails.points[k];
+            points[k + trails.history] = trails.points[k + trails.history];
          }
       }
    }
+
+   history = trails.history;
+   newest = trails.newest;
+   step = trails.step;
+   layout = trails.layout;
+
+   // the visible part of the ring moves with every step
+   firsts.resize(numLines);
+   for (size_t i=0; i < numLines; i++)
+      firsts[i] = getFirst(i);
+}
+
+void DynamicSolverTool::step()
+{
+   size_t count = data.getNumLines();
+
+   if (count > 0)
+   {
+      data.trails.newest = (data.trails.newest + 1) % data.trails.history;
+      data.trails.step++;
+
+      ThreadPool* pool = application->getThreadPool();
+      DynamicSolverStepTask task(*pool, *experiment, data.points, data.trails);
+      pool->parallelFor(count, StepGrainSize, task);
+   }
+
+   Data::Snapshot& snapshot = data.snapshots.startNewValue();
+   snapshot.update(data.trails);
+   data.snapshots.postNewValue();
+}
+
+void DynamicSolverTool::lockSnapshot()
+{
+   if (data.snapshots.lockNewValue() || frameCache.stale)
+      updateFrameCache();
 }
 
 void DynamicSolverTool::setExperiment(DTSExperiment* e)
 {
    experiment = e;
-   clearPoints();
-   prev.setDimension(e->model->getDimension());
+   applyClearPoints();
    temp.setDimension(e->model->getDimension());
+   data.points.setDimension(e->model->getDimension());
 }
 
 void DynamicSolverTool::moved(const ToolBox::MotionEvent & motionEvent)
@@ -170,6 +304,27 @@ void DynamicSolverTool::mainButtonReleased(const ToolBox::ButtonReleaseEvent & b
    
    // get current locator position
    pos=toolBox()->deviceTransformationInModel().getOrigin();
+
+   // the lines start between steps
+   post(makeChange(this, &DynamicSolverTool::applyAddLines, pos, data.cluster_size));
+}
+
+//
+// DynamicSolverTool changes
+//
+
+void DynamicSolverTool::applyClearPoints()
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.clearLines();
+}
+
+/** Adds a line starting at pos, and clusterSize-1 more around it. */
+void DynamicSolverTool::applyAddLines(Vrui::Point pos, unsigned int clusterSize)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+
    tempDisplay[0] = pos[0];
    tempDisplay[1] = pos[1];
    tempDisplay[2] = pos[2];
@@ -180,102 +335,293 @@ void DynamicSolverTool::mainButtonReleased(const ToolBox::ButtonReleaseEvent & b
    std::cout << "invTransform: " << temp << std::endl;
    std::cout << std::endl;
 
-   // create a new point array
-   DynamicSolverData::PointArray array;
+   // add a new line (all points set to locator position)
+   experiment->transformer->transform(temp, tempDisplay);
+   data.addLine(temp, DynamicSolverData::DisplayPoint(tempDisplay[0], tempDisplay[1], tempDisplay[2]));
 
-   // initialize the array (set values to locator position)
-   for (unsigned int i=0; i < data.history_size; i++)
+   if (clusterSize > 1)
    {
-      // makes a copy using copy constructor
-      array.push_back(temp);
+      DTS::Vector<double> head(temp);
+      unsigned int step = application->getSimulationStep();
+      unsigned int cluster = clusters.next(step);
+      for (unsigned int i=1; i < clusterSize; i++)
+      {
+         double u[4];
+         rng.uniform(i, step, 0, cluster, u);
+         for (int j=0; j < 3; j++)
+            head[j] = temp[j] + u[j] * 0.1 - 0.05;
+
+         experiment->transformer->transform(head, tempDisplay);
+         data.addLine(head, DynamicSolverData::DisplayPoint(tempDisplay[0], tempDisplay[1], tempDisplay[2]));
+      }
    }
 
-   // add to point array vector
-   data.points.push_back(array);
+}
+
+//
+// DynamicSolverTool internal methods
+//
+
+unsigned int DynamicSolverTool::nextFrameVersion=0;
+
+/** Builds the frame cache from the locked snapshot and the settings. */
+void DynamicSolverTool::updateFrameCache()
+{
+   const Data::Snapshot& snapshot=data.snapshots.getLockedValue();
+   size_t numLines=snapshot.getNumLines();
+
+   frameCache.lineStyle=data.lineStyle;
+   frameCache.colorStyle=data.colorStyle;
+
+   frameCache.heads.resize(numLines);
+   for (size_t i=0; i < numLines; i++)
+      frameCache.heads[i]=snapshot.getPoint(i, 0);
 
-   if (data.cluster_size > 1)
+   frameCache.spheres.clear();
+   if (data.headStyle == DynamicSolverData::SPHERE)
    {
-      for (unsigned int i=1; i < data.cluster_size; i++)
+      DTS::SphereRenderer::Color red(255, 0, 0, 255);
+      for (size_t i=0; i < numLines; i++)
       {
-         DynamicSolverData::PointArray a;
+         DTS::SphereRenderer::appendSphere(frameCache.spheres,
+               frameCache.heads[i], data.point_radius, red);
+      }
+   }
 
-         for (unsigned int j=0; j < data.history_size; j++)
+   frameCache.tubes.clear();
+   if (data.lineStyle == DynamicSolverData::POLYLINE)
+   {
+      // gradient colors of the points, oldest first as stored in the ring
+      std::vector<DTS::TubeRenderer::Color> gradient;
+      if (data.colorStyle == DynamicSolverData::GRADIENT)
+      {
+         gradient.resize(snapshot.history);
+         for (unsigned int j=0; j < snapshot.history; j++)
          {
-            a.push_back(temp);
-            a[j][0] += (float) rand() / (float) RAND_MAX * 0.1 - 0.05;
-            a[j][1] += (float) rand() / (float) RAND_MAX * 0.1 - 0.05;
-            a[j][2] += (float) rand() / (float) RAND_MAX * 0.1 - 0.05;
+            unsigned int i=snapshot.history - 1 - j;
+            int index=(int) ((float) i / (float) snapshot.history * 255.0);
+            const float* color=data.colorMap->getColor(index);
+            for (int c=0; c < 3; c++)
+               gradient[j][c]=(GLubyte) (color[c] * 255.0f + 0.5f);
+            gradient[j][3]=255;
          }
+      }
 
-         data.points.push_back(a);
+      for (size_t i=0; i < numLines; i++)
+      {
+         DTS::TubeRenderer::appendTube(frameCache.tubes,
+               &snapshot.points[snapshot.getFirst(i)], snapshot.history,
+               gradient.empty() ? 0 : &gradient[0]);
       }
    }
 
+   frameCache.version=++nextFrameVersion;
+   frameCache.stale=false;
 }
 
-//
-// DynamicSolverTool internal methods
-//
+/** Copies the frame cache to the context's vertex buffer if it holds an
+ *  older version, and binds it. Returns the buffer, or 0 if the draw
+ *  methods are to use client arrays.
+ */
+DTS::StreamingBuffer* DynamicSolverTool::bindFrame(DTS::DataItem* dataItem,
+      FramePointers& pointers) const
+{
+   const int NumParts=3;
+   const GLvoid** parts[NumParts]= { &pointers.tubes, &pointers.heads,
+         &pointers.spheres };
+   size_t sizes[NumParts];
+
+   pointers.tubes=frameCache.tubes.empty() ? 0 : &frameCache.tubes[0];
+   sizes[0]=frameCache.tubes.size() * sizeof(DTS::TubeRenderer::Vertex);
+   pointers.heads=frameCache.heads.empty() ? 0 : &frameCache.heads[0];
+   sizes[1]=frameCache.heads.size() * sizeof(Data::DisplayPoint);
+   pointers.spheres=frameCache.spheres.empty() ? 0 : &frameCache.spheres[0];
+   sizes[2]=frameCache.spheres.size() * sizeof(DTS::SphereRenderer::Vertex);
+
+   DTS::StreamingBuffer* buffer=dataItem->dynamicSolverBuffer;
+   if (buffer == 0)
+      return 0;
+
+   if (buffer->version != frameCache.version)
+   {
+      size_t size=0;
+      for (int k=0; k < NumParts; k++)
+         size+=sizes[k];
+      char* mapped=static_cast<char*> (buffer->map(size > 0 ? size : 1));
+      if (mapped == 0)
+      {
+         glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+         return 0;
+      }
+      for (int k=0; k < NumParts; k++)
+      {
+         if (sizes[k] > 0)
+            memcpy(mapped, *parts[k], sizes[k]);
+         mapped+=sizes[k];
+      }
+      if (!buffer->unmap())
+      {
+         glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+         return 0;
+      }
+      buffer->version=frameCache.version;
+   }
+   buffer->bind();
+
+   const char* offset=0;
+   for (int k=0; k < NumParts; k++)
+   {
+      *parts[k]=offset;
+      offset+=sizes[k];
+   }
+   return buffer;
+}
+
+/** Brings the context's trail buffer up to the locked snapshot and binds
+ *  it, setting points and positions to their offsets in it. Only the ring
+ *  slots written since the buffer's step are uploaded: per line the new
+ *  heads, twice each. The whole ring is uploaded when lines were added or
+ *  removed or the buffer is a full ring behind. Returns false, with points
+ *  and positions pointing into the snapshot, if the context has no buffer.
+ */
+bool DynamicSolverTool::bindTrails(DTS::DataItem* dataItem,
+      const GLvoid*& points, const GLvoid*& positions) const
+{
+   const Data::Snapshot& snapshot=data.snapshots.getLockedValue();
+   points=&snapshot.points[0];
+   positions=&snapshot.positions[0];
+
+   DTS::TrailBuffer* buffer=dataItem->dynamicSolverTrails;
+   if (buffer == 0)
+      return false;
+
+   typedef Data::DisplayPoint Point;
+   size_t pointsSize=snapshot.points.size() * sizeof(Point);
+   size_t positionsSize=snapshot.positions.size() * sizeof(GLfloat);
+   unsigned int history=snapshot.history;
+   size_t ringSize=2 * history;
+
+   buffer->bind();
+   if (buffer->layout != snapshot.layout || buffer->history != history
+         || snapshot.step - buffer->step >= history)
+   {
+      buffer->allocate(pointsSize + positionsSize);
+      buffer->write(0, pointsSize, &snapshot.points[0]);
+      buffer->write(pointsSize, positionsSize, &snapshot.positions[0]);
+      buffer->layout=snapshot.layout;
+      buffer->history=history;
+   }
+   else if (buffer->step != snapshot.step)
+   {
+      // The new steps wrote ring positions [begin, begin + count) modulo
+      // history, each at p and p + history: slots [begin, begin + count)
+      // and [begin + history, begin + history + count) modulo 2 * history.
+      size_t count=snapshot.step - buffer->step;
+      size_t begin=(snapshot.newest + 1 + history - count) % history;
+      size_t wrapped=begin + count > history ? begin + count - history : 0;
+
+      for (size_t i=0; i < snapshot.getNumLines(); i++)
+      {
+         size_t line=i * ringSize;
+         const Point* source=&snapshot.points[line];
+         buffer->write((line + begin) * sizeof(Point), count * sizeof(Point),
+               source + begin);
+         buffer->write((line + begin + history) * sizeof(Point),
+               (count - wrapped) * sizeof(Point), source + begin + history);
+         buffer->write(line * sizeof(Point), wrapped * sizeof(Point), source);
+      }
+   }
+   buffer->step=snapshot.step;
+
+   points=0;
+   positions=reinterpret_cast<const GLvoid*> (pointsSize);
+   return true;
+}
+
+/** Binds and enables the 1D color map texture and sets the texture matrix
+ *  so that the ring positions of the snapshot map to the gradient color of
+ *  their point: index 0 at the head, towards 255 at the tail.
+ */
+void DynamicSolverTool::bindGradientTexture(DTS::DataItem* dataItem,
+      const Data::Snapshot& snapshot) const
+{
+   glEnable(GL_TEXTURE_1D);
+   dataItem->bindGradientTexture(data.colorMap);
+   glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+   // the point at ring position p is j = history - 1 + first - p steps old
+   float history=snapshot.history;
+   float first=snapshot.newest + 1;
+   float scale=255.0f / (history * 256.0f);
+
+   glMatrixMode(GL_TEXTURE);
+   glPushMatrix();
+   glLoadIdentity();
+   glTranslatef((history - 1.0f + first) * scale + 0.5f / 256.0f, 0.0f, 0.0f);
+   glScalef(-scale, 1.0f, 1.0f);
+   glMatrixMode(GL_MODELVIEW);
+}
 
 void DynamicSolverTool::drawBasicLines(DTS::DataItem* dataItem) const
 {
+   const Data::Snapshot& snapshot=data.snapshots.getLockedValue();
+
+   GLsizei numLines=snapshot.getNumLines();
+   if (numLines == 0 || snapshot.history < 2)
+      return;
+
+   const GLvoid* points;
+   const GLvoid* positions;
+   bool buffered=bindTrails(dataItem, points, positions);
+
    // save the current attribute state
-   glPushAttrib(GL_LIGHTING_BIT);
+   glPushAttrib(GL_LIGHTING_BIT | GL_TEXTURE_BIT);
+   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
    glDisable(GL_LIGHTING);
 
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, points);
+
    if (data.colorStyle == DynamicSolverData::SOLID)
    {
       glColor3f(1.0, 0.0, 0.0);
-
-      // for all lines
-      for (unsigned int i=0; i < data.points.size(); i++)
-      {
-         glBegin(GL_LINES);
-         // for all points in line
-         for (unsigned int j=1; j < data.points[i].size(); j++)
-         {
-            experiment->transformer->transform(data.points[i][j-1], dataItem->tempDisplay);
-            glVertex3f(dataItem->tempDisplay[0], dataItem->tempDisplay[1], dataItem->tempDisplay[2]);
-            experiment->transformer->transform(data.points[i][j], dataItem->tempDisplay);
-            glVertex3f(dataItem->tempDisplay[0], dataItem->tempDisplay[1], dataItem->tempDisplay[2]);
-         }
-         glEnd();
-      }
    }
-
    else if (data.colorStyle == DynamicSolverData::GRADIENT)
    {
-      // for all lines
-      for (unsigned int i=0; i < data.points.size(); i++)
-      {
-         glBegin(GL_LINES);
-         // for all points in line
-         for (unsigned int j=1; j < data.points[i].size(); j++)
-         {
-            int index=(int) ((float) j / (float) data.points[i].size() * 255.0);
-            const float* color=data.colorMap->getColor(index);
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+      glTexCoordPointer(1, GL_FLOAT, 0, positions);
+      bindGradientTexture(dataItem, snapshot);
+   }
 
-            glColor3fv(color);
+   // all lines in one call
+   multiDrawArrays(GL_LINE_STRIP, &snapshot.firsts[0], &snapshot.counts[0], numLines);
 
-            experiment->transformer->transform(data.points[i][j-1], dataItem->tempDisplay);
-            glVertex3f(dataItem->tempDisplay[0], dataItem->tempDisplay[1], dataItem->tempDisplay[2]);
-            experiment->transformer->transform(data.points[i][j], dataItem->tempDisplay);
-            glVertex3f(dataItem->tempDisplay[0], dataItem->tempDisplay[1], dataItem->tempDisplay[2]);
+   if (data.colorStyle == DynamicSolverData::GRADIENT)
+   {
+      glMatrixMode(GL_TEXTURE);
+      glPopMatrix();
+      glMatrixMode(GL_MODELVIEW);
 
-         }
-         glEnd();
-      }
+      glBindTexture(GL_TEXTURE_1D, 0);
+      glDisable(GL_TEXTURE_1D);
    }
 
+   if (buffered)
+      glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
    // restore the previous attribute state
+   glPopClientAttrib();
    glPopAttrib();
 }
 
-void DynamicSolverTool::drawPolylines(DTS::DataItem* dataItem) const
+void DynamicSolverTool::drawPolylines(DTS::DataItem* dataItem,
+      const FramePointers& pointers) const
 {
+   const Data::Snapshot& snapshot=data.snapshots.getLockedValue();
+
    // allocate space for gle rendering
-   gleDouble pts[data.history_size][3];
-   float colors[data.history_size][3];
+   gleDouble pts[snapshot.history][3];
+   float colors[snapshot.history][3];
 
    // save the current attribute state
    glPushAttrib(GL_LIGHTING_BIT);
@@ -294,9 +640,9 @@ void DynamicSolverTool::drawPolylines(DTS::DataItem* dataItem) const
    {
       glDisable(GL_LIGHTING);
 
-      for (unsigned int i=0; i < data.history_size; i++)
+      for (unsigned int i=0; i < snapshot.history; i++)
       {
-         int index=(int) ((float) i / (float) data.history_size * 255.0);
+         int index=(int) ((float) i / (float) snapshot.history * 255.0);
          const float* color=data.colorMap->getColor(index);
 
          colors[i][0]=color[0];
@@ -306,22 +652,37 @@ void DynamicSolverTool::drawPolylines(DTS::DataItem* dataItem) const
 
    }
 
+   if (dataItem->tubeRenderer)
+   {
+      // all lines as shader tubes in one draw call
+      if (!frameCache.tubes.empty())
+      {
+         dataItem->tubeRenderer->draw(
+               static_cast<const DTS::TubeRenderer::Vertex*> (pointers.tubes),
+               frameCache.tubes.size(), data.point_radius,
+               frameCache.colorStyle == DynamicSolverData::SOLID);
+      }
+
+      glPopAttrib();
+      return;
+   }
+
    // for all lines
-   for (unsigned int i=0; i < data.points.size(); i++)
+   for (unsigned int i=0; i < snapshot.getNumLines(); i++)
    {
       // for all points in line
-      for (unsigned int j=0; j < data.history_size; j++)
+      for (unsigned int j=0; j < snapshot.history; j++)
       {
          // set up gle data
-         experiment->transformer->transform(data.points[i][j], dataItem->tempDisplay);
+         const Geometry::Point<float,3>& p=snapshot.getPoint(i, j);
 
-         pts[j][0] = dataItem->tempDisplay[0];
-         pts[j][1] = dataItem->tempDisplay[1];
-         pts[j][2] = dataItem->tempDisplay[2];
+         pts[j][0] = p[0];
+         pts[j][1] = p[1];
+         pts[j][2] = p[2];
       }
 
       // render line as a generalized cylinder
-      glePolyCylinder(data.history_size, // num points in polyline
+      glePolyCylinder(snapshot.history, // num points in polyline
       pts, // polyline vertices
       colors, // colors at polyline vertices
       data.point_radius); // radius of polycylinder
@@ -331,7 +692,8 @@ void DynamicSolverTool::drawPolylines(DTS::DataItem* dataItem) const
    glPopAttrib();
 }
 
-void DynamicSolverTool::drawPointHeads(DTS::DataItem* dataItem) const
+void DynamicSolverTool::drawPointHeads(DTS::DataItem* dataItem,
+      const FramePointers& pointers) const
 {
    // save current attribute state
    glPushAttrib(GL_LIGHTING_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_POINT_BIT);
@@ -403,13 +765,15 @@ void DynamicSolverTool::drawPointHeads(DTS::DataItem* dataItem) const
    glColor4f(1.0, 0.8, 0.0, 1.0);
 
    // render points
-   glBegin(GL_POINTS);
-   for (unsigned int i=0; i < data.points.size(); i++)
+   GLsizei numLines=frameCache.heads.size();
+   if (numLines > 0)
    {
-      experiment->transformer->transform(data.points[i][0], dataItem->tempDisplay);
-      glVertex3f(dataItem->tempDisplay[0], dataItem->tempDisplay[1], dataItem->tempDisplay[2]);
+      glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glVertexPointer(3, GL_FLOAT, 0, pointers.heads);
+      glDrawArrays(GL_POINTS, 0, numLines);
+      glPopClientAttrib();
    }
-   glEnd();
 
    if (dataItem->hasShaders)
    {
@@ -425,8 +789,21 @@ void DynamicSolverTool::drawPointHeads(DTS::DataItem* dataItem) const
    glPopAttrib();
 }
 
-void DynamicSolverTool::drawSphereHeads(DTS::DataItem* dataItem) const
+void DynamicSolverTool::drawSphereHeads(DTS::DataItem* dataItem,
+      const FramePointers& pointers) const
 {
+   // all heads as impostors in one draw call
+   if (dataItem->sphereRenderer)
+   {
+      if (!frameCache.spheres.empty())
+      {
+         dataItem->sphereRenderer->draw(
+               static_cast<const DTS::SphereRenderer::Vertex*> (pointers.spheres),
+               frameCache.spheres.size());
+      }
+      return;
+   }
+
    // save the current attribute state
    glPushAttrib(GL_LIGHTING_BIT);
    glEnable(GL_LIGHTING);
@@ -437,11 +814,11 @@ void DynamicSolverTool::drawSphereHeads(DTS::DataItem* dataItem) const
    glMaterial(GLMaterialEnums::FRONT_AND_BACK, material);
 
    // for all lines render the head as a sphere
-   for (unsigned int i=0; i < data.points.size(); i++)
+   for (unsigned int i=0; i < frameCache.heads.size(); i++)
    {
       glPushMatrix();
-      experiment->transformer->transform(data.points[i][0], dataItem->tempDisplay);
-      glTranslatef(dataItem->tempDisplay[0], dataItem->tempDisplay[1], dataItem->tempDisplay[2]);
+      const Geometry::Point<float,3>& head=frameCache.heads[i];
+      glTranslatef(head[0], head[1], head[2]);
       glDrawSphereIcosahedron(data.point_radius, 12);
       glPopMatrix();
    }
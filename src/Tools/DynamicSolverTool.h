@@ -26,6 +26,7 @@
 
 // Vrui includes
 //
+#include <Threads/TripleBuffer.h>
 #include <GL/GLModels.h>
 
 // External includes
@@ -35,8 +36,11 @@
 // Project includes
 //
 #include "DataItem.h"
+#include "ColorPoint.h"
+#include "CounterRng.h"
 #include "AbstractDynamicsTool.h"
 #include "Dynamics/Vector.h"
+#include "Dynamics/ParticleStateArena.h"
 
 #include "DynamicSolverOptionsDialog.h"
 
@@ -71,11 +75,62 @@ class DynamicSolverData
          SOLID, GRADIENT
       };
 
+      typedef Geometry::Point<float,3> DisplayPoint;
+
+      /// Projected lines, kept in a ring so a step only writes the new heads.
+      struct Trails
+      {
+         /// 2 * history display points per line. The head of step n is
+         /// stored at ring position n % history and again history places
+         /// further on, so the last history points of a line are always
+         /// contiguous, oldest first.
+         std::vector<DisplayPoint> points;
+         unsigned int history;
+         unsigned int newest; ///< Ring position of the heads.
+         unsigned long step; ///< Number of steps taken.
+         unsigned int layout; ///< Changed whenever lines are added or removed.
+
+         Trails() :
+            history(1), newest(0), step(0), layout(0)
+         {
+         }
+
+         size_t getNumLines() const
+         {
+            return points.size() / (2 * history);
+         }
+
+         /// Index of the oldest point of the line in points.
+         size_t getFirst(size_t line) const
+         {
+            return line * 2 * history + newest + 1;
+         }
+
+         /// Point index of the line, 0 being the head.
+         const DisplayPoint& getPoint(size_t line, unsigned int index) const
+         {
+            return points[line * 2 * history + newest + history - index];
+         }
+      };
+
+      /// Projected lines as of one simulation step, as seen by render().
+      struct Snapshot: public Trails
+      {
+         std::vector<GLfloat> positions; ///< Ring position of each point, for the gradient texture.
+         std::vector<GLint> firsts; ///< First point of each line, for glMultiDrawArrays.
+         std::vector<GLsizei> counts; ///< Points of each line, for glMultiDrawArrays.
+
+         void update(const Trails& trails);
+      };
+
    private:
-      typedef std::vector<DTS::Vector<double> > PointArray;
-      typedef std::vector<PointArray> MultiPointArray;
+      typedef DTS::ParticleStateArena<double> PointArray;
 
-      MultiPointArray points; ///< Actual point data.
+      /// State of the head of each line.
+      PointArray points;
+
+      /// Display points of the lines, written by step().
+      Trails trails;
 
       LineStyle lineStyle; ///< Style used in rendering tail.
       HeadStyle headStyle; ///< Style used in rendering head (particle).
@@ -87,17 +142,43 @@ class DynamicSolverData
 
       ColorMap* colorMap; ///< Color map for rendering color gradient.
 
+      Threads::TripleBuffer<Snapshot> snapshots; ///< Written by step(), read by render().
+
       DynamicSolverData() :
          lineStyle(POLYLINE), headStyle(POINT), colorStyle(SOLID),
                point_radius(0.25), history_size(50), cluster_size(1)
       {
          colorMap=new BlueRedColorMap;
+         trails.history=history_size;
+         trails.layout=1;
       }
 
       ~DynamicSolverData()
       {
          delete colorMap;
       }
+
+      /** Number of lines (particles with tails) currently stored.
+       */
+      size_t getNumLines() const
+      {
+         return points.size();
+      }
+
+      /** Adds a line with all points at the head's display position. */
+      void addLine(const DTS::Vector<double>& head, const DisplayPoint& display)
+      {
+         points.append(head);
+         trails.points.insert(trails.points.end(), 2 * trails.history, display);
+         trails.layout++;
+      }
+
+      void clearLines()
+      {
+         points.clear();
+         trails.points.clear();
+         trails.layout++;
+      }
 };
 
 /** Computes the paths for multiple particles and renders them dynamically
@@ -140,7 +221,7 @@ class DynamicSolverTool: public AbstractDynamicsTool, public GLObject
 
    public:
       DynamicSolverTool(ToolBox::ToolBox* toolBox, Viewer* app) :
-         AbstractDynamicsTool(toolBox, app), tempDisplay(3)
+         AbstractDynamicsTool(toolBox, app), tempDisplay(3), rng(4321)
       {
          icon(new Icon(this));
 
@@ -156,6 +237,7 @@ class DynamicSolverTool: public AbstractDynamicsTool, public GLObject
       void initContext(GLContextData& contextData) const;
       virtual void render(DTS::DataItem* dataItem) const;
       virtual void step();
+      virtual void lockSnapshot();
 
       virtual void setExperiment(DTSExperiment* e);
 
@@ -179,31 +261,35 @@ class DynamicSolverTool: public AbstractDynamicsTool, public GLObject
 
       void clearPoints()
       {
-         data.points.clear();
+         post(makeChange(this, &DynamicSolverTool::applyClearPoints));
          Vrui::requestUpdate();
       }
 
       void setLineStyle(DynamicSolverData::LineStyle style)
       {
          data.lineStyle=style;
+         frameCache.stale=true;
          Vrui::requestUpdate();
       }
 
       void setHeadStyle(DynamicSolverData::HeadStyle style)
       {
          data.headStyle=style;
+         frameCache.stale=true;
          Vrui::requestUpdate();
       }
 
       void setColorStyle(DynamicSolverData::ColorStyle style)
       {
          data.colorStyle=style;
+         frameCache.stale=true;
          Vrui::requestUpdate();
       }
 
       void setPointSize(float value)
       {
          data.point_radius=value;
+         frameCache.stale=true;
       }
 
       void setReleaseClusterSize(unsigned int value)
@@ -211,19 +297,63 @@ class DynamicSolverTool: public AbstractDynamicsTool, public GLObject
          data.cluster_size=value;
       }
    private:
+      /// Lines per parallel work item (results do not depend on it).
+      static const size_t StepGrainSize = 256;
+
       typedef DynamicSolverData Data;
       DynamicSolverData data;
 
       DTS::Vector<double> temp;
-      DTS::Vector<double> prev;
       DTS::Vector<double> tempDisplay;
 
+      /* Changes, applied by the simulation thread (see post()) */
+      void applyClearPoints();
+      void applyAddLines(Vrui::Point pos, unsigned int clusterSize);
+
+      DTS::CounterRng rng; ///< Spreads the heads of a cluster of lines.
+      DTS::StepEvents clusters; ///< Numbers the clusters added within a step.
+
+      /// Vertex data of the locked snapshot. Built once per frame by
+      /// lockSnapshot(), so the eyes and windows drawn by render() share it.
+      struct FrameCache
+      {
+         unsigned int version; ///< Taken from nextFrameVersion, unique over all tools.
+         bool stale; ///< A display setting changed since the last build.
+         Data::LineStyle lineStyle; ///< Settings the cache was built for.
+         Data::ColorStyle colorStyle;
+         DTS::TubeRenderer::VertexArray tubes; ///< All lines as shader tubes (POLYLINE only).
+         std::vector<Data::DisplayPoint> heads; ///< Head of each line.
+         DTS::SphereRenderer::VertexArray spheres; ///< Sphere impostors of the heads (SPHERE only).
+
+         FrameCache() :
+            version(0), stale(true), lineStyle(Data::NO_LINE), colorStyle(Data::SOLID)
+         {
+         }
+      };
+
+      /// Where the draw methods find the frame data: offsets into the
+      /// bound vertex buffer, or the arrays themselves.
+      struct FramePointers
+      {
+         const GLvoid* tubes;
+         const GLvoid* heads;
+         const GLvoid* spheres;
+      };
+
+      FrameCache frameCache;
+      static unsigned int nextFrameVersion;
+
       /* Internal methods */
+      void updateFrameCache();
+      DTS::StreamingBuffer* bindFrame(DTS::DataItem* dataItem, FramePointers& pointers) const;
+      bool bindTrails(DTS::DataItem* dataItem, const GLvoid*& points, const GLvoid*& positions) const;
+      void bindGradientTexture(DTS::DataItem* dataItem, const Data::Snapshot& snapshot) const;
+
       void drawBasicLines(DTS::DataItem* dataItem) const;
-      void drawPolylines(DTS::DataItem* dataItem) const;
+      void drawPolylines(DTS::DataItem* dataItem, const FramePointers& pointers) const;
 
-      void drawPointHeads(DTS::DataItem* dataItem) const;
-      void drawSphereHeads(DTS::DataItem* dataItem) const;
+      void drawPointHeads(DTS::DataItem* dataItem, const FramePointers& pointers) const;
+      void drawSphereHeads(DTS::DataItem* dataItem, const FramePointers& pointers) const;
 };
 
 #endif
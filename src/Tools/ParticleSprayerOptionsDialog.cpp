@@ -113,6 +113,12 @@ GLMotif::PopupWindow* ParticleSprayerOptionsDialog::createDialog()
 
    actionTogglesLayout->manageChild();
 
+   factory.setLayout(parameterDialog);
+
+   // upload the particles as 8-byte quantized positions and speeds
+   GLMotif::ToggleButton* compactVerticesToggle=factory.createCheckBox("CompactVerticesToggle", "Compact Vertices");
+   compactVerticesToggle->getValueChangedCallbacks().add(this, &ParticleSprayerOptionsDialog::compactVerticesToggleCallback);
+
    parameterDialog->manageChild();
 
    return parameterDialogPopup;
@@ -194,6 +200,12 @@ void ParticleSprayerOptionsDialog::actionTogglesCallback(GLMotif::ToggleButton::
          (*button)->setToggle(true);
 }
 
+void ParticleSprayerOptionsDialog::compactVerticesToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData)
+{
+   ParticleSprayerTool* pTool=static_cast<ParticleSprayerTool*> (tool);
+   pTool->setCompactVertices(cbData->set);
+}
+
 void ParticleSprayerOptionsDialog::buttonCallback(GLMotif::Button::SelectCallbackData* cbData)
 {
    std::string name = cbData->button->getName();
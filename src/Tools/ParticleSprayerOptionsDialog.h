@@ -49,6 +49,7 @@ class ParticleSprayerOptionsDialog: public CaveDialog
       void sliderCallback(GLMotif::Slider::ValueChangedCallbackData* cbData);
       void actionTogglesCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
       void buttonCallback(GLMotif::Button::SelectCallbackData* cbData);
+      void compactVerticesToggleCallback(GLMotif::ToggleButton::ValueChangedCallbackData* cbData);
 
       ToggleArray actionToggleButtons;
 
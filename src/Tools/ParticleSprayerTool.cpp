@@ -18,6 +18,9 @@
  along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
  *******************************************************************************/
 #include "ParticleSprayerTool.h"
+#include "FieldViewer.h"
+
+#include <cstring>
 
 // OpenGL includes
 //
@@ -101,8 +104,12 @@ void ParticleSprayerTool::initContext(GLContextData& contextData) const
 
 void ParticleSprayerTool::render(DTS::DataItem* dataItem) const
 {
+   // everything drawn comes from the snapshot of one step, as the
+   // simulation thread may be changing the tool's own data
+   const Data::Snapshot& snapshot=data.snapshots.getLockedValue();
+
    // draw all emitter objects
-   drawEmitters();
+   drawEmitters(dataItem, snapshot);
 
    // save current attribute state
    #ifdef MESA
@@ -131,19 +138,43 @@ void ParticleSprayerTool::render(DTS::DataItem* dataItem) const
    frustum.setFromGL();   
 
    #ifdef GHETTO
-   if (0)
+   bool shaders=false;
    #else
-   if (dataItem->hasShaders)
+   bool shaders=dataItem->hasShaders;
    #endif
+
+   // the speed shader colors the particles, or else colorParticles() does
+   bool speedShader=shaders && dataItem->speedProgramObject != 0;
+
+   bool compact=snapshot.compact;
+   GLsizei numParticles=compact ? snapshot.compactParticles.size() : snapshot.particles.size();
+
+   if (shaders)
    {
       /* Calculate the scaled point size for this frustum: */
       GLfloat scaledParticleRadius=frustum.getPixelSize() * particleRadius / frustum.getEyeScreenDistance();
 
       /* Enable the vertex/fragment shader: */
       glEnable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
-      glUseProgramObjectARB(dataItem->programObject);
-      glUniform1fARB(dataItem->scaledParticleRadiusLocation, scaledParticleRadius);
-      glUniform1iARB(dataItem->tex0Location, 0);
+      if (speedShader)
+      {
+         glUseProgramObjectARB(dataItem->speedProgramObject);
+         glUniform1fARB(dataItem->speedScaledParticleRadiusLocation, scaledParticleRadius);
+         glUniform1iARB(dataItem->speedTex0Location, 0);
+         glUniform1iARB(dataItem->speedColorMapLocation, 1);
+         glUniform1fARB(dataItem->speedScaleLocation, snapshot.getSpeedScale());
+
+         // the color map goes next to the sprite texture
+         glActiveTextureARB(GL_TEXTURE1_ARB);
+         dataItem->bindGradientTexture(&data.colorMap);
+         glActiveTextureARB(GL_TEXTURE0_ARB);
+      }
+      else
+      {
+         glUseProgramObjectARB(dataItem->programObject);
+         glUniform1fARB(dataItem->scaledParticleRadiusLocation, scaledParticleRadius);
+         glUniform1iARB(dataItem->tex0Location, 0);
+      }
    }
    else
    {
@@ -177,34 +208,119 @@ void ParticleSprayerTool::render(DTS::DataItem* dataItem) const
 
    }
 
-   glBindBufferARB(GL_ARRAY_BUFFER_ARB, dataItem->vertexBufferId);
    glEnableClientState(GL_VERTEX_ARRAY);
-   glEnableClientState(GL_COLOR_ARRAY);
 
-   if (dataItem->versionDS != data.currentVersion)
+   // the shader draws the vertices as published, colorParticles() writes
+   // ColorPoints
+   const void* vertices=0;
+   size_t vertexSize=sizeof(ColorPoint);
+   if (speedShader && compact)
+   {
+      vertexSize=sizeof(QuantizedPoint);
+      if (numParticles > 0)
+         vertices=&snapshot.compactParticles[0];
+   }
+   else if (speedShader)
    {
-      dataItem->numParticlesDS = data.particles.size();
-      glBufferDataARB(GL_ARRAY_BUFFER_ARB, dataItem->numParticlesDS * sizeof(PointParticle), &data.particles[0], GL_DYNAMIC_DRAW_ARB);
-      dataItem->versionDS = data.currentVersion;
+      vertexSize=sizeof(SpeedPoint);
+      if (numParticles > 0)
+         vertices=&snapshot.particles[0];
    }
 
-   glInterleavedArrays(GL_C4UB_V3F, sizeof(PointParticle), 0);
+   // quantized positions are scaled back by the modelview matrix
+   bool quantized=speedShader && compact;
+   if (quantized)
+   {
+      const float* offset=snapshot.quantizer.getOffset();
+      float scale=snapshot.quantizer.getScale();
+      glPushMatrix();
+      glTranslatef(offset[0], offset[1], offset[2]);
+      glScalef(scale, scale, scale);
+   }
 
+   DTS::StreamingBuffer* buffer=dataItem->particleSprayerBuffer;
+   if (buffer)
+   {
+      // If data has been modified, write it to the next buffer of the ring
+      if (buffer->version != snapshot.version)
+      {
+         size_t size=numParticles * vertexSize;
+         void* mapped=numParticles > 0 ? buffer->map(size) : 0;
+         if (mapped)
+         {
+            if (speedShader)
+               memcpy(mapped, vertices, size);
+            else
+               colorParticles(snapshot, static_cast<ColorPoint*> (mapped));
+
+            if (buffer->unmap())
+            {
+               buffer->count=numParticles;
+               buffer->version=snapshot.version;
+            }
+         }
+         else if (numParticles == 0)
+         {
+            buffer->count=0;
+            buffer->version=snapshot.version;
+         }
+      }
 
-   // Care needed if particle number has changed but we haven't updated buffer.
-   glDrawArrays(GL_POINTS, 0, dataItem->numParticlesDS);
+      buffer->bind();
+      if (quantized)
+         glVertexPointer(4, GL_SHORT, sizeof(QuantizedPoint), 0);
+      else if (speedShader)
+         glVertexPointer(4, GL_FLOAT, sizeof(SpeedPoint), 0);
+      else
+         glInterleavedArrays(GL_C4UB_V3F, sizeof(ColorPoint), 0);
+      glDrawArrays(GL_POINTS, 0, buffer->count);
+      buffer->fence();
+      glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+   }
+   else if (numParticles > 0)
+   {
+      if (quantized)
+      {
+         glVertexPointer(4, GL_SHORT, sizeof(QuantizedPoint), vertices);
+      }
+      else if (speedShader)
+      {
+         glVertexPointer(4, GL_FLOAT, sizeof(SpeedPoint), vertices);
+      }
+      else
+      {
+         // colored once per snapshot and context
+         std::vector<ColorPoint>& colored=dataItem->coloredSprayerParticles;
+         if (dataItem->coloredSprayerVersion != snapshot.version)
+         {
+            colored.resize(numParticles);
+            colorParticles(snapshot, &colored[0]);
+            dataItem->coloredSprayerVersion=snapshot.version;
+         }
+         glInterleavedArrays(GL_C4UB_V3F, sizeof(ColorPoint), &colored[0]);
+      }
+      glDrawArrays(GL_POINTS, 0, numParticles);
+   }
+
+   if (quantized)
+      glPopMatrix();
 
    glDisableClientState(GL_COLOR_ARRAY);
    glDisableClientState(GL_VERTEX_ARRAY);
 
-   #ifndef GHETTO
-   if (dataItem->hasShaders)
-   #endif
+   if (shaders)
    {
       glUseProgramObjectARB(0);
       glDisable(GL_VERTEX_PROGRAM_POINT_SIZE_ARB);
    }
 
+   if (speedShader)
+   {
+      glActiveTextureARB(GL_TEXTURE1_ARB);
+      glBindTexture(GL_TEXTURE_1D, 0);
+      glActiveTextureARB(GL_TEXTURE0_ARB);
+   }
+
    glBindTexture(GL_TEXTURE_2D, 0);
    glDisable(GL_TEXTURE_2D);
    glDisable(GL_POINT_SPRITE_ARB);
@@ -213,143 +329,263 @@ void ParticleSprayerTool::render(DTS::DataItem* dataItem) const
    glPopAttrib();
 }
 
-
-void ParticleSprayerTool::setExperiment(DTSExperiment* e)
-{
-   experiment = e;
-   clearParticles();
-   clearEmitters();
-   temp.setDimension( e->model->getDimension() );
-   old.setDimension( e->model->getDimension() );
-}
-
-void ParticleSprayerTool::step()
+/** Colors the particles of snapshot on the CPU, as the speed shader does.
+ *  Quantized particles are converted back to display coordinates.
+ */
+void ParticleSprayerTool::colorParticles(const Data::Snapshot& snapshot,
+      ColorPoint* vertices) const
 {
-   int dimension = experiment->model->getDimension();
+   float scale=snapshot.getSpeedScale();
+   size_t numParticles=snapshot.compact ? snapshot.compactParticles.size()
+         : snapshot.particles.size();
 
-   // iterator over all emitters and add particles to the simulation
-   for (Data::PointArray::iterator emit=data.emitters.begin(); emit
-         != data.emitters.end(); ++emit)
+   for (size_t i=0; i < numParticles; i++)
    {
-      int cluster_size=data.cluster_size;
-      float cluster_radius=data.cluster_radius;
+      // vertices may be mapped write-only: no reading back
+      ColorPoint& vertex=vertices[i];
+      float speed;
 
-      for (int i=0; i < cluster_size; i++)
+      if (snapshot.compact)
       {
-         float dx=cluster_radius * ((float) rand() / (float) RAND_MAX * 2.0 - 1.0);
-         float dy=cluster_radius * ((float) rand() / (float) RAND_MAX * 2.0 - 1.0);
-         float dz=cluster_radius * ((float) rand() / (float) RAND_MAX * 2.0 - 1.0);
+         const QuantizedPoint& particle=snapshot.compactParticles[i];
+         for (int j=0; j < 3; j++)
+            vertex.pos[j]=snapshot.quantizer.dequantize(particle.pos[j], j);
+         speed=particle.w;
+      }
+      else
+      {
+         const SpeedPoint& particle=snapshot.particles[i];
+         vertex.pos=particle.pos;
+         speed=particle.speed;
+      }
 
-         Geometry::Point<double,3> shift((*emit)[0] + dx, (*emit)[1] + dy, (*emit)[2] + dz);
-         data.addParticle(PointParticle(shift, data.lifetime));
+      int index=(int) (sqrt(speed * scale) * 255.0);
 
-         tempDisplay[0] = (*emit)[0] + dx;
-         tempDisplay[1] = (*emit)[1] + dy;
-         tempDisplay[2] = (*emit)[2] + dz;
-         experiment->transformer->invTransform(tempDisplay, temp);
-         data.states.push_back( temp );
+      if (index > 255)
+         index=255;
+      if (index < 0)
+         index=0;
 
-      }
-   }
+      const float* cv=data.colorMap.getColor(index);
 
-   // calculate color based on ratio of velocity to max. velocity
-   //const float max_vel = 0.6*0.6;
-   static float max_vel=0.0;
-   static double previous_time=Vrui::getApplicationTime();
+      vertex.color[0]=(unsigned char) (cv[0] * 255.0);
+      vertex.color[1]=(unsigned char) (cv[1] * 255.0);
+      vertex.color[2]=(unsigned char) (cv[2] * 255.0);
+      vertex.color[3]=255;
+   }
+}
 
-   double current_time=Vrui::getApplicationTime();
-   bool check_max=false;
-   float next_max=0.0;
 
-   // if more than 3 seconds have elapsed set flag to check velocities
-   if ((current_time - previous_time) > 3.0)
-   {
-      check_max=true;
-      previous_time=current_time;
-   }
+void ParticleSprayerTool::setExperiment(DTSExperiment* e)
+{
+   experiment = e;
+   applyClearParticles();
+   applyClearEmitters();
+   temp.setDimension( e->model->getDimension() );
 
-   check_max=true;
+   data.states.setDimension( e->model->getDimension() );
+   data.states.reserve( data.particles.capacity() );
+}
 
-   // iterate over all particles
+/** Advances and projects a range of sprayed particles.
+ *
+ * The projected particles and their speeds are written straight into the
+ * snapshot being published, in the vertex layout render() uploads, or
+ * for a compact snapshot into the array ParticleSprayerQuantizeTask reads.
+ * The largest speed of the range goes into maxSpeeds, to be reduced over
+ * the threads by step().
+ */
+class ParticleSprayerStepTask: public ThreadPool::Task
+{
+   public:
+      ParticleSprayerStepTask(ThreadPool& pool, DTSExperiment& experiment,
+            ParticleSprayerData& data, ParticleSprayerData::VertexArray& vertices,
+            std::vector<double>& next, std::vector<float>& speeds,
+            std::vector<float>& maxSpeeds) :
+         pool(pool), experiment(experiment), data(data), vertices(vertices), next(next),
+         speeds(speeds), maxSpeeds(maxSpeeds)
+      {
+      }
 
-   int i = 0;
-   Data::ParticleArray::iterator particle=data.particles.begin();
-   while ( particle != data.particles.end() )
-   {
-      // if particle has expired delete it
-      if ((*particle).frame > (*particle).lifetime)
+      void run(size_t begin, size_t end, unsigned int thread)
       {
-         // if the particle is the last one in the array do simple pop
-         if (particle == (data.particles.end() - 1))
+         ThreadPool::Scratch& scratch = pool.getScratch(thread);
+         ParameterClass<double>::Pin transformerPin(*experiment.transformer);
+         DTS::ParticleStateArena<double>& states = data.states;
+         int dimension = states.getDimension();
+         size_t stride = states.getStride();
+         scratch.state.setDimension(dimension);
+
+         experiment.integrator->stepBatch(states.getData() + begin, &next[begin],
+               end - begin, stride, scratch.integrator);
+
+         // compute the (squared) speed of each particle, then store new state
+         for (size_t i=begin; i < end; i++)
+            speeds[i] = 0.0;
+         for (int j=0; j < dimension; j++)
          {
-            data.particles.pop_back();
-            data.states.pop_back();
-            break;
+            double* state = states.getComponent(j);
+            const double* nextState = &next[j * stride];
+            for (size_t i=begin; i < end; i++)
+            {
+               double delta = nextState[i] - state[i];
+               speeds[i] += delta * delta;
+               state[i] = nextState[i];
+            }
          }
-         // otherwise swap particle with end of array and then pop
-         else
-         {
-            (*particle)=*(data.particles.end() - 1);
-            data.particles.pop_back();
 
-            data.states[i] = data.states[ data.states.size() - 1 ];
-            data.states.pop_back();
+         // update particles from the new states
+         float maxSpeed = maxSpeeds[thread];
+         for (size_t i=begin; i < end; i++)
+         {
+            PointParticle& particle = data.particles[i];
+            SpeedPoint& vertex = vertices[i];
+            float speed = speeds[i];
+
+            states.getState(i, scratch.state);
+            experiment.transformer->transform(scratch.state, scratch.display);
+            // implicit cast from double to float
+            vertex.pos[0] = scratch.display[0];
+            vertex.pos[1] = scratch.display[1];
+            vertex.pos[2] = scratch.display[2];
+
+            // the color is looked up at render time
+            vertex.speed = speed;
+            maxSpeed=(speed > maxSpeed ? speed : maxSpeed);
+
+            // increment frame count
+            particle.frame++;
          }
+         maxSpeeds[thread] = maxSpeed;
       }
 
-      // save previous position of particle
-      old = data.states[i];
-
-      // compute new position and update particle
-      experiment->integrator->step(data.states[i], temp);
-      data.states[i] += temp;
-
-      experiment->transformer->transform(data.states[i], tempDisplay);
-      // implicit cast from double to float
-      (*particle).pos[0] = tempDisplay[0];
-      (*particle).pos[1] = tempDisplay[1];
-      (*particle).pos[2] = tempDisplay[2];
-
-      // compute the (squared) speed of the particle
-      float speed = 0.0;
-      for (int j = 0; j < dimension; j++)
+   private:
+      ThreadPool& pool;
+      DTSExperiment& experiment;
+      ParticleSprayerData& data;
+      ParticleSprayerData::VertexArray& vertices;
+      std::vector<double>& next;
+      std::vector<float>& speeds;
+      std::vector<float>& maxSpeeds;
+};
+
+/** Quantizes a range of sprayed particles into a compact snapshot, with
+ *  their speeds relative to the largest speed of the step.
+ */
+class ParticleSprayerQuantizeTask: public ThreadPool::Task
+{
+   public:
+      ParticleSprayerQuantizeTask(const ParticleSprayerData::VertexArray& vertices,
+            ParticleSprayerData::Snapshot& snapshot) :
+         vertices(vertices), snapshot(snapshot)
       {
-         speed += (data.states[i][j] - old[j]) * (data.states[i][j] - old[j]);
       }
 
-      if (check_max)
+      void run(size_t begin, size_t end, unsigned int thread)
       {
-         next_max=(speed > next_max ? speed : next_max);
-      }
+         const DTS::Quantizer& quantizer = snapshot.quantizer;
+         ParticleSprayerData::CompactVertexArray& compact = snapshot.compactParticles;
+         const float range = DTS::Quantizer::Range;
+         float scale = snapshot.maxSpeed > 0.0f ? range / snapshot.maxSpeed : 0.0f;
 
-      int index=(int) (sqrt(speed) / sqrt(max_vel) * 255.0);
+         for (size_t i=begin; i < end; i++)
+         {
+            for (int j=0; j < 3; j++)
+               compact[i].pos[j] = quantizer.quantize(vertices[i].pos[j], j);
 
-      if (index > 255)
-         index=255;
-      if (index < 0)
-         index=0;
+            // also catches NaN
+            float speed = vertices[i].speed * scale;
+            compact[i].w = GLshort(speed < range ? speed + 0.5f : range);
+         }
+      }
 
-      const float* cv=data.colorMap.getColor(index);
+   private:
+      const ParticleSprayerData::VertexArray& vertices;
+      ParticleSprayerData::Snapshot& snapshot;
+};
 
-      // update particle color
-      (*particle).color[0]=(unsigned char) (cv[0] * 255.0);
-      (*particle).color[1]=(unsigned char) (cv[1] * 255.0);
-      (*particle).color[2]=(unsigned char) (cv[2] * 255.0);
+void ParticleSprayerTool::step()
+{
+   int dimension = experiment->model->getDimension();
 
-      // increment frame count
-      (*particle).frame++;
+   // iterator over all emitters and add particles to the simulation
+   for (Data::PointArray::iterator emit=data.emitters.begin(); emit
+         != data.emitters.end(); ++emit)
+   {
+      emitCluster(*emit);
+   }
 
+   // remove expired particles by swapping them with the end of the array
+   size_t i = 0;
+   while (i < data.particles.size())
+   {
+      if (data.particles[i].frame > data.particles[i].lifetime)
+      {
+         data.particles[i] = data.particles.back();
+         data.particles.pop_back();
+         data.states.swapRemove(i);
+      }
+      else
+      {
+         ++i;
+      }
+   }
 
-      // Next loop
-      ++particle;
-      ++i;
+   // advance all particles, split over the worker threads
+   ThreadPool* pool = application->getThreadPool();
+   size_t stride = data.states.getStride();
+   batch.resize(dimension * stride);
+   speeds.resize(data.states.size());
+   threadMaxSpeeds.assign(pool->getNumThreads(), 0.0f);
+
+   // the particles are written into the snapshot for render(), or
+   // quantized into it once the largest speed is known
+   Data::Snapshot& snapshot=data.snapshots.startNewValue();
+   snapshot.compact=data.compactVertices;
+   Data::VertexArray& vertices=snapshot.compact ? unquantized : snapshot.particles;
+   vertices.resize(data.states.size());
+
+   ParticleSprayerStepTask task(*pool, *experiment, data, vertices,
+         batch, speeds, threadMaxSpeeds);
+   pool->parallelFor(data.states.size(), StepGrainSize, task);
+
+   // the colors are relative to the largest speed of this step
+   data.maxSpeed=0.0f;
+   for (size_t t=0; t < threadMaxSpeeds.size(); t++)
+   {
+      data.maxSpeed=(threadMaxSpeeds[t] > data.maxSpeed ? threadMaxSpeeds[t] : data.maxSpeed);
    }
 
-   if (check_max)
-      max_vel=next_max;
+   snapshot.maxSpeed=data.maxSpeed;
+   if (snapshot.compact)
+   {
+      snapshot.particles.clear();
+      snapshot.compactParticles.resize(data.states.size());
 
-   // update data version (now out of sync)
+      // quantize within twice the radius of the attractor
+      ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+      DTS::Vector<double> center=experiment->transformer->getCenterPoint();
+      double box[3]= { center[0], center[1], center[2] };
+      snapshot.quantizer.setBox(box, 2.0 * experiment->transformer->getRadius());
+
+      ParticleSprayerQuantizeTask quantize(unquantized, snapshot);
+      pool->parallelFor(data.states.size(), StepGrainSize, quantize);
+   }
+   else
+      snapshot.compactParticles.clear();
+
+   // update data version (now out of sync) and hand the particles to render()
    data.currentVersion++;
+   snapshot.version=data.currentVersion;
+   snapshot.emitters=data.emitters;
+   snapshot.selectedEmitter=data.selectedEmitter;
+   snapshot.hoveringEmitter=data.hoveringEmitter;
+   data.snapshots.postNewValue();
+}
+
+void ParticleSprayerTool::lockSnapshot()
+{
+   data.snapshots.lockNewValue();
 }
 
 void ParticleSprayerTool::moved(const ToolBox::MotionEvent & motionEvent)
@@ -362,43 +598,97 @@ void ParticleSprayerTool::moved(const ToolBox::MotionEvent & motionEvent)
    // get current locator position
    pos=toolBox()->deviceTransformationInModel().getOrigin();
 
-   // if spraying particles
-   if (data.action == ParticleSprayerData::SPRAY_PARTICLES and active)
+   // spraying, moving an emitter and hovering over one happen between steps
+   if (active or data.action == ParticleSprayerData::MOVE_EMITTER or data.action
+         == ParticleSprayerData::DELETE_EMITTER)
+      post(makeChange(this, &ParticleSprayerTool::applyMotion, pos, data.action, active));
+}
+
+void ParticleSprayerTool::mainButtonPressed(const ToolBox::ButtonPressEvent & motionEvent)
+{
+   if (experiment == NULL || locked)
    {
-      int cluster_size=data.cluster_size; // number of particles to emit
-      float cluster_radius=data.cluster_radius; // amount of "spread"
+      return;
+   }
 
-      DTS::Vector<double> invPos( experiment->model->getDimension() );
 
-      // add particles to the simulation
-      for (int i=0; i < cluster_size; i++)
-      {
-         float dx = cluster_radius * ((float) rand() / (float) RAND_MAX * 2.0 - 1.0);
-         float dy = cluster_radius * ((float) rand() / (float) RAND_MAX * 2.0 - 1.0);
-         float dz = cluster_radius * ((float) rand() / (float) RAND_MAX * 2.0 - 1.0);
+   // get current locator position
+   pos=toolBox()->deviceTransformationInModel().getOrigin();
 
-         Geometry::Point<double,3> shift(pos[0] + dx, pos[1] + dy, pos[2] + dz);
-         data.addParticle(PointParticle(shift, data.lifetime));
+   post(makeChange(this, &ParticleSprayerTool::applyPress, pos, data.action));
 
-         tempDisplay[0] = pos[0] + dx;
-         tempDisplay[1] = pos[1] + dy;
-         tempDisplay[2] = pos[2] + dz;
+   active=true;
+}
 
-         experiment->transformer->invTransform(tempDisplay, invPos);
-         data.states.push_back( invPos );
-      }
+void ParticleSprayerTool::mainButtonReleased(const ToolBox::ButtonReleaseEvent & buttonReleaseEvent)
+{
+   if (experiment == NULL || locked)
+   {
+      return;
+   }
+
+   post(makeChange(this, &ParticleSprayerTool::applyDeselect));
+   active=false;
+}
+
+//
+// ParticleSprayerTool changes
+//
+
+void ParticleSprayerTool::applyClearParticles()
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.particles.clear();
+   data.states.clear();
+   data.currentVersion++;
+}
+
+void ParticleSprayerTool::applyClearEmitters()
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.emitters.clear();
+   data.selectedEmitter=-1;
+   data.hoveringEmitter=-1;
+}
+
+void ParticleSprayerTool::applyLifetime(unsigned int lt)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.lifetime=lt;
+}
+
+void ParticleSprayerTool::applyEmitterSpread(float value)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.cluster_radius=value;
+}
+
+/** Handles a motion of the locator to pos, with the action and the state
+ *  of the button at the time of the event.
+ */
+void ParticleSprayerTool::applyMotion(Vrui::Point pos,
+      ParticleSprayerData::Action action, bool pressed)
+{
+   Threads::Mutex::Lock stepLock(stepMutex);
+
+   // if spraying particles
+   if (action == ParticleSprayerData::SPRAY_PARTICLES and pressed)
+   {
+      // add particles to the simulation
+      emitCluster(pos);
    }
 
    // if moving an emitter
-   else if (data.action == ParticleSprayerData::MOVE_EMITTER and active)
+   else if (action == ParticleSprayerData::MOVE_EMITTER and pressed)
    {
       // move the selected emitter to current locator position
-      *data.selectedEmitter=pos;
+      if (data.selectedEmitter >= 0)
+         data.emitters[data.selectedEmitter]=pos;
    }
 
    // finally, check if hovering over (within) an emitter
-   else if ((data.action == ParticleSprayerData::MOVE_EMITTER or data.action
-         == ParticleSprayerData::DELETE_EMITTER) and !active)
+   else if ((action == ParticleSprayerData::MOVE_EMITTER or action
+         == ParticleSprayerData::DELETE_EMITTER) and !pressed)
    {
       // for each emitter compute the distance from the locator
       for (Data::PointArray::iterator emit=data.emitters.begin(); emit
@@ -413,31 +703,25 @@ void ParticleSprayerTool::moved(const ToolBox::MotionEvent & motionEvent)
          // if locator lies within emitter set hovering emitter and return
          if (distance < data.emitter_radius)
          {
-            data.hoveringEmitter=&*emit;
+            data.hoveringEmitter=emit - data.emitters.begin();
             return;
          }
       }
 
-      // if not hovering inside emitter set to null
-      data.hoveringEmitter=NULL;
+      // if not hovering inside emitter set to none
+      data.hoveringEmitter=-1;
    }
 }
 
-void ParticleSprayerTool::mainButtonPressed(const ToolBox::ButtonPressEvent & motionEvent)
+/** Handles a press of the button with the locator at pos. */
+void ParticleSprayerTool::applyPress(Vrui::Point pos, ParticleSprayerData::Action action)
 {
-   if (experiment == NULL || locked)
-   {
-      return;
-   }
-
+   Threads::Mutex::Lock stepLock(stepMutex);
 
-   // get current locator position
-   pos=toolBox()->deviceTransformationInModel().getOrigin();
-
-   if (data.action == ParticleSprayerData::CREATE_EMITTER)
+   if (action == ParticleSprayerData::CREATE_EMITTER)
       data.addEmitter(pos);
 
-   else if (data.action == ParticleSprayerData::MOVE_EMITTER)
+   else if (action == ParticleSprayerData::MOVE_EMITTER)
    {
       // for each emitter compute the distance from the locator
       for (Data::PointArray::iterator emit=data.emitters.begin(); emit
@@ -452,13 +736,13 @@ void ParticleSprayerTool::mainButtonPressed(const ToolBox::ButtonPressEvent & mo
          // if locator lies within emitter set selected emitter and break
          if (distance < data.emitter_radius)
          {
-            data.selectedEmitter=&*emit;
+            data.selectedEmitter=emit - data.emitters.begin();
             break;
          }
       }
    }
 
-   else if (data.action == ParticleSprayerData::DELETE_EMITTER)
+   else if (action == ParticleSprayerData::DELETE_EMITTER)
    {
       // for each emitter compute the distance from the locator
       for (Data::PointArray::iterator emit=data.emitters.begin(); emit
@@ -474,31 +758,88 @@ void ParticleSprayerTool::mainButtonPressed(const ToolBox::ButtonPressEvent & mo
          if (distance < data.emitter_radius)
          {
             data.emitters.erase(emit);
+            data.hoveringEmitter=-1;
             return;
          }
       }
    }
-
-   active=true;
 }
 
-void ParticleSprayerTool::mainButtonReleased(const ToolBox::ButtonReleaseEvent & buttonReleaseEvent)
+void ParticleSprayerTool::applyDeselect()
 {
-   if (experiment == NULL || locked)
-   {
-      return;
-   }
-
-   data.selectedEmitter=NULL;
-   active=false;
+   Threads::Mutex::Lock stepLock(stepMutex);
+   data.selectedEmitter=-1;
 }
 
 //
 // ParticleSprayerTool internal methods
 //
 
-void ParticleSprayerTool::drawEmitters() const
+/** Adds a cluster of particles spread around center. Each emission draws
+ *  new numbers from the counter (particle, step, 0, emission), where
+ *  emission numbers the emissions within the step, so the same emissions
+ *  at the same steps always spray the same particles, on every node. Called on the simulation
+ *  thread, by step() and applyMotion().
+ */
+void ParticleSprayerTool::emitCluster(const Vrui::Point& center)
+{
+   // keep the transformer parameters alive during invTransform
+   ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+   unsigned int step=application->getSimulationStep();
+   unsigned int emission=emissions.next(step);
+   float cluster_radius=data.cluster_radius; // amount of "spread"
+
+   for (int i=0; i < data.cluster_size; i++)
+   {
+      double u[4];
+      rng.uniform(i, step, 0, emission, u);
+
+      for (int j=0; j < 3; j++)
+         tempDisplay[j] = center[j] + cluster_radius * (u[j] * 2.0 - 1.0);
+
+      Geometry::Point<double,3> shift(tempDisplay[0], tempDisplay[1], tempDisplay[2]);
+      data.addParticle(PointParticle(shift, data.lifetime));
+
+      experiment->transformer->invTransform(tempDisplay, temp);
+      data.states.append( temp );
+   }
+}
+
+void ParticleSprayerTool::drawEmitters(DTS::DataItem* dataItem,
+      const Data::Snapshot& snapshot) const
 {
+   const Data::PointArray& emitters=snapshot.emitters;
+
+   // the selected emitter, or else the hovering one, is highlighted
+   int highlighted=snapshot.selectedEmitter;
+   int highlight=1;
+   if (highlighted < 0)
+   {
+      highlighted=snapshot.hoveringEmitter;
+      highlight=2;
+   }
+   if (highlighted >= (int) emitters.size())
+      highlighted=-1;
+
+   if (dataItem->sphereRenderer)
+   {
+      typedef DTS::SphereRenderer::Color Color;
+
+      // all emitters as impostors in one draw call
+      DTS::SphereRenderer::VertexArray spheres;
+      for (size_t i=0; i < emitters.size(); i++)
+      {
+         DTS::SphereRenderer::Point center(emitters[i][0], emitters[i][1], emitters[i][2]);
+         DTS::SphereRenderer::appendSphere(spheres, center, data.emitter_radius,
+               Color(0, 128, 255, 255), (int) i == highlighted ? highlight : 0);
+      }
+
+      Color highlightColors[DTS::SphereRenderer::NumHighlights]= {
+            Color(255, 0, 0, 255), Color(255, 128, 0, 255) };
+      dataItem->sphereRenderer->draw(spheres, highlightColors);
+      return;
+   }
+
    GLMaterial basicEmitterMaterial(GLMaterial::Color(0.0, 0.5, 1.0, 1.0), GLMaterial::Color(1.0, 1.0, 1.0, 1.0), 80.0);
 
    GLMaterial selectedEmitterMaterial(GLMaterial::Color(1.0, 0.0, 0.0, 1.0), GLMaterial::Color(1.0, 1.0, 1.0, 1.0), 80.0);
@@ -508,8 +849,8 @@ void ParticleSprayerTool::drawEmitters() const
    glMaterial(GLMaterialEnums::FRONT_AND_BACK, basicEmitterMaterial);
 
    // draw all emitters
-   for (Data::PointArray::const_iterator emit=data.emitters.begin(); emit
-         != data.emitters.end(); ++emit)
+   for (Data::PointArray::const_iterator emit=emitters.begin(); emit
+         != emitters.end(); ++emit)
    {
       Vrui::Point pos=(*emit);
 
@@ -519,30 +860,18 @@ void ParticleSprayerTool::drawEmitters() const
       glPopMatrix();
    }
 
-   // draw selected emitter if assigned
-   if (data.selectedEmitter != NULL)
+   // draw the selected or else the hovering emitter if assigned
+   if (highlighted >= 0)
    {
-      glMaterial(GLMaterialEnums::FRONT_AND_BACK, selectedEmitterMaterial);
+      if (highlight == 1)
+         glMaterial(GLMaterialEnums::FRONT_AND_BACK, selectedEmitterMaterial);
+      else
+         glMaterial(GLMaterialEnums::FRONT_AND_BACK, hoveringEmitterMaterial);
 
-      Vrui::Point pos=*(data.selectedEmitter);
-      glPushMatrix();
-      glTranslatef(pos[0], pos[1], pos[2]);
-      glDrawSphereIcosahedron(data.emitter_radius, 12);
-      glPopMatrix();
-   }
-   // otherwise draw hovering emitter if assigned
-   else if (data.hoveringEmitter != NULL)
-   {
-      glMaterial(GLMaterialEnums::FRONT_AND_BACK, hoveringEmitterMaterial);
-
-      Vrui::Point pos=*(data.hoveringEmitter);
+      Vrui::Point pos=emitters[highlighted];
       glPushMatrix();
       glTranslatef(pos[0], pos[1], pos[2]);
       glDrawSphereIcosahedron(data.emitter_radius, 12);
       glPopMatrix();
    }
 }
-
-
-
-
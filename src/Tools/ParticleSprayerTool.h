@@ -28,6 +28,7 @@
 // Vrui includes
 //
 #include <Vrui/Vrui>
+#include <Threads/TripleBuffer.h>
 #include <GL/GLFrustum.h>
 #include <GL/GLModels.h>
 #include <GL/GLMaterial.h>
@@ -39,9 +40,15 @@
 // Project includes
 //
 #include "DataItem.h"
+#include "ColorPoint.h"
+#include "SpeedPoint.h"
+#include "QuantizedPoint.h"
+#include "Quantizer.h"
+#include "CounterRng.h"
 #include "PointParticle.h"
 #include "AbstractDynamicsTool.h"
 #include "Dynamics/Vector.h"
+#include "Dynamics/ParticleStateArena.h"
 
 #include "ParticleSprayerOptionsDialog.h"
 
@@ -57,10 +64,14 @@ class ParticleSprayerTool;
 class ParticleSprayerData
 {
       friend class ParticleSprayerTool;
+      friend class ParticleSprayerStepTask;
+      friend class ParticleSprayerQuantizeTask;
 
       typedef std::vector<PointParticle> ParticleArray;
+      typedef std::vector<SpeedPoint> VertexArray;
+      typedef std::vector<QuantizedPoint> CompactVertexArray;
       typedef std::vector<Vrui::Point> PointArray;
-      typedef std::vector<DTS::Vector<double> > StateArray;
+      typedef DTS::ParticleStateArena<double> StateArray;
 
    public:
       /// Various sprayer actions.
@@ -69,6 +80,34 @@ class ParticleSprayerData
          SPRAY_PARTICLES, CREATE_EMITTER, MOVE_EMITTER, DELETE_EMITTER
       };
 
+      /// Particles as of one simulation step, as seen by render().
+      struct Snapshot
+      {
+         bool compact; ///< Whether compactParticles replaces particles.
+         VertexArray particles; ///< Written by the step tasks, uploaded as is.
+         CompactVertexArray compactParticles; ///< Same, quantized by quantizer, with the speed in w.
+         DTS::Quantizer quantizer;
+         float maxSpeed; ///< Largest (squared) speed among the particles.
+         unsigned int version; ///< Value of currentVersion when published.
+         PointArray emitters; ///< Emitters as of the step.
+         int selectedEmitter; ///< Index into emitters, or -1.
+         int hoveringEmitter; ///< Index into emitters, or -1.
+
+         Snapshot() :
+            compact(false), maxSpeed(0.0f), version(0), selectedEmitter(-1),
+                  hoveringEmitter(-1)
+         {
+         }
+
+         /** Returns the factor taking the speeds as stored to [0, 1]. */
+         float getSpeedScale() const
+         {
+            if (!(maxSpeed > 0.0f))
+               return 0.0f;
+            return compact ? 1.0f / DTS::Quantizer::Range : 1.0f / maxSpeed;
+         }
+      };
+
    private:
       ParticleArray particles; ///< Point particles.
       PointArray emitters; ///< Location of particle emitters.
@@ -76,23 +115,27 @@ class ParticleSprayerData
 
       Action action; ///< Current sprayer action (mode).
 
-      Vrui::Point* selectedEmitter;
-      Vrui::Point* hoveringEmitter;
+      int selectedEmitter; ///< Index into emitters, or -1.
+      int hoveringEmitter; ///< Index into emitters, or -1.
 
       int cluster_size; ///< Number of particles to emit.
       float cluster_radius; ///< Spread of particles emitted.
       unsigned int lifetime; ///< Lifetime of particles.
       float emitter_radius; ///< Size of spheres representing emitters.
       float point_radius; ///< Size of the particles.
+      bool compactVertices; ///< Publish the particles quantized.
 
       unsigned int currentVersion; ///< For syncing VOB rendering.
+      Threads::TripleBuffer<Snapshot> snapshots; ///< Written by step(), read by render().
 
       BlueRedColorMap colorMap; ///< Color map for coloring by velocity.
+      float maxSpeed; ///< Largest (squared) speed of the last step.
 
       ParticleSprayerData() :
-         action(SPRAY_PARTICLES), selectedEmitter(NULL), hoveringEmitter(NULL),
+         action(SPRAY_PARTICLES), selectedEmitter(-1), hoveringEmitter(-1),
          cluster_size(15), cluster_radius(0.5), lifetime(750),
-         emitter_radius(0.1), point_radius(0.05), currentVersion(0)
+         emitter_radius(0.1), point_radius(0.05), compactVertices(false),
+         currentVersion(0), maxSpeed(0.0f)
 
       {
          particles.reserve(200000);
@@ -165,7 +208,8 @@ class ParticleSprayerTool: public AbstractDynamicsTool, public GLObject
       /* Interface */
 
       ParticleSprayerTool(ToolBox::ToolBox* toolBox, Viewer* app) :
-         AbstractDynamicsTool(toolBox, app), active(false), tempDisplay(3)
+         AbstractDynamicsTool(toolBox, app), active(false), rng(10000),
+               tempDisplay(3)
       {
          icon(new Icon(this));
 
@@ -181,6 +225,7 @@ class ParticleSprayerTool: public AbstractDynamicsTool, public GLObject
       void initContext(GLContextData& contextData) const;
       virtual void render(DTS::DataItem* dataItem) const;
       virtual void step();
+      virtual void lockSnapshot();
 
       virtual void setExperiment(DTSExperiment* e);
 
@@ -213,30 +258,28 @@ class ParticleSprayerTool: public AbstractDynamicsTool, public GLObject
        */
       void clearParticles()
       {
-         data.particles.clear();
-         data.states.clear();
-         data.currentVersion++;
+         post(makeChange(this, &ParticleSprayerTool::applyClearParticles));
       }
 
       /** Delete all emitter objects.
        */
       void clearEmitters()
       {
-         data.emitters.clear();
+         post(makeChange(this, &ParticleSprayerTool::applyClearEmitters));
       }
 
       /** Set the particle lifetime (length of particle stream)
        */
       void setLifetime(unsigned int lt)
       {
-         data.lifetime=lt;
+         post(makeChange(this, &ParticleSprayerTool::applyLifetime, lt));
       }
 
       /** Set distance between emitted particles.
        */
       void setEmitterSpread(float value)
       {
-         data.cluster_radius=value;
+         post(makeChange(this, &ParticleSprayerTool::applyEmitterSpread, value));
       }
 
       void setPointSize(float value)
@@ -244,19 +287,52 @@ class ParticleSprayerTool: public AbstractDynamicsTool, public GLObject
          data.point_radius=value;
       }
 
+      /** Publishes the particles as 8-byte quantized positions and speeds
+       *  instead of 16-byte SpeedPoints, which halves the data uploaded per
+       *  step. The positions are quantized within twice the transformer's
+       *  radius around its center point; particles beyond are drawn on the
+       *  faces of that cube. Takes effect with the next step.
+       */
+      void setCompactVertices(bool enabled)
+      {
+         Threads::Mutex::Lock stepLock(stepMutex);
+         data.compactVertices=enabled;
+      }
+
    private:
       typedef ParticleSprayerData Data;
 
       bool active;
       ParticleSprayerData data;
 
+      DTS::CounterRng rng; ///< Spreads the emitted particles.
+      DTS::StepEvents emissions; ///< Numbers the clusters emitted within a step.
+
       DTS::Vector<double> tempDisplay;
       DTS::Vector<double> temp;
-      DTS::Vector<double> old; // prev position of particle
 
+      /// Particles per parallel work item (results do not depend on it).
+      static const size_t StepGrainSize = 1024;
+
+      // Advanced states from Integrator::stepBatch, same layout as data.states
+      std::vector<double> batch;
+      std::vector<float> speeds; ///< Squared speed of each particle.
+      std::vector<float> threadMaxSpeeds; ///< Largest squared speed per thread.
+      Data::VertexArray unquantized; ///< Particles of a compact step, before quantizing.
+
+      /* Changes, applied by the simulation thread (see post()) */
+      void applyClearParticles();
+      void applyClearEmitters();
+      void applyLifetime(unsigned int lt);
+      void applyEmitterSpread(float value);
+      void applyMotion(Vrui::Point pos, ParticleSprayerData::Action action, bool pressed);
+      void applyPress(Vrui::Point pos, ParticleSprayerData::Action action);
+      void applyDeselect();
 
       /* Internal methods */
-      void drawEmitters() const;
+      void emitCluster(const Vrui::Point& center);
+      void colorParticles(const Data::Snapshot& snapshot, ColorPoint* vertices) const;
+      void drawEmitters(DTS::DataItem* dataItem, const Data::Snapshot& snapshot) const;
 };
 
 #endif
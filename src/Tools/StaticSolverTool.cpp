@@ -20,6 +20,7 @@
 #include "StaticSolverTool.h"
 
 // STL includes
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
@@ -39,6 +40,7 @@
 //
 
 const unsigned int StaticSolverData::MaxPoints=20000;
+unsigned int StaticSolverData::nextId=0;
 
 //
 // StaticSolverTool::Icon methods
@@ -131,14 +133,20 @@ void StaticSolverTool::initContext(GLContextData& contextData) const
 
 void StaticSolverTool::render(DTS::DataItem* dataItem) const
 {
-   if(dataItem->dataDisplayListVersion != dataDisplayListVersion)
+   // without shaders the tubes are built by GLE, into the display list
+   if (lineStyle == StaticSolverData::POLY_LINE && dataItem->tubeRenderer == 0)
    {
-      updateDataDisplayList(dataItem);
-      /* Mark the display list as up-to-date: */
-      dataItem->dataDisplayListVersion = dataDisplayListVersion;
+      if(dataItem->dataDisplayListVersion != dataDisplayListVersion)
+      {
+         updateDataDisplayList(dataItem);
+         /* Mark the display list as up-to-date: */
+         dataItem->dataDisplayListVersion = dataDisplayListVersion;
+      }
+      glCallList(dataItem->dataDisplayListId);
+      return;
    }
-   glCallList(dataItem->dataDisplayListId);
 
+   drawMeshes(dataItem);
 }
 
 void StaticSolverTool::setExperiment(DTSExperiment* e)
@@ -155,6 +163,7 @@ void StaticSolverTool::updatedExperiment()
    for (it = datasets.begin(); it != datasets.end(); it++)
    {
       computeStaticSolution(*it);
+      updateMesh(*it);
    }
    requestDataDisplayListUpdate();
 }
@@ -194,7 +203,11 @@ void StaticSolverTool::addStaticSolution(DTS::Vector<double> position)
    // create a new static solution
    std::cout << "Position: " << position << std::endl;
    StaticSolverData* newData = new StaticSolverData(experiment->model->getDimension());
-   experiment->transformer->invTransform(position, newData->points[0]);
+   {
+      // the simulation thread sets the transformer parameters
+      ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+      experiment->transformer->invTransform(position, newData->points[0]);
+   }
    std::cout << "invTransform: " << newData->points[0] << std::endl;
    std::cout << std::endl;
 
@@ -202,6 +215,7 @@ void StaticSolverTool::addStaticSolution(DTS::Vector<double> position)
    newData->lineStyle = lineStyle;
    newData->setNumberOfPoints(numberOfPoints, experiment->model->getDimension());
    computeStaticSolution(newData);
+   updateMesh(newData);
 
    if (not multipleStaticSolutions)
    {
@@ -216,68 +230,213 @@ void StaticSolverTool::addStaticSolution(DTS::Vector<double> position)
 // StaticSolverTool internal methods
 //
 
-void StaticSolverTool::drawBasicLine(StaticSolverData* d) const
+/** Brings the mesh of d up to date after points [first, numberOfPoints)
+ *  were computed. The points before first are neither projected nor
+ *  tessellated again.
+ */
+void StaticSolverTool::updateMesh(StaticSolverData* d, unsigned int first)
+{
+   unsigned int numPoints=d->numberOfPoints;
+   size_t previousSize=d->mesh.size();
+   if (first > d->displayPoints.size())
+      first=d->displayPoints.size();
+
+   d->displayPoints.resize(numPoints);
+   DTS::Vector<double> tmp(experiment->model->getDimension());
+   ParameterClass<double>::Pin transformerPin(*experiment->transformer);
+   for (unsigned int i=first; i < numPoints; i++)
+   {
+      experiment->transformer->transform(d->points[i], tmp);
+      d->displayPoints[i][0]=tmp[0];
+      d->displayPoints[i][1]=tmp[1];
+      d->displayPoints[i][2]=tmp[2];
+   }
+
+   // the point before first gets a new tangent as well
+   DTS::TubeRenderer::setTube(d->mesh, numPoints > 0 ? &d->displayPoints[0] : 0,
+         numPoints, first);
+   d->meshChangedFrom=first > 0 ? 2 * (first - 1) : 0;
+
+   // the gradient spans all points, so its colors move with the count
+   if (d->colorStyle == StaticSolverData::GRADIENT && d->mesh.size() != previousSize)
+   {
+      colorMesh(d);
+      d->meshChangedFrom=0;
+   }
+   ++d->meshVersion;
+}
+
+/** Sets the mesh colors of d from its color style. */
+void StaticSolverTool::colorMesh(StaticSolverData* d) const
+{
+   if (d->colorStyle == StaticSolverData::SOLID)
+   {
+      DTS::TubeRenderer::setTubeColors(d->mesh, 0);
+      return;
+   }
+
+   unsigned int numPoints=d->mesh.size() / 2;
+   std::vector<DTS::TubeRenderer::Color> colors(numPoints);
+   for (unsigned int i=0; i < numPoints; i++)
+   {
+      unsigned int index=(int) ((float) i / (float) numPoints * 255.0);
+      const float* color=d->colorMap->getColor(index);
+      for (int j=0; j < 3; j++)
+         colors[i][j]=(GLubyte) (color[j] * 255.0f + 0.5f);
+      colors[i][3]=255;
+   }
+   if (numPoints > 0)
+      DTS::TubeRenderer::setTubeColors(d->mesh, &colors[0]);
+}
+
+/** Draws the meshes of all datasets, as shader tubes or as lines. */
+void StaticSolverTool::drawMeshes(DTS::DataItem* dataItem) const
 {
+   typedef DTS::TubeRenderer::Vertex Vertex;
+
+   bool solid=colorStyle == StaticSolverData::SOLID;
+   bool tubes=lineStyle == StaticSolverData::POLY_LINE;
+
    // save the current attribute state
-   glPushAttrib(GL_LIGHTING_BIT);
+   glPushAttrib(GL_LIGHTING_BIT | GL_CURRENT_BIT);
+   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
 
-   glDisable(GL_LIGHTING);
+   if (tubes && solid)
+   {
+      glEnable(GL_LIGHTING);
 
-   DTS::Vector<double> tmp(3);
+      GLMaterial
+            material(GLMaterial::Color(1.0, 0.5, 0.0, 1.0), GLMaterial::Color(1.0, 1.0, 1.0, 1.0), 80.0);
 
-   if (datasets[0]->colorStyle == StaticSolverData::SOLID)
+      glMaterial(GLMaterialEnums::FRONT_AND_BACK, material);
+   }
+   else
    {
+      glDisable(GL_LIGHTING);
       glColor3f(1.0f, 0.5f, 0.0f);
+   }
 
-      glBegin(GL_LINE_STRIP);
-      for (unsigned int i=0; i < datasets[0]->numberOfPoints; i++)
+   std::vector<StaticSolverData*>::const_iterator it;
+   for (it = datasets.begin(); it != datasets.end(); it++)
+   {
+      const StaticSolverData* d=*it;
+      if (d->mesh.size() < 4)
+         continue;
+
+      const Vertex* vertices=bindMesh(dataItem, d);
+      if (tubes)
       {
-         experiment->transformer->transform(d->points[i], tmp);
-         glVertex3f(tmp[0], tmp[1], tmp[2]);
+         dataItem->tubeRenderer->draw(vertices, d->mesh.size(), 0.1f, solid);
+         continue;
       }
-      glEnd();
 
-   }
-   else if (datasets[0]->colorStyle == StaticSolverData::GRADIENT)
-   {
-      glBegin(GL_LINES);
-      for (unsigned int i=1; i < datasets[0]->numberOfPoints; i++)
+      // one vertex of each pair makes the line strip
+      const char* base=reinterpret_cast<const char*> (vertices);
+      GLsizei stride=2 * sizeof(Vertex);
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glVertexPointer(3, GL_FLOAT, stride, base + offsetof(Vertex, position));
+      if (!solid)
       {
-         const unsigned int index=(int) ((float) i / (float) datasets[0]->numberOfPoints
-               * 255.0);
+         glEnableClientState(GL_COLOR_ARRAY);
+         glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(Vertex, color));
+      }
+      glDrawArrays(GL_LINE_STRIP, 0, d->mesh.size() / 2);
+   }
 
-         const float* color=datasets[0]->colorMap->getColor(index);
-         glColor3fv(color);
+   if (dataItem->hasVertexBufferObjectExtension)
+   {
+      glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 
-         experiment->transformer->transform(d->points[i-1], tmp);
-         glVertex3f(tmp[0], tmp[1], tmp[2]);
-         experiment->transformer->transform(d->points[i], tmp);
-         glVertex3f(tmp[0], tmp[1], tmp[2]);
+      // delete the buffers of datasets that are gone
+      DTS::DataItem::MeshBufferMap& buffers=dataItem->staticSolverMeshes;
+      DTS::DataItem::MeshBufferMap::iterator bit=buffers.begin();
+      while (bit != buffers.end())
+      {
+         if (bit->second.used)
+         {
+            bit->second.used=false;
+            ++bit;
+            continue;
+         }
+         glDeleteBuffersARB(1, &bit->second.bufferId);
+         buffers.erase(bit++);
       }
-      glEnd();
-
    }
 
    // restore the previous attribute state
+   glPopClientAttrib();
    glPopAttrib();
 }
 
+/** Returns where to draw the mesh of d from: an offset into its vertex
+ *  buffer, which is brought up to date and bound, or the mesh itself
+ *  without vertex buffer support.
+ */
+const DTS::TubeRenderer::Vertex* StaticSolverTool::bindMesh(DTS::DataItem* dataItem,
+      const StaticSolverData* d) const
+{
+   typedef DTS::TubeRenderer::Vertex Vertex;
+
+   if (!dataItem->hasVertexBufferObjectExtension)
+      return &d->mesh[0];
+
+   DTS::DataItem::MeshBuffer& buffer=dataItem->staticSolverMeshes[d->id];
+   if (buffer.bufferId == 0)
+      glGenBuffersARB(1, &buffer.bufferId);
+   glBindBufferARB(GL_ARRAY_BUFFER_ARB, buffer.bufferId);
+   buffer.used=true;
+
+   if (buffer.version != d->meshVersion)
+   {
+      size_t size=d->mesh.size() * sizeof(Vertex);
+      if (buffer.version + 1 == d->meshVersion && size <= buffer.capacity)
+      {
+         // one update behind: copy only the vertices it changed
+         size_t offset=d->meshChangedFrom * sizeof(Vertex);
+         if (offset < size)
+            glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, offset, size - offset,
+                  &d->mesh[d->meshChangedFrom]);
+      }
+      else
+      {
+         // leave room for appended points
+         buffer.capacity=size + size / 2;
+         glBufferDataARB(GL_ARRAY_BUFFER_ARB, buffer.capacity, 0, GL_STATIC_DRAW_ARB);
+         glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, size, &d->mesh[0]);
+      }
+      buffer.version=d->meshVersion;
+   }
+
+   return 0;
+}
+
+/** Draws the solution as a GLE tube, for OpenGL without shaders. */
 void StaticSolverTool::drawPolyLine(StaticSolverData* d) const
 {
-   unsigned int numPoints = datasets[0]->numberOfPoints;
+   unsigned int numPoints = d->numberOfPoints;
+   if (numPoints < 2)
+      return;
 
    // save the current attribute state
    glPushAttrib(GL_LIGHTING_BIT);
 
-   // allocate memory for gle rendering methods
    // first and last points set the angle, not position: add 2 extra points
-   gleDouble points[numPoints + 2][3];
-   float colors[numPoints + 2][3];
+   std::vector<gleDouble> points(3 * (numPoints + 2));
+   std::vector<float> colors;
    gleDouble radius=0.1; // radius of poly-cylinder
 
-   DTS::Vector<double> tmp(experiment->model->getDimension());
+   for (unsigned int i=0; i < numPoints; i++)
+   {
+      for (int j=0; j < 3; j++)
+         points[3 * (i + 1) + j]=d->displayPoints[i][j];
+   }
+   for (int j=0; j < 3; j++)
+   {
+      points[j] = .95 * points[3 + j];
+      points[3 * (numPoints + 1) + j] = .95 * points[3 * numPoints + j];
+   }
 
-   if (datasets[0]->colorStyle == StaticSolverData::SOLID)
+   if (d->colorStyle == StaticSolverData::SOLID)
    {
       glEnable(GL_LIGHTING);
 
@@ -285,89 +444,32 @@ void StaticSolverTool::drawPolyLine(StaticSolverData* d) const
             material(GLMaterial::Color(1.0, 0.5, 0.0, 1.0), GLMaterial::Color(1.0, 1.0, 1.0, 1.0), 80.0);
 
       glMaterial(GLMaterialEnums::FRONT_AND_BACK, material);
-
-      /*
-      float xmin = 0;
-      float xmax = 0;
-      float ymin = 0;
-      float ymax = 0;
-      float zmin = 0;
-      float zmax = 0;
-      */
-      for (unsigned int i=0; i < numPoints; i++)
-      {
-         experiment->transformer->transform(d->points[i], tmp);
-
-         points[i+1][0]=tmp[0];
-         points[i+1][1]=tmp[1];
-         points[i+1][2]=tmp[2];
-         /*
-          if (points[i][0] > xmax) xmax = points[i][0];
-          if (points[i][0] < xmin) xmin = points[i][0];
-          if (points[i][0] > ymax) ymax = points[i][1];
-          if (points[i][0] < ymin) ymin = points[i][1];
-          if (points[i][0] > zmax) zmax = points[i][2];
-          if (points[i][0] < zmin) zmin = points[i][2];
-         */
-      }
-      //std::cout << xmin << " " << xmax << " " << ymin << " " << ymax << " " << zmin << " " << zmax << std::endl;
-
-      // set first and last
-      points[0][0] = .95 * points[1][0];
-      points[0][1] = .95 * points[1][1];
-      points[0][2] = .95 * points[1][2];
-      points[numPoints+1][0] = .95 * points[numPoints][0];
-      points[numPoints+1][1] = .95 * points[numPoints][1];
-      points[numPoints+1][2] = .95 * points[numPoints][2];
-
-
-
    }
-   else if (datasets[0]->colorStyle == StaticSolverData::GRADIENT)
+   else if (d->colorStyle == StaticSolverData::GRADIENT)
    {
       glDisable(GL_LIGHTING);
 
+      colors.resize(3 * (numPoints + 2));
       for (unsigned int i=0; i < numPoints; i++)
       {
          unsigned int index=(int) ((float) i / (float) numPoints * 255.0);
 
-         const float* color=datasets[0]->colorMap->getColor(index);
-         glColor3fv(color);
-
-         colors[i][0]=color[0];
-         colors[i][1]=color[1];
-         colors[i][2]=color[2];
-
-         experiment->transformer->transform(d->points[i], tmp);
-
-         points[i+1][0]=tmp[0];
-         points[i+1][1]=tmp[1];
-         points[i+1][2]=tmp[2];
+         const float* color=d->colorMap->getColor(index);
+         for (int j=0; j < 3; j++)
+            colors[3 * (i + 1) + j]=color[j];
+      }
+      for (int j=0; j < 3; j++)
+      {
+         colors[j] = colors[3 + j];
+         colors[3 * (numPoints + 1) + j] = colors[3 * numPoints + j];
       }
-
-      // set first and last
-      colors[0][0] = colors[1][0];
-      colors[0][1] = colors[1][1];
-      colors[0][2] = colors[1][2];
-      colors[numPoints+1][0] = colors[numPoints][0];
-      colors[numPoints+1][1] = colors[numPoints][1];
-      colors[numPoints+1][2] = colors[numPoints][2];
-
-      points[0][0] = .95 * points[1][0];
-      points[0][1] = .95 * points[1][1];
-      points[0][2] = .95 * points[1][2];
-      points[numPoints+1][0] = .95 * points[numPoints][0];
-      points[numPoints+1][1] = .95 * points[numPoints][1];
-      points[numPoints+1][2] = .95 * points[numPoints][2];
-
-
    }
 
    // draw line as generalized cylinder
    glePolyCylinder(
-      numPoints,  // num points in polyline
-      points,     // polyline vertces
-      colors,     // colors at polyline verts
+      numPoints + 2,  // num points in polyline
+      reinterpret_cast<gleDouble (*)[3]> (&points[0]),  // polyline vertces
+      colors.empty() ? 0 : reinterpret_cast<float (*)[3]> (&colors[0]),  // colors at polyline verts
       radius      // radius of polycylinder
    );
 
@@ -377,18 +479,31 @@ void StaticSolverTool::drawPolyLine(StaticSolverData* d) const
 
 /* Private methods */
 
-void StaticSolverTool::computeStaticSolution(StaticSolverData* data)
+/** Computes points [first, numberOfPoints) of the solution, continuing from
+ *  point first-1. The integrator samples the trajectory at one stepSize
+ *  intervals, which lets adaptive integrators take fewer, larger steps.
+ */
+void StaticSolverTool::computeStaticSolution(StaticSolverData* data, unsigned int first)
 {
-   DTS::Vector<double> tmp(experiment->model->getDimension());
-   for (unsigned int i=1; i < data->numberOfPoints; i++)
+   if (first == 0 || first >= data->numberOfPoints)
+      return;
+
+   unsigned int dimension=experiment->model->getDimension();
+   unsigned int count=data->numberOfPoints - first + 1;
+
+   std::vector<double> samples(count * dimension);
+   experiment->integrator->sampleTrajectory(
+         &data->points[first-1].getComponents()[0], &samples[0], count);
+
+   for (unsigned int i=1; i < count; i++)
    {
-      data->points[i] = data->points[i-1];
-      experiment->integrator->step(data->points[i-1], tmp);
-      data->points[i] += tmp;
+      for (unsigned int j=0; j < dimension; j++)
+      {
+         data->points[first-1+i][j]=samples[i * dimension + j];
+      }
    }
 }
 
-
 void StaticSolverTool::clearDatasets()
 {
    // clear all dynamically allocated StaticSolverData instances
@@ -418,15 +533,7 @@ void StaticSolverTool::updateDataDisplayList(DTS::DataItem* dataItem) const
    // Recall: 'it' is a pointer to a pointer of a StaticSolverData instance.
    for (it = datasets.begin(); it != datasets.end(); it++)
    {
-      // delegate rendering based on line style
-      if (datasets[0]->lineStyle == StaticSolverData::BASIC)
-      {
-         drawBasicLine(*it);
-      }
-      else if (datasets[0]->lineStyle == StaticSolverData::POLY_LINE)
-      {
-         drawPolyLine(*it);
-      }
+      drawPolyLine(*it);
    }
 
    glEndList();
@@ -38,6 +38,7 @@
 #include "DataItem.h"
 #include "AbstractDynamicsTool.h"
 #include "Dynamics/Vector.h"
+#include "TubeRenderer.h"
 
 #include "StaticSolverOptionsDialog.h"
 
@@ -51,6 +52,11 @@ class GLPolylineTube;
  * Specifically, it stores render options such as the line style and
  * color as well as the point values which are used to render the
  * particle path.
+ *
+ * The projected points are kept with a tube mesh along them (see
+ * DTS::TubeRenderer), which is extended rather than rebuilt when points
+ * are appended. meshVersion and meshChangedFrom let each GL context copy
+ * only the changed vertices to its buffer of the mesh.
  */
 class StaticSolverData
 {
@@ -58,7 +64,8 @@ class StaticSolverData
 
    public:
       StaticSolverData(int modelDimension) :
-         numberOfPoints(5000), lineStyle(BASIC), colorStyle(GRADIENT)
+         numberOfPoints(5000), lineStyle(BASIC), colorStyle(GRADIENT),
+               id(nextId++), meshVersion(0), meshChangedFrom(0)
       {
          points.reserve(numberOfPoints);
 
@@ -108,6 +115,14 @@ class StaticSolverData
       ColorStyle colorStyle; ///< Color used in redering line.
 
       ColorMap* colorMap; ///< Color map for rendering color gradient.
+
+      std::vector<DTS::TubeRenderer::Point> displayPoints; ///< Projected points.
+      DTS::TubeRenderer::VertexArray mesh; ///< Tube along displayPoints, two vertices per point.
+      unsigned int id; ///< Identifies the mesh buffers of this dataset.
+      unsigned int meshVersion; ///< Incremented whenever the mesh changes.
+      size_t meshChangedFrom; ///< First vertex changed by the last increment of meshVersion.
+
+      static unsigned int nextId;
 };
 
 /** Computes the path of a particle and renders it as a line.
@@ -202,7 +217,11 @@ class StaticSolverTool: public AbstractDynamicsTool, public GLObject
          std::vector<StaticSolverData*>::iterator it;
          for (it = datasets.begin(); it != datasets.end(); it++)
          {
+            // only the colors are regenerated, not the tube geometry
             (*it)->colorStyle = style;
+            colorMesh(*it);
+            (*it)->meshChangedFrom = 0;
+            ++(*it)->meshVersion;
          }
          requestDataDisplayListUpdate();
          Vrui::requestUpdate();
@@ -236,12 +255,11 @@ class StaticSolverTool: public AbstractDynamicsTool, public GLObject
             if (size > numberOfPoints)
             {
                // So, we need to calculate solutions for new points
-               for (unsigned int i=numberOfPoints; i < size; i++)
-               {
-                  experiment->integrator->step(data->points[i-1], data->points[i]);
-                  data->points[i] += data->points[i-1];
-               }
+               computeStaticSolution(data, numberOfPoints);
             }
+
+            // only the new points are projected and tessellated
+            updateMesh(data, size < numberOfPoints ? size : numberOfPoints);
          }
          numberOfPoints = size;
 
@@ -261,9 +279,12 @@ class StaticSolverTool: public AbstractDynamicsTool, public GLObject
       StaticSolverData::ColorStyle colorStyle;
 
       /* Internal methods */
-      void computeStaticSolution(StaticSolverData* d);
+      void computeStaticSolution(StaticSolverData* d, unsigned int first=1);
       void clearDatasets();
-      void drawBasicLine(StaticSolverData* d) const;
+      void updateMesh(StaticSolverData* d, unsigned int first=0);
+      void colorMesh(StaticSolverData* d) const;
+      void drawMeshes(DTS::DataItem* dataItem) const;
+      const DTS::TubeRenderer::Vertex* bindMesh(DTS::DataItem* dataItem, const StaticSolverData* d) const;
       void drawPolyLine(StaticSolverData* d) const;
       void requestDatasetsUpdate();
       void requestDataDisplayListUpdate();
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ TrailBuffer: Vertex buffer kept across frames for incrementally updated data.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#include "TrailBuffer.h"
+
+namespace DTS
+{
+
+//
+// TrailBuffer methods
+//
+
+TrailBuffer::TrailBuffer() :
+   layout(0), history(0), step(0), bufferId(0)
+{
+   glGenBuffersARB(1, &bufferId);
+}
+
+TrailBuffer::~TrailBuffer()
+{
+   glDeleteBuffersARB(1, &bufferId);
+}
+
+void TrailBuffer::bind() const
+{
+   glBindBufferARB(GL_ARRAY_BUFFER_ARB, bufferId);
+}
+
+void TrailBuffer::allocate(size_t size)
+{
+   glBufferDataARB(GL_ARRAY_BUFFER_ARB, size, 0, GL_DYNAMIC_DRAW_ARB);
+}
+
+void TrailBuffer::write(size_t offset, size_t size, const void* data)
+{
+   if (size > 0)
+      glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, offset, size, data);
+}
+
+} // namespace DTS
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ TrailBuffer: Vertex buffer kept across frames for incrementally updated data.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TRAIL_BUFFER_H
+#define TRAIL_BUFFER_H
+
+#include <cstddef>
+
+// Vrui includes
+//
+#include <GL/gl.h>
+#include <GL/Extensions/GLARBVertexBufferObject.h>
+
+namespace DTS
+{
+
+/** A single vertex buffer whose contents are kept from frame to frame, for
+ *  data of which only a small part changes per frame, such as the trail
+ *  rings of the dynamic solver.
+ *
+ * Unlike StreamingBuffer, which rewrites all its data with every upload,
+ * a TrailBuffer is allocated once per layout and then patched in place:
+ * \code
+ *   buffer.bind();
+ *   if (buffer.layout != layout)
+ *   {
+ *      buffer.allocate(size);
+ *      buffer.write(0, size, data);
+ *      buffer.layout=layout;
+ *   }
+ *   else
+ *      buffer.write(offset, changedSize, changedData); // for each change
+ *   buffer.step=step;
+ *   // draw calls
+ * \endcode
+ */
+class TrailBuffer
+{
+   public:
+      unsigned int layout; ///< User layout of the data in the buffer; 0 for none.
+      unsigned int history; ///< User ring length of the data in the buffer.
+      unsigned long step; ///< User step of the data in the buffer.
+
+      /** Creates the buffer. Needs a current GL context with the vertex
+       *  buffer object extension initialized.
+       */
+      TrailBuffer();
+      ~TrailBuffer();
+
+      /** Binds the buffer to GL_ARRAY_BUFFER_ARB. */
+      void bind() const;
+
+      /** Gives the (bound) buffer new storage of size bytes; the contents
+       *  are undefined until written.
+       */
+      void allocate(size_t size);
+
+      /** Copies size bytes from data into the (bound) buffer at offset. */
+      void write(size_t offset, size_t size, const void* data);
+
+   private:
+      GLuint bufferId;
+
+      /* Prevent copying */
+      TrailBuffer(const TrailBuffer&);
+      TrailBuffer& operator=(const TrailBuffer&);
+};
+
+} // namespace DTS
+
+#endif
@@ -0,0 +1,264 @@
+/*******************************************************************************
+ TubeRenderer: Shader-based rendering of polylines as tubes.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#include "TubeRenderer.h"
+
+#include <cmath>
+#include <cstddef>
+
+// Vrui includes
+//
+#include <GL/Extensions/GLARBVertexShader.h>
+#include <GL/Extensions/GLARBFragmentShader.h>
+
+namespace DTS
+{
+
+//
+// TubeRenderer methods
+//
+
+TubeRenderer::TubeRenderer() :
+   vertexShaderObject(0), fragmentShaderObject(0), programObject(0)
+{
+   /* Source code for vertex and fragment programs: */
+   static const char* vertexProgram="\
+      uniform float radius; \
+      \
+      varying vec3 positionEye; \
+      varying vec3 sideEye; \
+      varying vec3 viewEye; \
+      varying float side; \
+      \
+      void main() \
+      { \
+      vec4 vertexEye; \
+      vec3 tangentEye,offset; \
+      float scale,offsetLength; \
+      \
+      /* Transform the point and the tangent to eye coordinates: */ \
+      vertexEye=gl_ModelViewMatrix*gl_Vertex; \
+      tangentEye=(gl_ModelViewMatrix*vec4(gl_Normal,0.0)).xyz; \
+      scale=length(tangentEye); \
+      \
+      /* Push the vertex sideways, perpendicular to tangent and view: */ \
+      viewEye=normalize(-vertexEye.xyz); \
+      offset=cross(tangentEye,viewEye); \
+      offsetLength=length(offset); \
+      sideEye=offsetLength>0.0?offset/offsetLength:vec3(0.0); \
+      side=gl_MultiTexCoord0.x; \
+      vertexEye.xyz+=sideEye*(radius*scale*side*vertexEye.w); \
+      \
+      positionEye=vertexEye.xyz/vertexEye.w; \
+      gl_FrontColor=gl_Color; \
+      gl_Position=gl_ProjectionMatrix*vertexEye; \
+      }";
+   static const char* fragmentProgram="\
+      uniform bool lit; \
+      \
+      varying vec3 positionEye; \
+      varying vec3 sideEye; \
+      varying vec3 viewEye; \
+      varying float side; \
+      \
+      void main() \
+      { \
+      vec3 normal,light,halfway; \
+      float s,nl,nh; \
+      vec4 color; \
+      \
+      if(!lit) \
+         { \
+         gl_FragColor=gl_Color; \
+         return; \
+         } \
+      \
+      /* Normal of the cylinder surface seen at this fragment: */ \
+      s=clamp(side,-1.0,1.0); \
+      normal=normalize(sideEye*s+normalize(viewEye)*sqrt(1.0-s*s)); \
+      \
+      /* Light with light source 0 and the front material: */ \
+      light=normalize(gl_LightSource[0].position.xyz-positionEye*gl_LightSource[0].position.w); \
+      halfway=normalize(light+normalize(-positionEye)); \
+      nl=max(dot(normal,light),0.0); \
+      nh=max(dot(normal,halfway),0.0); \
+      color=gl_FrontLightModelProduct.sceneColor+gl_FrontLightProduct[0].ambient; \
+      color+=gl_FrontLightProduct[0].diffuse*nl; \
+      if(nl>0.0) \
+         color+=gl_FrontLightProduct[0].specular*pow(nh,gl_FrontMaterial.shininess); \
+      gl_FragColor=vec4(color.rgb,gl_FrontMaterial.diffuse.a); \
+      }";
+
+   /* Compile and link the tube shader program: */
+   vertexShaderObject=glCompileVertexShaderFromString(vertexProgram);
+   fragmentShaderObject=glCompileFragmentShaderFromString(fragmentProgram);
+   programObject=glLinkShader(vertexShaderObject, fragmentShaderObject);
+   radiusLocation=glGetUniformLocationARB(programObject, "radius");
+   litLocation=glGetUniformLocationARB(programObject, "lit");
+}
+
+TubeRenderer::~TubeRenderer()
+{
+   glDeleteObjectARB(programObject);
+   glDeleteObjectARB(vertexShaderObject);
+   glDeleteObjectARB(fragmentShaderObject);
+}
+
+void TubeRenderer::appendTube(VertexArray& vertices, const Point* points,
+      size_t count, const Color* colors)
+{
+   if (count < 2)
+      return;
+
+   // join to the previous tube with degenerate triangles
+   bool join=!vertices.empty();
+   if (join)
+      vertices.push_back(vertices.back());
+
+   size_t first=vertices.size() + (join ? 1 : 0);
+   vertices.resize(first + 2 * count);
+   if (join)
+      vertices[first - 1]=vertices[first];
+
+   GLfloat tangent[3]= { 1.0f, 0.0f, 0.0f };
+   for (size_t i=0; i < count; i++)
+   {
+      setPoint(&vertices[first + 2 * i], points, count, i, tangent);
+      setColor(&vertices[first + 2 * i], colors ? &colors[i] : 0);
+   }
+   if (join)
+      vertices[first - 1]=vertices[first];
+}
+
+void TubeRenderer::setTube(VertexArray& vertices, const Point* points,
+      size_t count, size_t first)
+{
+   size_t previousCount=vertices.size() / 2;
+   vertices.resize(2 * count);
+
+   // the point before first gets a new successor, hence a new tangent
+   if (first > 0)
+      first--;
+   if (first > previousCount)
+      first=previousCount;
+
+   GLfloat tangent[3]= { 1.0f, 0.0f, 0.0f };
+   if (first > 0)
+   {
+      for (int j=0; j < 3; j++)
+         tangent[j]=vertices[2 * (first - 1)].tangent[j];
+   }
+
+   for (size_t i=first; i < count; i++)
+   {
+      setPoint(&vertices[2 * i], points, count, i, tangent);
+      if (i >= previousCount)
+         setColor(&vertices[2 * i], 0);
+   }
+}
+
+void TubeRenderer::setTubeColors(VertexArray& vertices, const Color* colors)
+{
+   for (size_t i=0; i < vertices.size() / 2; i++)
+      setColor(&vertices[2 * i], colors ? &colors[i] : 0);
+}
+
+void TubeRenderer::draw(const VertexArray& vertices, GLfloat radius, bool lit) const
+{
+   if (!vertices.empty())
+      draw(&vertices[0], vertices.size(), radius, lit);
+}
+
+void TubeRenderer::draw(const Vertex* vertices, GLsizei count, GLfloat radius,
+      bool lit) const
+{
+   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+   glUseProgramObjectARB(programObject);
+   glUniform1fARB(radiusLocation, radius);
+   glUniform1iARB(litLocation, lit ? 1 : 0);
+
+   // vertices may be an offset into a bound buffer: no dereferencing
+   const char* base=reinterpret_cast<const char*> (vertices);
+   GLsizei stride=sizeof(Vertex);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(3, GL_FLOAT, stride, base + offsetof(Vertex, position));
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glNormalPointer(GL_FLOAT, stride, base + offsetof(Vertex, tangent));
+   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+   glTexCoordPointer(1, GL_FLOAT, stride, base + offsetof(Vertex, side));
+   glEnableClientState(GL_COLOR_ARRAY);
+   glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(Vertex, color));
+
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, count);
+
+   glUseProgramObjectARB(0);
+   glPopClientAttrib();
+}
+
+//
+// TubeRenderer internal methods
+//
+
+/** Sets the position and tangent of the vertex pair of point i. tangent
+ *  holds the tangent of point i-1 and is updated.
+ */
+void TubeRenderer::setPoint(Vertex* pair, const Point* points, size_t count,
+      size_t i, GLfloat tangent[3])
+{
+   // central differences, one-sided at the ends
+   const Point& next=points[i + 1 < count ? i + 1 : i];
+   const Point& previous=points[i > 0 ? i - 1 : i];
+   GLfloat direction[3];
+   GLfloat length=0.0f;
+   for (int j=0; j < 3; j++)
+   {
+      direction[j]=next[j] - previous[j];
+      length+=direction[j] * direction[j];
+   }
+
+   // repeated points keep the last direction
+   length=std::sqrt(length);
+   if (length > 0.0f)
+   {
+      for (int j=0; j < 3; j++)
+         tangent[j]=direction[j] / length;
+   }
+
+   for (int k=0; k < 2; k++)
+   {
+      for (int j=0; j < 3; j++)
+      {
+         pair[k].position[j]=points[i][j];
+         pair[k].tangent[j]=tangent[j];
+      }
+      pair[k].side=(k == 0 ? -1.0f : 1.0f);
+   }
+}
+
+/** Sets the color of a vertex pair; white for color 0. */
+void TubeRenderer::setColor(Vertex* pair, const Color* color)
+{
+   for (int k=0; k < 2; k++)
+   {
+      for (int j=0; j < 4; j++)
+         pair[k].color[j]=color ? (*color)[j] : 255;
+   }
+}
+
+} // namespace DTS
@@ -0,0 +1,119 @@
+/*******************************************************************************
+ TubeRenderer: Shader-based rendering of polylines as tubes.
+
+ This file is part of the Dynamics Toolset.
+
+ The Dynamics Toolset is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by the Free
+ Software Foundation, either version 3 of the License, or (at your option) any
+ later version.
+
+ The Dynamics Toolset is distributed in the hope that it will be useful, but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License
+ along with the Dynamics Toolset. If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+#ifndef TUBE_RENDERER_H
+#define TUBE_RENDERER_H
+
+#include <cstddef>
+#include <vector>
+
+// Vrui includes
+//
+#include <GL/gl.h>
+#include <GL/GLColor.h>
+#include <GL/Extensions/GLARBShaderObjects.h>
+#include <Geometry/Point.h>
+
+namespace DTS
+{
+
+/** Draws polylines as tubes, replacing the CPU-built GLE geometry.
+ *
+ * Every point of a polyline becomes two vertices of a triangle strip. The
+ * vertex shader pushes the two apart by the tube radius, perpendicular to
+ * the polyline and to the viewing direction, so the strip always faces
+ * the viewer. The fragment shader lights the strip as if it were the
+ * cylinder it stands in for, using light source 0 and the current front
+ * material, which gives the look of the lit GLE tubes.
+ *
+ * Any number of tubes go into one vertex array and are drawn with one
+ * call:
+ * \code
+ *   TubeRenderer::VertexArray vertices;
+ *   TubeRenderer::appendTube(vertices, points, numPoints, colors);
+ *   // more tubes
+ *   dataItem->tubeRenderer->draw(vertices, radius, lit);
+ * \endcode
+ */
+class TubeRenderer
+{
+   public:
+      typedef Geometry::Point<float,3> Point;
+      typedef GLColor<GLubyte, 4> Color;
+
+      /// One side of a tube at one polyline point.
+      struct Vertex
+      {
+         GLfloat position[3]; ///< Polyline point.
+         GLfloat tangent[3]; ///< Unit direction of the polyline at the point.
+         GLfloat side; ///< -1 or 1: the side of the tube.
+         GLubyte color[4]; ///< Color of unlit tubes.
+      };
+
+      typedef std::vector<Vertex> VertexArray;
+
+      /** Compiles the shaders. Needs a current GL context with the shader
+       *  extensions initialized.
+       */
+      TubeRenderer();
+      ~TubeRenderer();
+
+      /** Appends the tube along count points to vertices. colors holds one
+       *  color per point, or is 0 for tubes that are lit.
+       */
+      static void appendTube(VertexArray& vertices, const Point* points,
+            size_t count, const Color* colors);
+
+      /** Makes vertices the single tube along count points, of which the
+       *  ones before first are unchanged since vertices were last set.
+       *  Only the vertices of the changed points (and of the point before
+       *  them) are recomputed; new vertices are white.
+       */
+      static void setTube(VertexArray& vertices, const Point* points,
+            size_t count, size_t first);
+
+      /** Sets the colors of a single tube, one per point; white for 0. */
+      static void setTubeColors(VertexArray& vertices, const Color* colors);
+
+      /** Draws the tubes of vertices. Lit tubes take their color from the
+       *  current material, unlit tubes from the vertex colors.
+       */
+      void draw(const VertexArray& vertices, GLfloat radius, bool lit) const;
+
+      /** Same, for count vertices at vertices, which is an offset into the
+       *  bound GL_ARRAY_BUFFER_ARB if there is one.
+       */
+      void draw(const Vertex* vertices, GLsizei count, GLfloat radius, bool lit) const;
+
+   private:
+      GLhandleARB vertexShaderObject, fragmentShaderObject, programObject;
+      GLint radiusLocation; ///< Location of the tube radius uniform variable.
+      GLint litLocation; ///< Location of the lighting flag uniform variable.
+
+      /* Prevent copying */
+      TubeRenderer(const TubeRenderer&);
+      TubeRenderer& operator=(const TubeRenderer&);
+
+      static void setPoint(Vertex* pair, const Point* points, size_t count,
+            size_t i, GLfloat tangent[3]);
+      static void setColor(Vertex* pair, const Color* color);
+};
+
+} // namespace DTS
+
+#endif